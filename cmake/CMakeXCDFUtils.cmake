@@ -12,7 +12,7 @@ FUNCTION (XCDF_ADD_LIBRARY)
 
   # Build and install library
   ADD_LIBRARY (${XCDF_ADD_LIBRARY_TARGET} SHARED ${${_lib}_SOURCES})
-  TARGET_LINK_LIBRARIES (${XCDF_ADD_LIBRARY_TARGET} z m)
+  TARGET_LINK_LIBRARIES (${XCDF_ADD_LIBRARY_TARGET} z m Threads::Threads)
 
   # if we build the python bindings with skbuild, we don't want to install everything
   IF(NOT SKBUILD)
@@ -63,7 +63,7 @@ FUNCTION (XCDF_ADD_EXECUTABLE)
   NO_DOTFILE_GLOB (${_exe}_SOURCES ${XCDF_ADD_EXECUTABLE_SOURCES})
 
   ADD_EXECUTABLE (${_exename} ${${_exe}_SOURCES})
-  TARGET_LINK_LIBRARIES (${_exename} xcdf z m)
+  TARGET_LINK_LIBRARIES (${_exename} xcdf z m Threads::Threads)
   IF (XCDF_ADD_EXECUTABLE_EXE_NAME)
     SET_TARGET_PROPERTIES(${_exename} PROPERTIES OUTPUT_NAME "${XCDF_ADD_EXECUTABLE_EXE_NAME}")
   ENDIF (XCDF_ADD_EXECUTABLE_EXE_NAME)
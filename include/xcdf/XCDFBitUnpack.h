@@ -0,0 +1,235 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_BIT_UNPACK_INCLUDED_H
+#define XCDF_BIT_UNPACK_INCLUDED_H
+
+#include <xcdf/XCDFDefs.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define XCDF_HAVE_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+/*
+ *  Batch bit-unpacking kernels.  Unpack n consecutive values of the same
+ *  width starting at an arbitrary bit offset into the little-endian packed
+ *  stream, and reconstruct field values as activeMin + resolution * datum.
+ *  The caller guarantees 8 bytes of readable padding past the last value,
+ *  as XCDFBlockData::UnpackFrame does.
+ *
+ *  An AVX2 kernel (gather + per-lane variable shift) is selected at runtime
+ *  when the CPU supports it.  SSE2 has neither gathers nor per-lane 64-bit
+ *  shifts, so other machines use the scalar kernel.
+ */
+
+inline uint64_t XCDFWidthMask(const unsigned width) {
+  return width < XCDF_DATUM_WIDTH_BITS ?
+           (static_cast<uint64_t>(1) << width) - 1 : ~static_cast<uint64_t>(0);
+}
+
+/// Unpack a single value of the given width at the given bit offset
+inline uint64_t XCDFUnpackOne(const char* data,
+                              const uint64_t bit, const unsigned width) {
+
+  const char* ptr = data + (bit >> 3);
+  unsigned shift = bit & 0x07;
+  uint64_t datum;
+  memcpy(&datum, ptr, XCDF_DATUM_WIDTH_BYTES);
+  datum >>= shift;
+  if (width + shift > XCDF_DATUM_WIDTH_BITS) {
+    // Field spread across 9 bytes
+    datum |= static_cast<uint64_t>(static_cast<uint8_t>(
+               ptr[XCDF_DATUM_WIDTH_BYTES])) << (XCDF_DATUM_WIDTH_BITS - shift);
+  }
+  return datum & XCDFWidthMask(width);
+}
+
+inline void XCDFUnpackScalar(const char* data, uint64_t bit,
+                             const unsigned width, const unsigned n,
+                             uint64_t* out) {
+
+  if (width == 0) {
+    std::fill(out, out + n, 0);
+    return;
+  }
+  for (unsigned i = 0; i < n; ++i, bit += width) {
+    out[i] = XCDFUnpackOne(data, bit, width);
+  }
+}
+
+template <typename T>
+inline void XCDFReconstructScalar(const T activeMin, const T resolution,
+                                  const unsigned n, T* out) {
+  for (unsigned i = 0; i < n; ++i) {
+    out[i] = activeMin + resolution * static_cast<uint64_t>(out[i]);
+  }
+}
+
+#ifdef XCDF_HAVE_AVX2_KERNELS
+
+inline bool XCDFCPUHasAVX2() {
+  static const bool hasAVX2 = (__builtin_cpu_init(),
+                               __builtin_cpu_supports("avx2") != 0);
+  return hasAVX2;
+}
+
+/*
+ *  Unpack 4 values with AVX2.  Widths above 57 bits may spill into a 9th
+ *  byte and are not handled here.
+ */
+__attribute__((target("avx2")))
+inline __m256i XCDFUnpack4AVX2(const char* data, const uint64_t bit,
+                               const __m256i& steps, const __m256i& mask) {
+
+  const __m256i offsets = _mm256_add_epi64(
+                 _mm256_set1_epi64x(static_cast<long long>(bit)), steps);
+  const __m256i bytes = _mm256_srli_epi64(offsets, 3);
+  const __m256i shifts = _mm256_and_si256(offsets, _mm256_set1_epi64x(0x07));
+  __m256i datum = _mm256_i64gather_epi64(
+                 reinterpret_cast<const long long*>(data), bytes, 1);
+  datum = _mm256_srlv_epi64(datum, shifts);
+  return _mm256_and_si256(datum, mask);
+}
+
+__attribute__((target("avx2")))
+inline unsigned XCDFUnpackAVX2(const char* data, const uint64_t bit,
+                               const unsigned width, const unsigned n,
+                               uint64_t* out) {
+
+  const long long w = width;
+  const __m256i steps = _mm256_set_epi64x(3 * w, 2 * w, w, 0);
+  const __m256i mask = _mm256_set1_epi64x(
+                 static_cast<long long>(XCDFWidthMask(width)));
+  unsigned i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i datum = XCDFUnpack4AVX2(data, bit + i * width, steps, mask);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), datum);
+  }
+  return i;
+}
+
+/*
+ *  Fused unpack and reconstruction for doubles with width <= 52.  The
+ *  integer-to-double conversion uses the 2^52 exponent trick, which is exact
+ *  in this range, followed by separate multiply and add to match the scalar
+ *  result bit-for-bit.
+ */
+__attribute__((target("avx2")))
+inline unsigned XCDFUnpackDoubleAVX2(const char* data, const uint64_t bit,
+                                     const unsigned width, const unsigned n,
+                                     const double activeMin,
+                                     const double resolution, double* out) {
+
+  const long long w = width;
+  const __m256i steps = _mm256_set_epi64x(3 * w, 2 * w, w, 0);
+  const __m256i mask = _mm256_set1_epi64x(
+                 static_cast<long long>(XCDFWidthMask(width)));
+  const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+  const __m256d magicDouble = _mm256_set1_pd(4503599627370496.0);
+  const __m256d min = _mm256_set1_pd(activeMin);
+  const __m256d res = _mm256_set1_pd(resolution);
+  unsigned i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i datum = XCDFUnpack4AVX2(data, bit + i * width, steps, mask);
+    __m256d value = _mm256_sub_pd(
+        _mm256_castsi256_pd(_mm256_or_si256(datum, magic)), magicDouble);
+    value = _mm256_add_pd(min, _mm256_mul_pd(res, value));
+    _mm256_storeu_pd(out + i, value);
+  }
+  return i;
+}
+
+#endif // XCDF_HAVE_AVX2_KERNELS
+
+/// Unpack n raw values, dispatching to the fastest available kernel
+inline void XCDFUnpackRaw(const char* data, const uint64_t bit,
+                          const unsigned width, const unsigned n,
+                          uint64_t* out) {
+
+  unsigned done = 0;
+#ifdef XCDF_HAVE_AVX2_KERNELS
+  if (width > 0 &&
+      width <= XCDF_DATUM_WIDTH_BITS - 7 && n >= 4 && XCDFCPUHasAVX2()) {
+    done = XCDFUnpackAVX2(data, bit, width, n, out);
+  }
+#endif
+  XCDFUnpackScalar(data, bit + done * width, width, n - done, out + done);
+}
+
+/*
+ *  Unpack and reconstruct n field values.  Overloaded for the three
+ *  XCDF storage types.
+ */
+inline void XCDFUnpackValues(const char* data, const uint64_t bit,
+                             const unsigned width, const unsigned n,
+                             const uint64_t activeMin,
+                             const uint64_t resolution, uint64_t* out) {
+  XCDFUnpackRaw(data, bit, width, n, out);
+  XCDFReconstructScalar(activeMin, resolution, n, out);
+}
+
+inline void XCDFUnpackValues(const char* data, const uint64_t bit,
+                             const unsigned width, const unsigned n,
+                             const int64_t activeMin,
+                             const int64_t resolution, int64_t* out) {
+  XCDFUnpackRaw(data, bit, width, n, reinterpret_cast<uint64_t*>(out));
+  XCDFReconstructScalar(activeMin, resolution, n, out);
+}
+
+inline void XCDFUnpackValues(const char* data, uint64_t bit,
+                             const unsigned width, const unsigned n,
+                             const double activeMin,
+                             const double resolution, double* out) {
+
+  // Account for write with no compression (inf, NaN, etc.)
+  if (width == XCDF_DATUM_WIDTH_BITS) {
+    for (unsigned i = 0; i < n; ++i, bit += width) {
+      out[i] = XCDFSafeTypePun<uint64_t, double>(
+                                  XCDFUnpackOne(data, bit, width));
+    }
+    return;
+  }
+
+  unsigned done = 0;
+#ifdef XCDF_HAVE_AVX2_KERNELS
+  if (width > 0 && width <= 52 && n >= 4 && XCDFCPUHasAVX2()) {
+    done = XCDFUnpackDoubleAVX2(data, bit, width, n,
+                                activeMin, resolution, out);
+    bit += done * width;
+  }
+#endif
+  for (unsigned i = done; i < n; ++i, bit += width) {
+    uint64_t datum = width > 0 ? XCDFUnpackOne(data, bit, width) : 0;
+    out[i] = activeMin + resolution * datum;
+  }
+}
+
+#endif // XCDF_BIT_UNPACK_INCLUDED_H
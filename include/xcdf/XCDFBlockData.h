@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/XCDFFrame.h>
+#include <xcdf/XCDFBitUnpack.h>
 
 #include <vector>
 #include <cstring>
@@ -69,6 +70,59 @@ class XCDFBlockData {
       }
     }
 
+    /*
+     * Width-specialized unpacking used by block decode plans.  The width
+     * is a compile-time constant, so the upper-bit mask and the 9-byte
+     * spill check fold away.  Little-endian machines only; callers must
+     * check MachineIsBigEndian() first.
+     */
+    template <unsigned W>
+    uint64_t GetDatumFixed() {
+
+      if (W == 0) {
+        return 0;
+      }
+
+      uint64_t datum = *reinterpret_cast<uint64_t*>(
+                  buffer_.data_ + buffer_.index_) >> buffer_.indexBits_;
+
+      unsigned tot = W + buffer_.indexBits_;
+
+      // Spill into a 9th byte is only possible for widths above 57 bits
+      if (W > XCDF_DATUM_WIDTH_BITS - 7 && tot > XCDF_DATUM_WIDTH_BITS) {
+        datum |= static_cast<uint64_t>(static_cast<uint8_t>(
+                    buffer_.data_[buffer_.index_+XCDF_DATUM_WIDTH_BYTES])) <<
+                                 (XCDF_DATUM_WIDTH_BITS - buffer_.indexBits_);
+      }
+
+      if (W < XCDF_DATUM_WIDTH_BITS) {
+        datum &= (static_cast<uint64_t>(1) << (W % XCDF_DATUM_WIDTH_BITS)) - 1;
+      }
+
+      buffer_.index_    += tot >> 3;   // tot/8
+      buffer_.indexBits_ = tot & 0x07; // tot%8
+
+      return datum;
+    }
+
+    /*
+     * Unpack n consecutive values of the same width and reconstruct them
+     * as activeMin + resolution * datum.  Little-endian machines only.
+     */
+    template <typename T>
+    void GetData(const unsigned size, const unsigned n,
+                 const T activeMin, const T resolution, T* out) {
+
+      uint64_t bit = buffer_.indexBits_;
+      XCDFUnpackValues(buffer_.data_ + buffer_.index_,
+                       bit, size, n, activeMin, resolution, out);
+      bit += static_cast<uint64_t>(size) * n;
+      buffer_.index_    += bit >> 3;   // bit/8
+      buffer_.indexBits_ = bit & 0x07; // bit%8
+    }
+
+    bool MachineIsBigEndian() const {return machineIsBigEndian_;}
+
     void SkipDatum(const unsigned size) {
       unsigned tot = size + buffer_.indexBits_;
       buffer_.index_    += tot >> 3;   // tot/8
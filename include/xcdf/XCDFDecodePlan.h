@@ -0,0 +1,142 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_DECODE_PLAN_INCLUDED_H
+#define XCDF_DECODE_PLAN_INCLUDED_H
+
+#include <xcdf/XCDFBlockData.h>
+#include <xcdf/XCDFDefs.h>
+
+#include <vector>
+#include <stdint.h>
+
+class XCDFFieldDataBase;
+
+/// Decode one event's worth of data for a field from the block buffer
+typedef void (*XCDFDecodeKernel)(XCDFFieldDataBase*, XCDFBlockData&);
+
+/*
+ *  Kernel for a field container F at a fixed bit width W.  F must
+ *  provide a non-virtual template DecodeFixed<W>(XCDFBlockData&).
+ */
+template <typename F, unsigned W>
+struct XCDFFixedWidthKernel {
+  static void Decode(XCDFFieldDataBase* field, XCDFBlockData& data) {
+    static_cast<F*>(field)->template DecodeFixed<W>(data);
+  }
+};
+
+/*
+ *  Table of fixed-width kernels for widths 0-64, filled by recursive
+ *  template expansion.
+ */
+template <typename F, unsigned W>
+struct XCDFKernelTableFiller {
+  static void Fill(XCDFDecodeKernel* table) {
+    table[W] = &XCDFFixedWidthKernel<F, W>::Decode;
+    XCDFKernelTableFiller<F, W - 1>::Fill(table);
+  }
+};
+
+template <typename F>
+struct XCDFKernelTableFiller<F, 0> {
+  static void Fill(XCDFDecodeKernel* table) {
+    table[0] = &XCDFFixedWidthKernel<F, 0>::Decode;
+  }
+};
+
+template <typename F>
+class XCDFKernelTable {
+
+  public:
+
+    XCDFKernelTable() {
+      XCDFKernelTableFiller<F, XCDF_DATUM_WIDTH_BITS>::Fill(kernels_);
+    }
+
+    XCDFDecodeKernel Get(const unsigned width) const {
+      if (width > XCDF_DATUM_WIDTH_BITS) {
+        XCDFFatal("Invalid field width: " << width);
+      }
+      return kernels_[width];
+    }
+
+  private:
+
+    XCDFDecodeKernel kernels_[XCDF_DATUM_WIDTH_BITS + 1];
+};
+
+/// Look up the kernel for container type F at the given bit width
+template <typename F>
+XCDFDecodeKernel GetFixedWidthKernel(const unsigned width) {
+  static const XCDFKernelTable<F> table;
+  return table.Get(width);
+}
+
+/*!
+ * @class XCDFDecodePlan
+ * @author Jim Braun
+ * @brief Flat list of per-field decode kernels built once when a block
+ * header is loaded.  Each entry is specialized for the field type and
+ * the active bit width in the block, so reading an event is a tight loop
+ * over the table with no per-field virtual dispatch or width arithmetic.
+ */
+class XCDFDecodePlan {
+
+  public:
+
+    XCDFDecodePlan() { }
+
+    void Clear() {steps_.clear();}
+
+    void AddStep(XCDFDecodeKernel kernel, XCDFFieldDataBase* field) {
+      steps_.push_back(Step(kernel, field));
+    }
+
+    bool IsEmpty() const {return steps_.empty();}
+
+    void Execute(XCDFBlockData& data) const {
+      for (std::vector<Step>::const_iterator it = steps_.begin();
+                                             it != steps_.end(); ++it) {
+        it->kernel_(it->field_, data);
+      }
+    }
+
+  private:
+
+    struct Step {
+
+      Step(XCDFDecodeKernel kernel,
+           XCDFFieldDataBase* field) : kernel_(kernel), field_(field) { }
+
+      XCDFDecodeKernel kernel_;
+      XCDFFieldDataBase* field_;
+    };
+
+    std::vector<Step> steps_;
+};
+
+#endif // XCDF_DECODE_PLAN_INCLUDED_H
@@ -31,6 +31,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/XCDFFieldData.h>
 
 #include <string>
+#include <vector>
+#include <iterator>
 #include <stdint.h>
 
 /*!
@@ -71,9 +73,18 @@ class ConstXCDFField {
 
     T GetResolution() const {return FieldData()->GetResolution();}
 
+    /// Get the index of the parent entry owning the given entry
+    unsigned GetParentIndex(const uint32_t index) const {
+      return FieldData()->GetParentIndex(index);
+    }
+
     /// Get the number of entries in the field in the current event
     unsigned GetSize() const {return FieldData()->GetSize();}
 
+    /// Get the number of bits per entry in the block being read.  Zero
+    /// means every entry in the block has the same value.
+    uint32_t GetActiveSize() const {return FieldData()->GetActiveSize();}
+
     /// Get a value from the field
     const T& At(const uint32_t index) const {return FieldData()->At(index);}
     const T& operator[](const uint32_t index) const {
@@ -123,11 +134,22 @@ class XCDFField : public ConstXCDFField<T> {
 
     /// @brief Add an array of values to the field
     /// @param value Input array of values
-    void Add(const std::vector<T> value) {
-      for (auto it = value.begin(); it != value.end(); ++it)
-        FieldData()->Add(*it);
+    void Add(const std::vector<T>& value) {
+      if (!value.empty()) {
+        FieldData()->Add(&value[0], value.size());
+      }
     }
 
+    /// @brief Add n contiguous values to the field in one copy
+    /// @param begin Pointer to the first value
+    /// @param n Number of values
+    void Add(const T* begin, size_t n) { FieldData()->Add(begin, n); }
+
+    /// @brief Add the values in [begin, end) to the field.  Pointer
+    /// ranges are added in one copy.
+    template <typename Iterator>
+    void Add(Iterator begin, Iterator end) { AddRange(begin, end); }
+
     XCDFField<T>& operator<<(const T value) {
       FieldData()->Add(value);
       return *this;
@@ -137,6 +159,22 @@ class XCDFField : public ConstXCDFField<T> {
 
     XCDFFieldDataType* fieldData_;
 
+    void AddRange(const T* begin, const T* end) {
+      FieldData()->Add(begin, end - begin);
+    }
+
+    void AddRange(T* begin, T* end) {
+      FieldData()->Add(begin, end - begin);
+    }
+
+    template <typename Iterator>
+    void AddRange(Iterator begin, Iterator end) {
+      FieldData()->Reserve(std::distance(begin, end));
+      for (; begin != end; ++begin) {
+        FieldData()->Add(*begin);
+      }
+    }
+
     // Check if backing fieldData object exists.  If not, throw an exception.
     // This branch is not a performance penalty, as the CPU should predict
     // this one correctly ~100% of the time.
@@ -31,11 +31,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/XCDFBlockData.h>
 #include <xcdf/XCDFFieldDataBase.h>
+#include <xcdf/XCDFQuantize.h>
 
 #include <string>
 #include <cmath>
 #include <stdint.h>
-#include <deque>
+#include <vector>
 #include <functional>
 
 /*!
@@ -96,6 +97,8 @@ class XCDFFieldData : public XCDFFieldDataBase {
                                    globalMinSet_(false),
                                    globalMaxSet_(false),
                                    activeSize_(SIZE_UNSET),
+                                   stashIndex_(0),
+                                   quantizedIndex_(0),
                                    totalBytes_(0),
                                    bitsProcessed_(0) { }
 
@@ -115,17 +118,60 @@ class XCDFFieldData : public XCDFFieldDataBase {
 
     void Add(const T value) {
 
-      // Unset the active size when adding new data
+      // Unset the active size when adding new data.  The active min/max
+      // are calculated over the stash when the block is written.
       activeSize_ = SIZE_UNSET;
-
-      // Check the current value against min/max
-      CheckActiveMin(value);
-      CheckActiveMax(value);
       AddDirect(value);
     }
 
+    void Add(const T* values, size_t n) {
+      activeSize_ = SIZE_UNSET;
+      AddDirect(values, n);
+    }
+
+    /// Make room for n more entries in the current event
+    virtual void Reserve(size_t n) {UNUSED(n);}
+
+    /*
+     * Find the min/max of the stashed block data in one pass and merge
+     * them into the active range.  The active range may already be set,
+     * e.g. from a block read back when appending.
+     */
+    virtual void CalculateActiveRange() {
+
+      size_t n = stash_.size() - stashIndex_;
+      if (n == 0) {
+        return;
+      }
+
+      T min;
+      T max;
+      XCDFRange(&stash_[stashIndex_], n, min, max);
+      CheckActiveMin(min);
+      CheckActiveMax(max);
+    }
+
+    /*
+     * Convert the stashed block data to #resolution units above the
+     * active min.  Requires the final active min and size.
+     */
+    virtual void Quantize() {
+
+      size_t n = stash_.size() - stashIndex_;
+      quantized_.resize(n);
+      quantizedIndex_ = 0;
+      if (n > 0) {
+        XCDFQuantize(&stash_[stashIndex_], n, activeMin_,
+                     resolution_, GetActiveSize(), &quantized_[0]);
+      }
+    }
+
     virtual void Reset() {
       Clear();
+      stash_.clear();
+      stashIndex_ = 0;
+      quantized_.clear();
+      quantizedIndex_ = 0;
       if (minSet_) {
         CheckGlobalMin(activeMin_);
       }
@@ -154,7 +200,12 @@ class XCDFFieldData : public XCDFFieldDataBase {
     virtual void ClearBitsProcessed() {bitsProcessed_ = 0;}
     virtual uint64_t GetBitsProcessed() const {return bitsProcessed_;}
 
-    virtual uint64_t GetStashSize() const {return stash_.size();}
+    /// Account for data copied as whole blocks rather than dumped
+    virtual void AddBitsProcessed(uint64_t bits) {bitsProcessed_ += bits;}
+
+    virtual uint64_t GetStashSize() const {
+      return stash_.size() - stashIndex_;
+    }
 
     /*
      * Get the compressed size of each datum in the field (in bytes)
@@ -287,7 +338,12 @@ class XCDFFieldData : public XCDFFieldDataBase {
     mutable uint32_t activeSize_;
 
     /// Storage for data held in write cache, awaiting max/min limits to be set
-    std::deque<T> stash_;
+    std::vector<T> stash_;
+    size_t stashIndex_;
+
+    /// Stashed data converted to #resolution units, awaiting Dump()
+    std::vector<uint64_t> quantized_;
+    size_t quantizedIndex_;
 
     /// Total bytes used by the field.  We can't just use bitsProcessed
     /// because reading files back must necessarily alter bitsProcessed,
@@ -325,33 +381,76 @@ class XCDFFieldData : public XCDFFieldDataBase {
     }
 
     /*
-     *  Dump a value to the XCDFBlockData
+     *  Load a value from the XCDFBlockData with a fixed active size W.
+     *  Used by the width-specialized decode kernels.
+     */
+    template <unsigned W>
+    T LoadValueFixed(XCDFBlockData& data) {
+      T value = CalculateTypeValue(data.template GetDatumFixed<W>());
+      CheckActiveMax(value);
+      bitsProcessed_ += W;
+      return value;
+    }
+
+    /*
+     *  Load n consecutive values from the XCDFBlockData into out
+     *  using the batch unpacking kernels.
+     */
+    void LoadValues(XCDFBlockData& data, T* out, const unsigned n) {
+
+      if (data.MachineIsBigEndian()) {
+        for (unsigned i = 0; i < n; ++i) {
+          out[i] = LoadValue(data);
+        }
+        return;
+      }
+
+      data.GetData(activeSize_, n, activeMin_, resolution_, out);
+      for (unsigned i = 0; i < n; ++i) {
+        CheckActiveMax(out[i]);
+      }
+      bitsProcessed_ += static_cast<uint64_t>(activeSize_) * n;
+    }
+
+    /*
+     *  Dump the next quantized value to the XCDFBlockData
      */
-    void DumpValue(XCDFBlockData& data, T datum) {
-      data.AddDatum(CalculateIntegerValue(datum), GetActiveSize());
+    void DumpValue(XCDFBlockData& data) {
+      data.AddDatum(quantized_[quantizedIndex_++], GetActiveSize());
       bitsProcessed_ += activeSize_;
     }
 
+    /*
+     *  Release write cache memory
+     */
+    void ShrinkStash() {
+      std::vector<T>().swap(stash_);
+      std::vector<uint64_t>().swap(quantized_);
+      stashIndex_ = 0;
+      quantizedIndex_ = 0;
+    }
+
     /*
      *  Add a datum without resetting min/max
      */
     virtual void AddDirect(const T datum) = 0;
 
     /*
-     *  Convert #resolution units between active min and current datum back to
-     *  a field value of the appropriate type.
+     *  Add n data without resetting min/max
      */
-    T CalculateTypeValue(uint64_t datum) const {
-
-      return activeMin_ + resolution_ * datum;
+    virtual void AddDirect(const T* data, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        AddDirect(data[i]);
+      }
     }
 
     /*
-     *  Get the #resolution units between active min and current datum.
+     *  Convert #resolution units between active min and current datum back to
+     *  a field value of the appropriate type.
      */
-    uint64_t CalculateIntegerValue(T datum) const {
+    T CalculateTypeValue(uint64_t datum) const {
 
-      return static_cast<uint64_t>((datum - activeMin_) / resolution_);
+      return activeMin_ + resolution_ * datum;
     }
 
     /*
@@ -426,26 +525,6 @@ XCDFFieldData<double>::CalculateTypeValue(uint64_t datum) const {
   return activeMin_ + resolution_ * datum;
 }
 
-    /*
-     *  Get the #resolution units between active min and current datum.
-     */
-template <>
-inline uint64_t
-XCDFFieldData<double>::CalculateIntegerValue(double datum) const {
-
-  // Write out entire double if required by the data (e.g. inf, NaN)
-  if (activeSize_ == 64) {
-    return XCDFSafeTypePun<double, uint64_t>(datum);
-  }
-
-  /*
-   *   Add half of resolution to interval to be sure
-   *   values are rounded correctly.
-   */
-  double interval = (datum - activeMin_) / resolution_ + 0.5;
-  return static_cast<const uint64_t>(interval);
-}
-
     /*
      * Specialization to calculate the number of bits needed
      * to represent the field in the case of floating point
@@ -30,6 +30,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/XCDFPtr.h>
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/XCDFBlockData.h>
+#include <xcdf/XCDFDecodePlan.h>
 
 #include <string>
 #include <cmath>
@@ -58,6 +59,8 @@ class XCDFFieldDataBase {
     virtual void Clear() = 0;
     virtual uint64_t GetStashSize() const = 0;
     virtual void ZeroAlign() = 0;
+    virtual void CalculateActiveRange() = 0;
+    virtual void Quantize() = 0;
     virtual void SetActiveSize(const uint32_t activeSize) = 0;
     virtual void Shrink() = 0;
     virtual void Reset() = 0;
@@ -74,9 +77,15 @@ class XCDFFieldDataBase {
     virtual void SetRawGlobalMax(uint64_t rawGlobalMax) = 0;
     virtual void SetTotalBytes(uint64_t totalBytes) = 0;
     virtual void ClearBitsProcessed() = 0;
+    virtual uint64_t GetBitsProcessed() const = 0;
+    virtual void AddBitsProcessed(uint64_t bits) = 0;
     virtual void CalculateGlobals() = 0;
     virtual bool GlobalsSet() const = 0;
 
+    /// Get a decode kernel specialized for the current active size.
+    /// Default is a thin wrapper around Load().
+    virtual XCDFDecodeKernel GetDecodeKernel() const;
+
     XCDFFieldType GetType() const {return type_;}
 
     const std::string& GetName() const {return name_;}
@@ -93,6 +102,13 @@ class XCDFFieldDataBase {
       return NULL;
     }
 
+    /// Get the index of the parent entry that owns the given entry
+    virtual unsigned GetParentIndex(const unsigned index) const {
+      UNUSED(index);
+      XCDFFatal("GetParentIndex(): Field " << GetName() << " has no parent");
+      return 0;
+    }
+
     /// Simple field type checks
     bool IsUnsignedIntegerField() const {
       return type_ == XCDF_UNSIGNED_INTEGER;
@@ -115,6 +131,15 @@ class XCDFFieldDataBase {
     std::string name_;
 };
 
+/// Fallback decode kernel using virtual dispatch
+inline void XCDFGenericDecode(XCDFFieldDataBase* field, XCDFBlockData& data) {
+  field->Load(data);
+}
+
+inline XCDFDecodeKernel XCDFFieldDataBase::GetDecodeKernel() const {
+  return &XCDFGenericDecode;
+}
+
 typedef XCDFPtr<XCDFFieldDataBase> XCDFFieldDataBasePtr;
 typedef XCDFPtr<const XCDFFieldDataBase> XCDFFieldDataBaseConstPtr;
 
@@ -57,14 +57,26 @@ class XCDFFieldDataScalar : public XCDFFieldData<T> {
 
     virtual void Clear() {hasData_ = 0;}
 
-    virtual void Shrink() { }
+    virtual void Shrink() {XCDFFieldData<T>::ShrinkStash();}
 
     virtual void Load(XCDFBlockData& data) {
       hasData_ = 1;
       datum_ = XCDFFieldData<T>::LoadValue(data);
     }
+    /// Load with the active size known at compile time
+    template <unsigned W>
+    void DecodeFixed(XCDFBlockData& data) {
+      hasData_ = 1;
+      datum_ = XCDFFieldData<T>::template LoadValueFixed<W>(data);
+    }
+
+    virtual XCDFDecodeKernel GetDecodeKernel() const {
+      return GetFixedWidthKernel<XCDFFieldDataScalar<T> >(
+                                 XCDFFieldData<T>::GetActiveSize());
+    }
+
     virtual void Dump(XCDFBlockData& data) {
-      XCDFFieldData<T>::DumpValue(data, datum_);
+      XCDFFieldData<T>::DumpValue(data);
       hasData_ = 0;
     }
 
@@ -74,8 +86,7 @@ class XCDFFieldDataScalar : public XCDFFieldData<T> {
     }
     virtual void Unstash() {
       hasData_ = 1;
-      datum_ = XCDFFieldData<T>::stash_.front();
-      XCDFFieldData<T>::stash_.pop_front();
+      datum_ = XCDFFieldData<T>::stash_[XCDFFieldData<T>::stashIndex_++];
     }
 
     virtual unsigned GetSize() const {return hasData_;}
@@ -33,6 +33,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <string>
 #include <stdint.h>
 #include <algorithm>
+#include <vector>
 
 /*!
  * @class XCDFFieldDataVector
@@ -51,42 +52,52 @@ class XCDFFieldDataVector : public XCDFFieldData<T> {
                         const T res,
                         const XCDFFieldData<uint64_t>* parent) :
                                        XCDFFieldData<T>(type, name, res),
-                                       parent_(parent) { }
+                                       parent_(parent),
+                                       parentIndexValid_(false) { }
 
     typedef typename XCDFFieldData<T>::ConstIterator ConstIterator;
 
     virtual ~XCDFFieldDataVector() { }
 
-    virtual void Clear() {data_.Clear();}
+    virtual void Clear() {
+      data_.Clear();
+      parentIndexValid_ = false;
+    }
+
+    virtual void Shrink() {
+      data_.Shrink();
+      XCDFFieldData<T>::ShrinkStash();
+    }
 
-    virtual void Shrink() {data_.Shrink();}
+    virtual void Reserve(size_t n) {data_.Reserve(n);}
 
     virtual void Load(XCDFBlockData& data) {
-      data_.Clear();
+      Clear();
       unsigned cnt = GetExpectedSize();
-      for (unsigned i = 0; i < cnt; ++i) {
-        data_.Push(XCDFFieldData<T>::LoadValue(data));
-      }
+      XCDFFieldData<T>::LoadValues(data, data_.Extend(cnt), cnt);
     }
+
     virtual void Dump(XCDFBlockData& data) {
-      for (ConstIterator it = Begin(); it != End(); ++it) {
-        XCDFFieldData<T>::DumpValue(data, *it);
+      unsigned cnt = GetSize();
+      for (unsigned i = 0; i < cnt; ++i) {
+        XCDFFieldData<T>::DumpValue(data);
       }
       data_.Clear();
     }
 
     virtual void Stash() {
-      for (ConstIterator it = Begin(); it != End(); ++it) {
-        XCDFFieldData<T>::stash_.push_back(*it);
-      }
+      XCDFFieldData<T>::stash_.insert(
+                    XCDFFieldData<T>::stash_.end(), Begin(), End());
       data_.Clear();
     }
     virtual void Unstash() {
-      data_.Clear();
+      Clear();
       unsigned cnt = GetExpectedSize();
-      for (unsigned i = 0; i < cnt; ++i) {
-        data_.Push(XCDFFieldData<T>::stash_.front());
-        XCDFFieldData<T>::stash_.pop_front();
+      if (cnt > 0) {
+        const T* begin =
+              &XCDFFieldData<T>::stash_[XCDFFieldData<T>::stashIndex_];
+        std::copy(begin, begin + cnt, data_.Extend(cnt));
+        XCDFFieldData<T>::stashIndex_ += cnt;
       }
     }
 
@@ -106,6 +117,22 @@ class XCDFFieldDataVector : public XCDFFieldData<T> {
     /// Get the parent field
     virtual const XCDFFieldData<uint64_t>* GetParent() const {return parent_;}
 
+    /*
+     * Get the index of the parent entry that owns the given entry.  The
+     * lookup table is built once per event on first use, so lookups are
+     * constant time rather than a walk over the parent counts.
+     */
+    virtual unsigned GetParentIndex(const unsigned index) const {
+      if (!parentIndexValid_) {
+        BuildParentIndex();
+      }
+      if (index >= parentIndex_.size()) {
+        XCDFFatal("GetParentIndex(): Trying to access index " << index <<
+                     " of field " << XCDFFieldData<T>::GetName());
+      }
+      return parentIndex_[index];
+    }
+
     /// Get the parent field name.  Use the empty string to denote no parent.
     virtual const std::string& GetParentName() const {
       return parent_->GetName();
@@ -141,13 +168,29 @@ class XCDFFieldDataVector : public XCDFFieldData<T> {
 
         void Clear() {next_ = begin_;}
         void Shrink() {Reallocate(Size());}
-        unsigned Size() const {return next_ - begin_;}
+        size_t Size() const {return next_ - begin_;}
         void Swap(SSVector<U>& v) {
           std::swap(v.begin_, begin_);
           std::swap(v.next_, next_);
+          std::swap(v.last_, last_);
         }
         const U* Begin() const {return begin_;}
         const U* End() const {return next_;}
+        /// Grow by n elements and return a pointer to the new space
+        U* Extend(size_t n) {
+          if (next_ + n > last_) {
+            Reallocate(std::max(Size() * 2 + 1, Size() + n));
+          }
+          U* out = next_;
+          next_ += n;
+          return out;
+        }
+        /// Ensure space for n more elements without further reallocation
+        void Reserve(size_t n) {
+          if (next_ + n > last_) {
+            Reallocate(Size() + n);
+          }
+        }
         void Push(const U& t) {
           if (next_ == last_) {
             // Double our space
@@ -156,14 +199,14 @@ class XCDFFieldDataVector : public XCDFFieldData<T> {
           *next_ = t;
           ++next_;
         }
-        const U& operator[](unsigned i) const {
+        const U& operator[](size_t i) const {
           return *(begin_ + i);
         }
 
       private:
 
-        void Reallocate(unsigned size) {
-          unsigned elementCount = std::min(size, Size());
+        void Reallocate(size_t size) {
+          size_t elementCount = std::min(size, Size());
           U* newBegin = NULL;
           if (size > 0) {
             newBegin = (U*)malloc(size * sizeof(T));
@@ -194,10 +237,34 @@ class XCDFFieldDataVector : public XCDFFieldData<T> {
     /// Parent field
     const XCDFFieldData<uint64_t>* parent_;
 
+    /// Parent entry index for each entry in the current event
+    mutable std::vector<unsigned> parentIndex_;
+    mutable bool parentIndexValid_;
+
+    void BuildParentIndex() const {
+      parentIndex_.clear();
+      unsigned parentSize = parent_->GetSize();
+      for (unsigned i = 0; i < parentSize; ++i) {
+        parentIndex_.insert(parentIndex_.end(), parent_->At(i), i);
+      }
+      parentIndexValid_ = true;
+    }
+
     /*
      *  Add a datum to storage
      */
-    virtual void AddDirect(const T datum) {data_.Push(datum);}
+    virtual void AddDirect(const T datum) {
+      data_.Push(datum);
+      parentIndexValid_ = false;
+    }
+
+    /*
+     *  Add n data to storage in one copy
+     */
+    virtual void AddDirect(const T* data, size_t n) {
+      std::copy(data, data + n, data_.Extend(n));
+      parentIndexValid_ = false;
+    }
 
 };
 
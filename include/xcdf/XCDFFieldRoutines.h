@@ -33,6 +33,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 void ShrinkField(XCDFFieldDataBase& base) {base.Shrink();}
 void ResetField(XCDFFieldDataBase& base) {base.Reset();}
 void ZeroAlignField(XCDFFieldDataBase& base) {base.ZeroAlign();}
+void CalculateActiveRangeField(XCDFFieldDataBase& base) {
+  base.CalculateActiveRange();
+}
+void QuantizeField(XCDFFieldDataBase& base) {base.Quantize();}
 void StashField(XCDFFieldDataBase& base) {base.Stash();}
 void UnstashField(XCDFFieldDataBase& base) {base.Unstash();}
 void CalculateGlobals(XCDFFieldDataBase& base) {base.CalculateGlobals();}
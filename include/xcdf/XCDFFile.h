@@ -34,10 +34,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <xcdf/XCDFFrame.h>
 #include <xcdf/XCDFBlockData.h>
+#include <xcdf/XCDFDecodePlan.h>
 #include <xcdf/XCDFBlockHeader.h>
 #include <xcdf/XCDFFileTrailer.h>
 #include <xcdf/XCDFFileHeader.h>
 #include <xcdf/XCDFField.h>
+#include <xcdf/XCDFNarrowField.h>
 #include <xcdf/XCDFFieldHeader.h>
 #include <xcdf/XCDFFieldDataAllocator.h>
 #include <xcdf/XCDFBlockEntry.h>
@@ -106,6 +108,16 @@ class XCDFFile {
       return Open(fileName.c_str(), mode.c_str());
     }
 
+    /*
+     *  Create an independent reader of the same on-disk file.  The clone
+     *  copies the parsed header, block table and field globals from this
+     *  file rather than re-reading them, and has its own stream, decode
+     *  buffers and field data.  Clones share no state with this file or
+     *  with each other, so each may be used from its own thread.  Create
+     *  the clones from one thread before starting the workers.
+     */
+    XCDFPtr<XCDFFile> CloneReader() const;
+
     /// Open the file, reading from the provided istream
     void Open(std::istream& istream) {
 
@@ -150,6 +162,17 @@ class XCDFFile {
      */
     int Write();
 
+    /*
+     *   Copy all blocks of source into this file without decoding and
+     *   re-encoding the events.  The compressed block frames are written
+     *   verbatim; only the block table and trailer are rebuilt.  The fields
+     *   of both files must match in name, type, resolution, parent and
+     *   order, and source must be the current XCDF version with no events
+     *   read yet.  Return false, copying nothing, if the blocks cannot be
+     *   copied; use Read()/Write() in that case.
+     */
+    bool CopyBlocks(XCDFFile& source);
+
     /*
      *   Read in the next event.  Return:
      *
@@ -164,6 +187,10 @@ class XCDFFile {
     /// Return the total number of events in the file
     uint64_t GetEventCount();
 
+    /// True if the block table has been read, so that Seek() goes
+    /// directly to the block holding the event
+    bool HasBlockTable() const {return blockTableComplete_;}
+
     /// Return the number of the current event
     uint64_t GetCurrentEventNumber() const {
 
@@ -183,6 +210,22 @@ class XCDFFile {
     /// Return the number of the current block
     uint64_t GetCurrentBlockNumber() const {return blockCount_;}
 
+    /// Return a value that changes each time a new block is loaded
+    uint64_t GetBlockGeneration() const {return blockGeneration_;}
+
+    /// Return the number of events left to read in the current block
+    uint64_t GetBlockEventsRemaining() const {return blockEventCount_;}
+
+    /// Skip the events remaining in the current block without decoding
+    /// them.  The next call to Read() loads the following block.
+    void SkipBlock() {
+      if (!IsReadable()) {
+        XCDFFatal("Must be in read mode to skip a block");
+      }
+      eventCount_ += blockEventCount_;
+      blockEventCount_ = 0;
+    }
+
     /// Return the file to a state where calling Read() gives the
     /// starting event, if possible.
     bool Rewind();
@@ -302,6 +345,26 @@ class XCDFFile {
                                            **FindFieldByName(name, true));
     }
 
+    /*
+     *  Narrow read-only views of fields.  Values are converted on access.
+     *  No range check is made: out-of-range values behave as static_cast.
+     */
+    XCDFFloatField GetFloatField(const std::string& name) const {
+      return XCDFFloatField(GetFloatingPointField(name));
+    }
+    XCDFInt32Field GetInt32Field(const std::string& name) const {
+      return XCDFInt32Field(GetSignedIntegerField(name));
+    }
+    XCDFUInt32Field GetUInt32Field(const std::string& name) const {
+      return XCDFUInt32Field(GetUnsignedIntegerField(name));
+    }
+    XCDFUInt8Field GetUInt8Field(const std::string& name) const {
+      return XCDFUInt8Field(GetUnsignedIntegerField(name));
+    }
+    XCDFBoolField GetBoolField(const std::string& name) const {
+      return XCDFBoolField(GetUnsignedIntegerField(name));
+    }
+
     std::vector<XCDFFieldDescriptor>::const_iterator
     FieldDescriptorsBegin() const {return fileHeader_.FieldDescriptorsBegin();}
 
@@ -552,7 +615,7 @@ class XCDFFile {
 
     void CreateAlias(const std::string& name, const std::string& expression) {
       CheckName(name);
-      XCDFFieldAliasBasePtr ptr = AllocateFieldAlias(name, expression, *this);
+      XCDFFieldAliasBasePtr ptr = NewAlias(name, expression);
       aliasList_.push_back(ptr);
       if (headerWritten_) {
         fileTrailer_.AddAliasDescriptor(GetXCDFAliasDescriptor(*ptr));
@@ -624,6 +687,12 @@ class XCDFFile {
     uint64_t blockCount_;
     uint32_t blockEventCount_;
 
+    // Incremented for each event read.  eventGeneration_ identifies the
+    // current event for alias caching and is zero unless reading.
+    uint64_t generationCounter_;
+    uint64_t eventGeneration_;
+    uint64_t blockGeneration_;
+
     // Internal state controllers
     bool isModifiable_;
     bool blockTableComplete_;
@@ -650,22 +719,29 @@ class XCDFFile {
     XCDFBlockData   blockData_;
     XCDFFileTrailer fileTrailer_;
 
+    // Per-block field decode kernels
+    XCDFDecodePlan decodePlan_;
+
     // I/O streams
     XCDFStreamHandler streamHandler_;
 
     void Init();
-    void WriteFrame();
-    void ReadFrame();
+    void WriteFrame() {WriteFrame(currentFrame_);}
+    void WriteFrame(XCDFFrame& frame);
+    void ReadFrame(bool inflate = true);
     void WriteBlock();
     void WriteEvent();
     void ReadEvent();
-    bool ReadNextBlock();
+    bool ReadNextBlock(bool unpackData = true);
     bool GetNextBlockWithEvents();
     bool DoSeek(const std::streampos& pos);
     void ReadFileHeaders();
+    void OpenClone(const XCDFFile& source);
     void LoadFileHeader(XCDFFileHeader& header);
     void LoadFileTrailer(XCDFFileTrailer& trailer);
     void CopyTrailer(const XCDFFileTrailer& trailer);
+    bool CanCopyBlocks(const XCDFFile& source) const;
+    void MergeGlobals(const XCDFFile& source, bool decoded);
     void SetGlobals(const XCDFFileTrailer& trailer);
     void CheckGlobals();
     bool NextFrameExists();
@@ -737,6 +813,14 @@ class XCDFFile {
       return it;
     }
 
+    // Aliases cache their values until the next event is read
+    XCDFFieldAliasBasePtr NewAlias(const std::string& name,
+                                   const std::string& expression) {
+      XCDFFieldAliasBasePtr ptr = AllocateFieldAlias(name, expression, *this);
+      ptr->SetEventGeneration(&eventGeneration_);
+      return ptr;
+    }
+
     template<typename T>
     void LoadNewAliases(const T& t) {
       for (std::vector<XCDFAliasDescriptor>::const_iterator
@@ -745,7 +829,7 @@ class XCDFFile {
         if (!fileHeader_.HasAliasDescriptor(*it)) {
           fileHeader_.AddAliasDescriptor(*it);
           XCDFFieldAliasBasePtr ptr =
-              AllocateFieldAlias(it->GetName(), it->GetExpression(), *this);
+              NewAlias(it->GetName(), it->GetExpression());
           aliasList_.push_back(ptr);
         }
       }
@@ -757,7 +841,7 @@ class XCDFFile {
                        it = t.AliasDescriptorsBegin();
                        it != t.AliasDescriptorsEnd(); ++it) {
         XCDFFieldAliasBasePtr ptr =
-            AllocateFieldAlias(it->GetName(), it->GetExpression(), *this);
+            NewAlias(it->GetName(), it->GetExpression());
         aliasList_.push_back(ptr);
       }
     }
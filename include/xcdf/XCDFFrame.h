@@ -61,6 +61,7 @@ class XCDFFrame {
   public:
 
     XCDFFrame() : type_(XCDF_NONE),
+                  deflated_(false),
                   machineIsBigEndian_(TestBigEndian()) { }
 
     ~XCDFFrame() { }
@@ -70,11 +71,16 @@ class XCDFFrame {
     XCDFFrameType GetType() const {return type_;}
     void SetType(const XCDFFrameType type) {type_ = type;}
 
+    /// True if the payload was read without inflation and is still
+    /// compressed.  Such a frame is written back out verbatim.
+    bool IsDeflated() const {return deflated_;}
+
     void Write(std::ostream& o, bool deflate) {
 
-      if (deflate) {
+      if (deflate && !deflated_) {
         buffer_.Deflate();
       }
+      deflate = deflate || deflated_;
 
       uint32_t deflatedType = XCDF_DEFLATED_FRAME;
       uint32_t type = type_;
@@ -105,10 +111,12 @@ class XCDFFrame {
       }
 
       buffer_.Clear();
+      deflated_ = false;
     }
 
-    // Verify frame type before allocating and reading data
-    void Read(std::istream& i) {
+    // Verify frame type before allocating and reading data.  If inflate
+    // is false, a deflated payload is left compressed (see Inflate()).
+    void Read(std::istream& i, bool inflate = true) {
 
       uint32_t type, size, checksum;
       i.read(reinterpret_cast<char*>(&type), 4);
@@ -131,6 +139,7 @@ class XCDFFrame {
       }
 
       type_ = static_cast<XCDFFrameType>(type);
+      deflated_ = false;
 
       if (i.fail()) {
         return;
@@ -159,7 +168,19 @@ class XCDFFrame {
       }
 
       if (deflated) {
+        if (inflate) {
+          buffer_.Inflate();
+        } else {
+          deflated_ = true;
+        }
+      }
+    }
+
+    /// Inflate a payload left compressed by Read()
+    void Inflate() {
+      if (deflated_) {
         buffer_.Inflate();
+        deflated_ = false;
       }
     }
 
@@ -211,7 +232,7 @@ class XCDFFrame {
       return reinterpret_cast<const char*>(buffer_.Get(size));
     }
 
-    void Clear() {buffer_.Clear();}
+    void Clear() {buffer_.Clear(); deflated_ = false;}
 
     const char* GetData() {
       if (buffer_.GetSize() == 0) {
@@ -229,6 +250,7 @@ class XCDFFrame {
 
     XCDFFrameType type_;
     XCDFFrameBuffer buffer_;
+    bool deflated_;
     bool machineIsBigEndian_;
 
     void ConvertEndian(uint32_t& datum) const {
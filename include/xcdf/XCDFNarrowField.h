@@ -0,0 +1,104 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_NARROW_FIELD_INCLUDED_H
+#define XCDF_NARROW_FIELD_INCLUDED_H
+
+#include <xcdf/XCDFDefs.h>
+#include <xcdf/XCDFField.h>
+
+#include <vector>
+#include <stdint.h>
+
+/*!
+ * @class XCDFNarrowField
+ * @author Jim Braun
+ * @brief Read-only view of an XCDF field as a narrower type S (e.g. float,
+ * int32_t, bool).  Values are converted with static_cast on access; the
+ * on-disk packing is unchanged.  CopyTo() converts a whole event in one
+ * loop, so decoded vectors can be held in user arrays of 1-4 bytes per
+ * entry rather than 8.
+ */
+
+template <typename S, typename T>
+class XCDFNarrowField {
+
+  public:
+
+    typedef S ValueType;
+
+    XCDFNarrowField(const ConstXCDFField<T>& field) : field_(field) { }
+
+    /// Allow default construction, but use of the default-constructed
+    /// object is not allowed
+    XCDFNarrowField() { }
+
+    const std::string& GetName() const {return field_.GetName();}
+    bool HasParent() const {return field_.HasParent();}
+    const std::string& GetParentName() const {return field_.GetParentName();}
+
+    /// Get the number of entries in the field in the current event
+    unsigned GetSize() const {return field_.GetSize();}
+
+    /// Get a value from the field
+    S At(const uint32_t index) const {return static_cast<S>(field_[index]);}
+    S operator[](const uint32_t index) const {return At(index);}
+    S operator*() const {return At(0);}
+
+    /// Convert the current event into out, which must hold GetSize() entries
+    void CopyTo(S* out) const {
+      const T* begin = field_.Begin();
+      const unsigned n = field_.End() - begin;
+      for (unsigned i = 0; i < n; ++i) {
+        out[i] = static_cast<S>(begin[i]);
+      }
+    }
+
+    /// Convert the current event into out, reusing its storage.  Indexes
+    /// out rather than taking its data pointer, so std::vector<bool> works.
+    void CopyTo(std::vector<S>& out) const {
+      const T* begin = field_.Begin();
+      out.resize(field_.End() - begin);
+      for (unsigned i = 0; i < out.size(); ++i) {
+        out[i] = static_cast<S>(begin[i]);
+      }
+    }
+
+    /// Get the underlying full-width field
+    const ConstXCDFField<T>& GetField() const {return field_;}
+
+  private:
+
+    ConstXCDFField<T> field_;
+};
+
+typedef XCDFNarrowField<float, double>     XCDFFloatField;
+typedef XCDFNarrowField<int32_t, int64_t>  XCDFInt32Field;
+typedef XCDFNarrowField<uint32_t, uint64_t> XCDFUInt32Field;
+typedef XCDFNarrowField<uint8_t, uint64_t> XCDFUInt8Field;
+typedef XCDFNarrowField<bool, uint64_t>    XCDFBoolField;
+
+#endif // XCDF_NARROW_FIELD_INCLUDED_H
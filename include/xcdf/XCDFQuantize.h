@@ -0,0 +1,265 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_QUANTIZE_INCLUDED_H
+#define XCDF_QUANTIZE_INCLUDED_H
+
+#include <xcdf/XCDFDefs.h>
+#include <xcdf/XCDFBitUnpack.h>
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdint.h>
+
+/*
+ *  Block-close kernels for the write path.  XCDFRange computes the min and
+ *  max of a block of stashed values in one pass, and XCDFQuantize converts
+ *  the values to #resolution units above the active min.  Both produce
+ *  exactly the results of the per-value calculations they replace.
+ */
+
+/*
+ *  Range of integer values.  Ties keep the first value seen, matching the
+ *  per-value min/max checks.
+ */
+template <typename T>
+inline void XCDFRange(const T* data, const size_t n, T& min, T& max) {
+
+  min = data[0];
+  max = data[0];
+  for (size_t i = 1; i < n; ++i) {
+    min = data[i] < min ? data[i] : min;
+    max = data[i] > max ? data[i] : max;
+  }
+}
+
+#ifdef XCDF_HAVE_AVX2_KERNELS
+
+/*
+ *  AVX2 double range.  MINPD/MAXPD return the second operand on equality or
+ *  NaN, so the accumulators ignore NaNs, which are tracked separately.
+ *  Returns true if a NaN was found.
+ */
+__attribute__((target("avx2")))
+inline bool XCDFRangeAVX2(const double* data, const size_t n,
+                          double& min, double& max) {
+
+  __m256d vmin = _mm256_set1_pd(data[0]);
+  __m256d vmax = vmin;
+  __m256d nan = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_loadu_pd(data + i);
+    vmin = _mm256_min_pd(v, vmin);
+    vmax = _mm256_max_pd(v, vmax);
+    nan = _mm256_or_pd(nan, _mm256_cmp_pd(v, v, _CMP_UNORD_Q));
+  }
+
+  double mins[4];
+  double maxs[4];
+  _mm256_storeu_pd(mins, vmin);
+  _mm256_storeu_pd(maxs, vmax);
+  bool hasNaN = _mm256_movemask_pd(nan) != 0;
+  min = mins[0];
+  max = maxs[0];
+  for (unsigned j = 1; j < 4; ++j) {
+    min = mins[j] < min ? mins[j] : min;
+    max = maxs[j] > max ? maxs[j] : max;
+  }
+  for (; i < n; ++i) {
+    min = data[i] < min ? data[i] : min;
+    max = data[i] > max ? data[i] : max;
+    hasNaN = hasNaN || std::isnan(data[i]);
+  }
+  return hasNaN;
+}
+
+#endif // XCDF_HAVE_AVX2_KERNELS
+
+/*
+ *  Range of double values.  Any NaN makes both min and max NaN, as with
+ *  the per-value checks.
+ */
+inline void XCDFRange(const double* data, const size_t n,
+                      double& min, double& max) {
+
+  bool hasNaN = false;
+#ifdef XCDF_HAVE_AVX2_KERNELS
+  if (n >= 4 && XCDFCPUHasAVX2()) {
+    hasNaN = XCDFRangeAVX2(data, n, min, max);
+  } else
+#endif
+  {
+    min = data[0];
+    max = data[0];
+    for (size_t i = 0; i < n; ++i) {
+      min = data[i] < min ? data[i] : min;
+      max = data[i] > max ? data[i] : max;
+      hasNaN = hasNaN || std::isnan(data[i]);
+    }
+  }
+
+  if (hasNaN) {
+    min = max = std::numeric_limits<double>::quiet_NaN();
+    return;
+  }
+
+  // Equal values are interchangeable except for signed zeros.  Keep the
+  // first one seen, independent of the reduction order.
+  if (min == 0.) {
+    for (size_t i = 0; i < n; ++i) {
+      if (data[i] == 0.) {
+        min = data[i];
+        break;
+      }
+    }
+  }
+  if (max == 0.) {
+    for (size_t i = 0; i < n; ++i) {
+      if (data[i] == 0.) {
+        max = data[i];
+        break;
+      }
+    }
+  }
+}
+
+/// Check for an exact power of two
+inline bool XCDFIsPowerOfTwo(const uint64_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+inline void XCDFQuantize(const uint64_t* data, const size_t n,
+                         const uint64_t activeMin, const uint64_t resolution,
+                         const unsigned activeSize, uint64_t* out) {
+  UNUSED(activeSize);
+  if (resolution == 1) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = data[i] - activeMin;
+    }
+  } else if (XCDFIsPowerOfTwo(resolution)) {
+    unsigned shift = 0;
+    while ((static_cast<uint64_t>(1) << shift) != resolution) {
+      ++shift;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (data[i] - activeMin) >> shift;
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = (data[i] - activeMin) / resolution;
+    }
+  }
+}
+
+inline void XCDFQuantize(const int64_t* data, const size_t n,
+                         const int64_t activeMin, const int64_t resolution,
+                         const unsigned activeSize, uint64_t* out) {
+  UNUSED(activeSize);
+  if (resolution == 1) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = static_cast<uint64_t>(data[i] - activeMin);
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = static_cast<uint64_t>((data[i] - activeMin) / resolution);
+    }
+  }
+}
+
+#ifdef XCDF_HAVE_AVX2_KERNELS
+
+/*
+ *  AVX2 double quantization for active sizes up to 52 bits.  The
+ *  interval is below 2^52, so truncation followed by the 2^52 exponent
+ *  trick gives the exact integer.  When useReciprocal is set, the
+ *  reciprocal is exact and the multiply matches the divide bit-for-bit.
+ */
+__attribute__((target("avx2")))
+inline size_t XCDFQuantizeAVX2(const double* data, const size_t n,
+                               const double activeMin,
+                               const double resolution,
+                               const bool useReciprocal, uint64_t* out) {
+
+  const __m256d min = _mm256_set1_pd(activeMin);
+  const __m256d res = _mm256_set1_pd(resolution);
+  const __m256d rinv = _mm256_set1_pd(1. / resolution);
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d magicDouble = _mm256_set1_pd(4503599627370496.0);
+  const __m256i magic = _mm256_set1_epi64x(0x4330000000000000LL);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d v = _mm256_sub_pd(_mm256_loadu_pd(data + i), min);
+    v = useReciprocal ? _mm256_mul_pd(v, rinv) : _mm256_div_pd(v, res);
+    v = _mm256_round_pd(_mm256_add_pd(v, half), _MM_FROUND_TO_ZERO);
+    __m256i datum = _mm256_xor_si256(
+              _mm256_castpd_si256(_mm256_add_pd(v, magicDouble)), magic);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), datum);
+  }
+  return i;
+}
+
+#endif // XCDF_HAVE_AVX2_KERNELS
+
+inline void XCDFQuantize(const double* data, const size_t n,
+                         const double activeMin, const double resolution,
+                         const unsigned activeSize, uint64_t* out) {
+
+  // Write out entire double if required by the data (e.g. inf, NaN)
+  if (activeSize == XCDF_DATUM_WIDTH_BITS) {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = XCDFSafeTypePun<double, uint64_t>(data[i]);
+    }
+    return;
+  }
+
+  // Multiplying by the reciprocal is exact only for powers of two
+  double rinv = 1. / resolution;
+  int exponent;
+  bool useReciprocal = std::frexp(resolution, &exponent) == 0.5 &&
+                       std::isnormal(rinv) && 1. / rinv == resolution;
+
+  size_t done = 0;
+#ifdef XCDF_HAVE_AVX2_KERNELS
+  if (n >= 4 && XCDFCPUHasAVX2()) {
+    done = XCDFQuantizeAVX2(data, n, activeMin,
+                            resolution, useReciprocal, out);
+  }
+#endif
+
+  /*
+   *   Add half of resolution to interval to be sure
+   *   values are rounded correctly.
+   */
+  for (size_t i = done; i < n; ++i) {
+    double interval = useReciprocal ? (data[i] - activeMin) * rinv + 0.5 :
+                                      (data[i] - activeMin) / resolution + 0.5;
+    out[i] = static_cast<uint64_t>(interval);
+  }
+}
+
+#endif // XCDF_QUANTIZE_INCLUDED_H
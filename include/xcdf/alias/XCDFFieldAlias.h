@@ -50,7 +50,8 @@ class XCDFFieldAlias : public XCDFFieldAliasBase {
                    const std::string& expression,
                    const NumericalExpression<T>& ne) :
                               XCDFFieldAliasBase(name, expression),
-                              expression_(ne) { }
+                              expression_(ne),
+                              cache_(new Cache()) { }
 
     virtual XCDFFieldType GetType() const;
     const std::string& GetName() const {return name_;}
@@ -59,20 +60,69 @@ class XCDFFieldAlias : public XCDFFieldAliasBase {
     const Node<T>& GetHeadNode() const {return expression_.GetHeadNode();}
 
     /// Get the number of entries in the expression for the current event
-    unsigned GetSize() const {return expression_.GetSize();}
+    unsigned GetSize() const {
+      return IsCaching() ? Update().size_ : expression_.GetSize();
+    }
 
     /// Get a value from the field
-    T At(const uint32_t index) const {return expression_.Evaluate(index);}
+    T At(const uint32_t index) const {
+      if (!IsCaching()) {
+        return expression_.Evaluate(index);
+      }
+      const Cache& cache = Update();
+      if (index >= cache.size_) {
+        XCDFFatal("Evaluation index: " << index
+                           << " out of range.  Max: " << cache.size_);
+      }
+      return cache.values_[index];
+    }
     T operator[](const uint32_t index) const {
       return At(index);
     }
     T operator*() const {return At(0);}
 
+    /// Evaluate all GetSize() entries for the current event
+    const T* EvaluateBatch() const {
+      return IsCaching() ? Update().values_ : expression_.EvaluateBatch();
+    }
+
+    void SetEventGeneration(const uint64_t* eventGeneration) {
+      cache_->eventGeneration_ = eventGeneration;
+      cache_->generation_ = 0;
+    }
+
   private:
 
+    // Values of the current event, shared among copies of the alias.
+    // The values point into the expression's own output buffer, which
+    // is only overwritten when the expression is evaluated again.
+    struct Cache {
+      Cache() : eventGeneration_(NULL), generation_(0),
+                values_(NULL), size_(0) { }
+      const uint64_t* eventGeneration_;
+      uint64_t generation_;
+      const T* values_;
+      unsigned size_;
+    };
+
     std::string name_;
     std::string expString_;
     NumericalExpression<T> expression_;
+    XCDFPtr<Cache> cache_;
+
+    bool IsCaching() const {
+      return cache_->eventGeneration_ && *(cache_->eventGeneration_) != 0;
+    }
+
+    const Cache& Update() const {
+      Cache& cache = *cache_;
+      if (cache.generation_ != *(cache.eventGeneration_)) {
+        cache.size_ = expression_.GetSize();
+        cache.values_ = expression_.EvaluateBatch();
+        cache.generation_ = *(cache.eventGeneration_);
+      }
+      return cache;
+    }
 };
 
 template<>
@@ -65,6 +65,10 @@ class XCDFFieldAliasBase {
       return GetType() == XCDF_FLOATING_POINT;
     }
 
+    /// Cache evaluated values until the value pointed to by
+    /// eventGeneration changes.  A generation of zero disables caching.
+    virtual void SetEventGeneration(const uint64_t* eventGeneration) = 0;
+
   private:
 
     std::string name_;
@@ -30,55 +30,291 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/utility/Symbol.h>
 #include <xcdf/utility/NodeDefs.h>
 #include <xcdf/utility/Expression.h>
+#include <xcdf/XCDFFile.h>
 #include <xcdf/XCDFPtr.h>
 
 #include <vector>
 #include <list>
 #include <cassert>
 #include <sstream>
-
-// Forward-declare XCDFFile to avoid circular dependency introduced
-// with XCDFFieldAlias.  There should be a cleaner way to code this.
-class XCDFFile;
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 class EventSelectExpression {
 
   public:
 
+    /*
+     * With adaptive set, an expression made of scalar conditions joined
+     * by top-level "&&" is split into its conjuncts.  The pass rate and
+     * cost of each conjunct are measured over the first events, after
+     * which conjuncts are evaluated cheapest and most selective first,
+     * stopping at the first failure.  Only conjuncts that are safe to
+     * evaluate for any event (see Expression::IsTotal) are moved, and
+     * never ahead of a conjunct that is not, so a guard such as
+     * "d != 0 && n / d > 1" keeps protecting the terms after it.  Other
+     * expressions are evaluated as usual.
+     *
+     * Scalar expressions and conjuncts are evaluated through a flat
+     * program (see Expression::Compile) rather than by walking the tree.
+     *
+     * When reading, the expression is checked at the start of each block.
+     * If it depends only on values that are constant within the block,
+     * it is evaluated once for the whole block.
+     */
     EventSelectExpression(const std::string& exp,
-                          const XCDFFile& f) :
-                expression_(xcdf_shared(new Expression(exp, f))) {
+                          const XCDFFile& f,
+                          bool adaptive = false) :
+                expression_(xcdf_shared(new Expression(exp, f))),
+                selectNode_(GetSelectNode(
+                    expression_->Compile(expression_->GetHeadSymbol()), exp)),
+                file_(f),
+                nSampled_(0),
+                blockGeneration_(0),
+                blockConstant_(false),
+                blockResult_(false) {
+
+      if (adaptive) {
+        SplitConjuncts();
+      }
+    }
+
+    // We know AnyNode is always size 1
+    bool SelectEvent() const {
+      if (file_.IsReadable() &&
+          file_.GetBlockGeneration() != blockGeneration_) {
+        blockGeneration_ = file_.GetBlockGeneration();
+        CheckBlockConstant();
+      }
+      if (blockConstant_) {
+        return blockResult_;
+      }
+      if (conjuncts_.size() == 0) {
+        return (*selectNode_)[0];
+      }
+      if (nSampled_ < SAMPLE_EVENTS) {
+        return SampleConjuncts();
+      }
+      for (unsigned i = 0; i < order_.size(); ++i) {
+        const Conjunct& c = conjuncts_[order_[i]];
+        if (!c.blockConstant_ && !(*c.selectNode_)[0]) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    /// True if the last call to SelectEvent() gives the result for
+    /// every remaining event in the current block
+    bool IsBlockConstant() const {return blockConstant_;}
+
+  private:
+
+    // Number of events used to measure the conjuncts before reordering
+    static const unsigned SAMPLE_EVENTS = 4096;
+
+    struct Conjunct {
+      XCDFPtr<Node<uint64_t> > selectNode_;
+      // Safe to evaluate out of the written order
+      bool total_;
+      uint64_t nEvaluated_;
+      uint64_t nPassed_;
+      double time_;
+      // Passes for every event in the current block
+      bool blockConstant_;
+    };
+
+    XCDFPtr<Expression> expression_;
+    XCDFPtr<Node<uint64_t> > selectNode_;
+    mutable std::vector<Conjunct> conjuncts_;
+    // Indices into conjuncts_, in evaluation order.  Reordering moves
+    // indices rather than the conjuncts and the nodes they own.
+    mutable std::vector<unsigned> order_;
+    const XCDFFile& file_;
+    mutable unsigned nSampled_;
+
+    mutable uint64_t blockGeneration_;
+    mutable bool blockConstant_;
+    mutable bool blockResult_;
+
+    static XCDFPtr<Node<uint64_t> > GetSelectNode(Symbol* start,
+                                                  const std::string& exp) {
 
-      Symbol* start = expression_->GetHeadSymbol();
       switch (start->GetType()) {
 
         case FLOATING_POINT_NODE:
-          selectNode_ = XCDFPtr<Node<uint64_t> >(
+          return XCDFPtr<Node<uint64_t> >(
              new AnyNode<double>(*static_cast<Node<double>* >(start)));
-          break;
 
         case SIGNED_NODE:
-          selectNode_ = XCDFPtr<Node<uint64_t> >(
+          return XCDFPtr<Node<uint64_t> >(
              new AnyNode<int64_t>(*static_cast<Node<int64_t>* >(start)));
-          break;
 
         case UNSIGNED_NODE:
-          selectNode_ = XCDFPtr<Node<uint64_t> >(
+          return XCDFPtr<Node<uint64_t> >(
              new AnyNode<uint64_t>(*static_cast<Node<uint64_t>* >(start)));
-          break;
 
         default:
           XCDFFatal("Expression does not evaluate: " << exp);
       }
+
+      // Unreachable
+      return XCDFPtr<Node<uint64_t> >();
     }
 
-    // We know AnyNode is always size 1
-    bool SelectEvent() const {return (*selectNode_)[0];}
+    static bool IsScalar(Symbol* start) {
+      switch (start->GetType()) {
+        case FLOATING_POINT_NODE:
+          return !static_cast<Node<double>* >(start)->HasParent();
+        case SIGNED_NODE:
+          return !static_cast<Node<int64_t>* >(start)->HasParent();
+        case UNSIGNED_NODE:
+          return !static_cast<Node<uint64_t>* >(start)->HasParent();
+        default:
+          return false;
+      }
+    }
 
-  private:
+    // Collect the operands of nested "&&" operations, in written order
+    void CollectConjuncts(Symbol* s, std::vector<Symbol*>& terms) const {
+      if (expression_->GetOperation(s) == LOGICAL_AND) {
+        CollectConjuncts(expression_->GetOperand(s, 0), terms);
+        CollectConjuncts(expression_->GetOperand(s, 1), terms);
+      } else {
+        terms.push_back(s);
+      }
+    }
 
-    XCDFPtr<Expression> expression_;
-    XCDFPtr<Node<uint64_t> > selectNode_;
+    void SplitConjuncts() {
+
+      std::vector<Symbol*> terms;
+      CollectConjuncts(expression_->GetHeadSymbol(), terms);
+      if (terms.size() < 2) {
+        return;
+      }
+
+      // Splitting is only equivalent if every conjunct is a scalar;
+      // vector conjuncts are combined element-by-element.
+      std::vector<Conjunct> conjuncts(terms.size());
+      for (unsigned i = 0; i < terms.size(); ++i) {
+        if (!IsScalar(terms[i])) {
+          return;
+        }
+        conjuncts[i].selectNode_ =
+                   GetSelectNode(expression_->Compile(terms[i]),
+                                 expression_->GetExpressionString());
+        conjuncts[i].total_ = expression_->IsTotal(terms[i]);
+        conjuncts[i].nEvaluated_ = 0;
+        conjuncts[i].nPassed_ = 0;
+        conjuncts[i].time_ = 0.;
+        conjuncts[i].blockConstant_ = false;
+      }
+      conjuncts_.swap(conjuncts);
+      order_.resize(conjuncts_.size());
+      for (unsigned i = 0; i < order_.size(); ++i) {
+        order_[i] = i;
+      }
+    }
+
+    // Evaluate the conjuncts in order up to the first failure, recording
+    // the pass count and cost of each
+    bool SampleConjuncts() const {
+
+      bool pass = true;
+      for (unsigned i = 0; i < order_.size(); ++i) {
+        Conjunct& c = conjuncts_[order_[i]];
+        ++c.nEvaluated_;
+        if (c.blockConstant_) {
+          ++c.nPassed_;
+          continue;
+        }
+        std::chrono::steady_clock::time_point t0 =
+                                        std::chrono::steady_clock::now();
+        bool result = (*c.selectNode_)[0];
+        c.time_ += std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - t0).count();
+        if (!result) {
+          pass = false;
+          break;
+        }
+        ++c.nPassed_;
+      }
+
+      if (++nSampled_ == SAMPLE_EVENTS) {
+        Reorder();
+      }
+      return pass;
+    }
+
+    // Sort each run of consecutive total conjuncts.  A conjunct that is
+    // not total stays behind every conjunct written before it.
+    void Reorder() const {
+      const std::vector<Conjunct>& conjuncts = conjuncts_;
+      std::vector<unsigned>::iterator runStart = order_.begin();
+      while (runStart != order_.end()) {
+        if (!conjuncts[*runStart].total_) {
+          ++runStart;
+          continue;
+        }
+        std::vector<unsigned>::iterator runEnd = runStart;
+        while (runEnd != order_.end() && conjuncts[*runEnd].total_) {
+          ++runEnd;
+        }
+        std::stable_sort(runStart, runEnd,
+                         [&conjuncts](unsigned a, unsigned b) {
+                           return Rank(conjuncts[a]) < Rank(conjuncts[b]);
+                         });
+        runStart = runEnd;
+      }
+    }
+
+    // Called on the first event of each block.  Constant conjuncts that
+    // pass are skipped for the block; one that fails decides the block.
+    // Constant conjuncts that are not total are only evaluated here if
+    // every conjunct before them is constant and passes.
+    void CheckBlockConstant() const {
+
+      blockConstant_ = false;
+      if (conjuncts_.size() == 0) {
+        if (selectNode_->IsBlockConstant()) {
+          blockConstant_ = true;
+          blockResult_ = (*selectNode_)[0];
+        }
+        return;
+      }
+
+      bool allConstant = true;
+      for (unsigned i = 0; i < order_.size(); ++i) {
+        Conjunct& c = conjuncts_[order_[i]];
+        c.blockConstant_ = (c.total_ || allConstant) &&
+                           c.selectNode_->IsBlockConstant();
+        if (!c.blockConstant_) {
+          allConstant = false;
+        } else if (!(*c.selectNode_)[0]) {
+          blockConstant_ = true;
+          blockResult_ = false;
+          return;
+        }
+      }
+      if (allConstant) {
+        blockConstant_ = true;
+        blockResult_ = true;
+      }
+    }
+
+    // Order by cost per rejected event: cheap, selective conjuncts first.
+    // Conjuncts not reached while sampling keep their place.
+    static double Rank(const Conjunct& c) {
+      if (c.nEvaluated_ == 0) {
+        return std::numeric_limits<double>::infinity();
+      }
+      double failRate = 1. - static_cast<double>(c.nPassed_) / c.nEvaluated_;
+      if (failRate <= 0.) {
+        return std::numeric_limits<double>::infinity();
+      }
+      return c.time_ / c.nEvaluated_ / failRate;
+    }
 };
 
 #endif // XCDF_UTILITY_EVENT_SELECT_EXPRESSION_INCLUDED_H
@@ -0,0 +1,342 @@
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_EVENT_SORTER_H_INCLUDED
+#define XCDF_UTILITY_EVENT_SORTER_H_INCLUDED
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/XCDFUtility.h>
+#include <xcdf/utility/MergeReader.h>
+#include <xcdf/utility/NumericalExpression.h>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include <unistd.h>
+
+// Most runs merged at once, each holding an open file
+const unsigned DEFAULT_MAX_MERGE_RUNS = 256;
+
+/*
+ *  Temporary files, removed when the object goes away
+ */
+class TempFiles {
+
+  public:
+
+    TempFiles() { }
+
+    ~TempFiles() {
+      for (unsigned i = 0; i < names_.size(); ++i) {
+        unlink(names_[i].c_str());
+      }
+    }
+
+    /// Create a new empty file in $TMPDIR (or /tmp) and return its name
+    const std::string& Create() {
+
+      const char* dir = getenv("TMPDIR");
+      std::string name = (dir && *dir) ? dir : "/tmp";
+      name += "/xcdf-XXXXXX";
+      std::vector<char> buf(name.begin(), name.end());
+      buf.push_back('\0');
+      int fd = mkstemp(&buf[0]);
+      if (fd < 0) {
+        XCDFFatal("Unable to create temporary file " << name);
+      }
+      close(fd);
+      names_.push_back(&buf[0]);
+      return names_.back();
+    }
+
+    unsigned GetNFiles() const {return names_.size();}
+    const std::string& GetName(unsigned i) const {return names_[i];}
+
+  private:
+
+    std::vector<std::string> names_;
+
+    TempFiles(const TempFiles&);
+    TempFiles& operator=(const TempFiles&);
+};
+
+/// Copy the given fields of all events of reader, in key order, to out
+template <typename Key>
+void CopyMerged(MergeReader<Key>& reader,
+                XCDFFile& out,
+                std::set<std::string>& fields) {
+
+  std::vector<XCDFPtr<FieldCopyBuffer> > bufs;
+  for (unsigned i = 0; i < reader.GetNFiles(); ++i) {
+    bufs.push_back(xcdf_shared(new FieldCopyBuffer(out)));
+    SelectFieldVisitor selectFieldVisitor(reader.GetFile(i), fields, *bufs[i]);
+    reader.GetFile(i).ApplyFieldVisitor(selectFieldVisitor);
+  }
+
+  while (reader.Read()) {
+    bufs[reader.GetCurrentFileIndex()]->CopyData();
+    out.Write();
+  }
+}
+
+/*
+ *  Sorts events by the value of a key expression, keeping the input
+ *  order of events with equal keys.  Events are held in memory until
+ *  they exceed maxMemory bytes, then sorted and written to a temporary
+ *  file (a run) together with their keys.  Finish() sorts the events in
+ *  memory, or merges all runs into the output file.  With more than
+ *  maxMergeRuns runs, groups of runs are first merged into longer runs so
+ *  that no more than maxMergeRuns files are open at once.  Key is the
+ *  type of the expression, so integer keys are compared exactly.
+ */
+template <typename Key>
+class EventSorter {
+
+  public:
+
+    EventSorter(XCDFFile& outFile,
+                const std::string& exp,
+                size_t maxMemory,
+                unsigned maxMergeRuns = DEFAULT_MAX_MERGE_RUNS) :
+                                           outFile_(outFile),
+                                           exp_(exp),
+                                           maxMemory_(maxMemory),
+                                           maxMergeRuns_(maxMergeRuns) {
+
+      if (maxMergeRuns_ < 2) {
+        XCDFFatal("At least two sort runs must be merged at once");
+      }
+    }
+
+    /// Read all events of f into the sorter
+    void Add(XCDFFile& f) {
+
+      // The output has the fields of the first file
+      if (buffer_.IsNull()) {
+        GetFieldNamesVisitor getFieldNamesVisitor(fields_);
+        f.ApplyFieldVisitor(getFieldNamesVisitor);
+        buffer_ = xcdf_shared(new EventBuffer(f, fields_));
+
+        FieldCopyBuffer buf(outFile_);
+        SelectFieldVisitor selectFieldVisitor(f, fields_, buf);
+        f.ApplyFieldVisitor(selectFieldVisitor);
+
+        keyName_ = "sortKey";
+        while (fields_.find(keyName_) != fields_.end()) {
+          keyName_ += "_";
+        }
+      } else {
+        buffer_->SetSource(f);
+      }
+
+      NumericalExpression<Key> key(exp_, f);
+      while (f.Read()) {
+
+        if (key.GetSize() != 1) {
+          XCDFFatal("Sort key \"" << exp_ << "\" has " << key.GetSize() <<
+                                          " values in event, expected 1");
+        }
+        keys_.push_back(key.Evaluate());
+        buffer_->Store();
+
+        if ((keys_.size() & 0x3FF) == 0 &&
+            buffer_->GetMemorySize() +
+                        keys_.capacity() * sizeof(Key) > maxMemory_) {
+          WriteRun();
+        }
+      }
+    }
+
+    /// Number of runs written to temporary files so far
+    unsigned GetNRuns() const {return runs_.GetNFiles();}
+
+    /// Write all events, sorted, to the output file
+    void Finish() {
+
+      if (buffer_.IsNull()) {
+        return;
+      }
+
+      if (runs_.GetNFiles() == 0) {
+        std::vector<uint64_t> order = GetOrder();
+        EventBuffer::Writer writer(*buffer_, outFile_);
+        for (uint64_t i = 0; i < order.size(); ++i) {
+          writer.Fill(order[i]);
+          outFile_.Write();
+        }
+        return;
+      }
+
+      if (keys_.size() > 0) {
+        WriteRun();
+      }
+      MergeRuns();
+    }
+
+  private:
+
+    XCDFFile& outFile_;
+    std::string exp_;
+    size_t maxMemory_;
+    unsigned maxMergeRuns_;
+
+    std::set<std::string> fields_;
+    std::string keyName_;
+    XCDFPtr<EventBuffer> buffer_;
+    std::vector<Key> keys_;
+    TempFiles runs_;
+
+    // Fields of the runs (and the key) are stored without loss: unit
+    // resolution for integers and zero resolution for floating point.
+    // The output is then rounded to the field resolutions only once, as
+    // when all events fit in memory.
+    static XCDFField<uint64_t> AllocateLossless(XCDFFile& f,
+                                                const std::string& name,
+                                                const std::string& parent,
+                                                uint64_t) {
+      return f.AllocateUnsignedIntegerField(name, 1, parent);
+    }
+
+    static XCDFField<int64_t> AllocateLossless(XCDFFile& f,
+                                               const std::string& name,
+                                               const std::string& parent,
+                                               int64_t) {
+      return f.AllocateSignedIntegerField(name, 1, parent);
+    }
+
+    static XCDFField<double> AllocateLossless(XCDFFile& f,
+                                              const std::string& name,
+                                              const std::string& parent,
+                                              double) {
+      return f.AllocateFloatingPointField(name, 0., parent);
+    }
+
+    // Allocate the fields of the output file, in order, in a run file
+    class AllocateRunFieldVisitor {
+
+      public:
+
+        AllocateRunFieldVisitor(XCDFFile& outFile,
+                                XCDFFile& run) : outFile_(outFile),
+                                                 run_(run) { }
+
+        template <typename T>
+        void operator()(XCDFField<T> field) {
+          std::string parentName = NO_PARENT;
+          if (outFile_.IsVectorField(field.GetName())) {
+            parentName = outFile_.GetFieldParentName(field.GetName());
+          }
+          AllocateLossless(run_, field.GetName(), parentName, T());
+        }
+
+      private:
+
+        XCDFFile& outFile_;
+        XCDFFile& run_;
+    };
+
+    /// Indices of the buffered events, stably sorted by key
+    std::vector<uint64_t> GetOrder() const {
+
+      std::vector<uint64_t> order(keys_.size());
+      for (uint64_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+      }
+      const std::vector<Key>& keys = keys_;
+      std::stable_sort(order.begin(), order.end(),
+                       [&keys](uint64_t a, uint64_t b) {
+                         return KeyLess(keys[a], keys[b]);
+                       });
+      return order;
+    }
+
+    /// Allocate the fields of the output, plus the key, in a run file
+    XCDFField<Key> AllocateRunFields(XCDFFile& run) {
+      AllocateRunFieldVisitor allocateRunFieldVisitor(outFile_, run);
+      outFile_.ApplyFieldVisitor(allocateRunFieldVisitor);
+      return AllocateLossless(run, keyName_, NO_PARENT, Key());
+    }
+
+    /// Sort the buffered events into a new run and empty the buffer
+    void WriteRun() {
+
+      XCDFFile run(runs_.Create().c_str(), "w");
+      XCDFField<Key> keyField = AllocateRunFields(run);
+
+      std::vector<uint64_t> order = GetOrder();
+      EventBuffer::Writer writer(*buffer_, run);
+      for (uint64_t i = 0; i < order.size(); ++i) {
+        writer.Fill(order[i]);
+        keyField << keys_[order[i]];
+        run.Write();
+      }
+      run.Close();
+
+      buffer_->Clear();
+      std::vector<Key>().swap(keys_);
+    }
+
+    /// Merge the runs, ordered by their key field, into the output file
+    void MergeRuns() {
+
+      std::vector<std::string> names;
+      for (unsigned r = 0; r < runs_.GetNFiles(); ++r) {
+        names.push_back(runs_.GetName(r));
+      }
+
+      // Merge groups of consecutive runs, keeping the order of equal
+      // keys, until all runs can be open at once
+      std::set<std::string> runFields(fields_);
+      runFields.insert(keyName_);
+      while (names.size() > maxMergeRuns_) {
+        std::vector<std::string> merged;
+        for (size_t first = 0; first < names.size(); first += maxMergeRuns_) {
+          size_t last = std::min(names.size(), first + maxMergeRuns_);
+          if (last - first == 1) {
+            merged.push_back(names[first]);
+            continue;
+          }
+          std::vector<std::string> group(names.begin() + first,
+                                         names.begin() + last);
+          std::string name = runs_.Create();
+          XCDFFile run(name.c_str(), "w");
+          AllocateRunFields(run);
+          MergeReader<Key> reader(group, keyName_);
+          CopyMerged(reader, run, runFields);
+          run.Close();
+          merged.push_back(name);
+        }
+        names.swap(merged);
+      }
+
+      MergeReader<Key> reader(names, keyName_);
+      CopyMerged(reader, outFile_, fields_);
+    }
+};
+
+#endif // XCDF_UTILITY_EVENT_SORTER_H_INCLUDED
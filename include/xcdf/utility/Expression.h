@@ -31,6 +31,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/XCDFDefs.h>
 #include <vector>
 #include <list>
+#include <map>
 #include <algorithm>
 
 // Forward-declare XCDFFile to avoid circular dependency introduced
@@ -64,13 +65,36 @@ class Expression {
     const std::string& GetExpressionString() const {return expString_;}
     const XCDFFile& GetFile() const {return *f_;}
 
+    // Operation that built a node of the parsed tree, e.g. LOGICAL_AND,
+    // and its operands.  Leaves (fields, aliases, constants) give VOID.
+    SymbolType GetOperation(const Symbol* node) const;
+    Symbol* GetOperand(const Symbol* node, unsigned i) const;
+
+    // True if evaluating the node can neither abort nor trap (e.g. on an
+    // integer division by zero) and has no side effects, so it may safely
+    // be evaluated where the expression as written would skip it.
+    bool IsTotal(const Symbol* node) const;
+
+    // A node evaluating the same value as a scalar node of the parsed
+    // tree, with the operations lowered into a flat ExpressionProgram.
+    // Other nodes are returned unchanged.
+    Symbol* Compile(Symbol* node);
+
   private:
 
+    struct NodeRecord {
+      SymbolType operation_;
+      Symbol* operands_[2];
+    };
+
     const XCDFFile* f_;
     std::string expString_;
 
     std::vector<Symbol*> allocatedSymbols_;
     std::list<Symbol*> parsedSymbols_;
+    std::map<const Symbol*, NodeRecord> nodeRecords_;
+
+    void RecordNode(Symbol* node, SymbolType type, Symbol* n1, Symbol* n2);
 
     void ParseSymbols(const std::string& exp);
     Symbol* GetNextSymbol(const std::string& exp, size_t& pos);
@@ -83,6 +107,7 @@ class Expression {
                           size_t& pos) const;
 
     Symbol* ParseNumerical(const std::string& numerical) const;
+    Symbol* ParseFileList(const std::string& exp, size_t& pos);
     Symbol* ParseValueImpl(std::string exp) const;
     Symbol* ParseOperatorImpl(std::string exp) const;
     void RecursiveParseExpression(std::list<Symbol*>::iterator& start,
@@ -137,6 +162,11 @@ class Expression {
                           std::list<Symbol*>::iterator end,
                           std::list<Symbol*>::iterator it,
                           SymbolType type);
+
+    Symbol* Optimize(Symbol* symbol,
+                     Symbol* n1,
+                     Symbol* n2,
+                     SymbolType type);
 };
 
 #endif // XCDF_UTILITY_EXPRESSION_INCLUDED_H
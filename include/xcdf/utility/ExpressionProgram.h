@@ -0,0 +1,325 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_EXPRESSION_PROGRAM_H_INCLUDED
+#define XCDF_UTILITY_EXPRESSION_PROGRAM_H_INCLUDED
+
+#include <xcdf/utility/Node.h>
+#include <xcdf/XCDFDefs.h>
+
+#include <vector>
+#include <cmath>
+#include <stdint.h>
+
+/*
+ *  Operations of an ExpressionProgram.  The suffix gives the type of
+ *  the operands: U (uint64_t), I (int64_t) or D (double).
+ */
+enum ProgramOp {
+
+  // out = value at a scalar field's storage, or entry 0 of a node
+  // evaluated as a tree
+  LOAD_U, LOAD_I, LOAD_D,
+  NODE_U, NODE_I, NODE_D,
+
+  // out = a converted to another type, as static_cast
+  U_TO_I, U_TO_D, I_TO_U, I_TO_D, D_TO_U, D_TO_I,
+
+  // out = int(a) and unsigned(a), as the int() and unsigned() functions
+  INT_U, INT_I, INT_D,
+  UNSIGNED_U, UNSIGNED_I, UNSIGNED_D,
+
+  ADD_U, ADD_I, ADD_D,
+  SUB_U, SUB_I, SUB_D,
+  MUL_U, MUL_I, MUL_D,
+  DIV_U, DIV_I, DIV_D,
+  MOD_U,
+  BITWISE_AND_U, BITWISE_AND_I,
+  BITWISE_OR_U, BITWISE_OR_I,
+  BITWISE_NOT_U, BITWISE_NOT_I,
+
+  // Comparisons and logical operations give 0 or 1 as uint64_t
+  EQ_U, EQ_I, EQ_D,
+  NE_U, NE_I, NE_D,
+  GT_U, GT_I, GT_D,
+  LT_U, LT_I, LT_D,
+  GE_U, GE_I, GE_D,
+  LE_U, LE_I, LE_D,
+  NOT_U, NOT_I, NOT_D,
+  TEST_U, TEST_I, TEST_D,
+  ISNAN_D, ISINF_D,
+
+  // out = function(a) or function(a, b) on doubles
+  CALL1_D, CALL2_D,
+
+  // Continue at instruction b if a (uint64_t) is zero or non-zero
+  JUMP_ZERO, JUMP_NONZERO
+};
+
+union ProgramRegister {
+  uint64_t u_;
+  int64_t i_;
+  double d_;
+};
+
+struct ProgramInstruction {
+
+  ProgramInstruction(ProgramOp op,
+                     unsigned out,
+                     unsigned a = 0,
+                     unsigned b = 0) : op_(op), out_(out), a_(a), b_(b),
+                                       source_(NULL),
+                                       function1_(NULL),
+                                       function2_(NULL) { }
+
+  ProgramOp op_;
+  unsigned out_;
+  unsigned a_;
+  unsigned b_;
+
+  // Field storage or node read by LOAD and NODE operations
+  const void* source_;
+
+  double (*function1_)(double);
+  double (*function2_)(double, double);
+};
+
+/*
+ *  A scalar expression lowered to a flat list of operations over typed
+ *  registers.  Each node of the expression tree has its own register.
+ *  Constants are held in registers set once when the program is built.
+ *  "&&" and "||" jump over their second operand when the first decides
+ *  the result, so guarded operations are skipped as in the tree.  Run()
+ *  executes the list in one loop per event.
+ */
+class ExpressionProgram {
+
+  public:
+
+    ExpressionProgram() : result_(0) { }
+
+    unsigned AddRegister() {
+      registers_.push_back(ProgramRegister());
+      registers_.back().u_ = 0;
+      return registers_.size() - 1;
+    }
+
+    template <typename T>
+    unsigned AddConstant(T value) {
+      unsigned reg = AddRegister();
+      SetRegister(registers_[reg], value);
+      return reg;
+    }
+
+    unsigned AddInstruction(const ProgramInstruction& instruction) {
+      code_.push_back(instruction);
+      return code_.size() - 1;
+    }
+
+    ProgramInstruction& GetInstruction(unsigned i) {return code_[i];}
+    unsigned GetNInstructions() const {return code_.size();}
+
+    void SetResult(unsigned reg) {result_ = reg;}
+
+    const ProgramRegister& Run() const {
+
+      ProgramRegister* r = registers_.data();
+      const ProgramInstruction* begin = code_.data();
+      const ProgramInstruction* end = begin + code_.size();
+      for (const ProgramInstruction* in = begin; in != end; ++in) {
+
+        ProgramRegister& out = r[in->out_];
+        const ProgramRegister& a = r[in->a_];
+        const ProgramRegister& b = r[in->b_];
+        switch (in->op_) {
+
+          case LOAD_U: out.u_ = *static_cast<const uint64_t*>(in->source_);
+                       break;
+          case LOAD_I: out.i_ = *static_cast<const int64_t*>(in->source_);
+                       break;
+          case LOAD_D: out.d_ = *static_cast<const double*>(in->source_);
+                       break;
+          case NODE_U:
+            out.u_ = (*static_cast<const Node<uint64_t>*>(in->source_))[0];
+            break;
+          case NODE_I:
+            out.i_ = (*static_cast<const Node<int64_t>*>(in->source_))[0];
+            break;
+          case NODE_D:
+            out.d_ = (*static_cast<const Node<double>*>(in->source_))[0];
+            break;
+
+          case U_TO_I: out.i_ = static_cast<int64_t>(a.u_); break;
+          case U_TO_D: out.d_ = static_cast<double>(a.u_); break;
+          case I_TO_U: out.u_ = static_cast<uint64_t>(a.i_); break;
+          case I_TO_D: out.d_ = static_cast<double>(a.i_); break;
+          case D_TO_U: out.u_ = static_cast<uint64_t>(a.d_); break;
+          case D_TO_I: out.i_ = static_cast<int64_t>(a.d_); break;
+
+          case INT_U: out.i_ = int(a.u_); break;
+          case INT_I: out.i_ = int(a.i_); break;
+          case INT_D: out.i_ = int(a.d_); break;
+          case UNSIGNED_U: out.u_ = unsigned(a.u_); break;
+          case UNSIGNED_I: out.u_ = unsigned(a.i_); break;
+          case UNSIGNED_D: out.u_ = unsigned(a.d_); break;
+
+          case ADD_U: out.u_ = a.u_ + b.u_; break;
+          case ADD_I: out.i_ = a.i_ + b.i_; break;
+          case ADD_D: out.d_ = a.d_ + b.d_; break;
+          case SUB_U: out.u_ = a.u_ - b.u_; break;
+          case SUB_I: out.i_ = a.i_ - b.i_; break;
+          case SUB_D: out.d_ = a.d_ - b.d_; break;
+          case MUL_U: out.u_ = a.u_ * b.u_; break;
+          case MUL_I: out.i_ = a.i_ * b.i_; break;
+          case MUL_D: out.d_ = a.d_ * b.d_; break;
+          case DIV_U: out.u_ = a.u_ / b.u_; break;
+          case DIV_I: out.i_ = a.i_ / b.i_; break;
+          case DIV_D: out.d_ = a.d_ / b.d_; break;
+          case MOD_U: out.u_ = a.u_ % b.u_; break;
+          case BITWISE_AND_U: out.u_ = a.u_ & b.u_; break;
+          case BITWISE_AND_I: out.i_ = a.i_ & b.i_; break;
+          case BITWISE_OR_U: out.u_ = a.u_ | b.u_; break;
+          case BITWISE_OR_I: out.i_ = a.i_ | b.i_; break;
+          case BITWISE_NOT_U: out.u_ = ~a.u_; break;
+          case BITWISE_NOT_I: out.i_ = ~a.i_; break;
+
+          case EQ_U: out.u_ = a.u_ == b.u_; break;
+          case EQ_I: out.u_ = a.i_ == b.i_; break;
+          case EQ_D: out.u_ = a.d_ == b.d_; break;
+          case NE_U: out.u_ = a.u_ != b.u_; break;
+          case NE_I: out.u_ = a.i_ != b.i_; break;
+          case NE_D: out.u_ = a.d_ != b.d_; break;
+          case GT_U: out.u_ = a.u_ > b.u_; break;
+          case GT_I: out.u_ = a.i_ > b.i_; break;
+          case GT_D: out.u_ = a.d_ > b.d_; break;
+          case LT_U: out.u_ = a.u_ < b.u_; break;
+          case LT_I: out.u_ = a.i_ < b.i_; break;
+          case LT_D: out.u_ = a.d_ < b.d_; break;
+          case GE_U: out.u_ = a.u_ >= b.u_; break;
+          case GE_I: out.u_ = a.i_ >= b.i_; break;
+          case GE_D: out.u_ = a.d_ >= b.d_; break;
+          case LE_U: out.u_ = a.u_ <= b.u_; break;
+          case LE_I: out.u_ = a.i_ <= b.i_; break;
+          case LE_D: out.u_ = a.d_ <= b.d_; break;
+          case NOT_U: out.u_ = !a.u_; break;
+          case NOT_I: out.u_ = !a.i_; break;
+          case NOT_D: out.u_ = !a.d_; break;
+          case TEST_U: out.u_ = a.u_ != 0; break;
+          case TEST_I: out.u_ = a.i_ != 0; break;
+          case TEST_D: out.u_ = a.d_ != 0.; break;
+          case ISNAN_D: out.u_ = std::isnan(a.d_); break;
+          case ISINF_D: out.u_ = std::isinf(a.d_); break;
+
+          case CALL1_D: out.d_ = in->function1_(a.d_); break;
+          case CALL2_D: out.d_ = in->function2_(a.d_, b.d_); break;
+
+          case JUMP_ZERO:
+            if (!a.u_) {
+              in = begin + in->b_ - 1;
+            }
+            break;
+          case JUMP_NONZERO:
+            if (a.u_) {
+              in = begin + in->b_ - 1;
+            }
+            break;
+        }
+      }
+      return registers_[result_];
+    }
+
+  private:
+
+    std::vector<ProgramInstruction> code_;
+    mutable std::vector<ProgramRegister> registers_;
+    unsigned result_;
+
+    static void SetRegister(ProgramRegister& r, uint64_t value) {r.u_ = value;}
+    static void SetRegister(ProgramRegister& r, int64_t value) {r.i_ = value;}
+    static void SetRegister(ProgramRegister& r, double value) {r.d_ = value;}
+};
+
+template <typename T>
+inline T GetRegister(const ProgramRegister& r);
+
+template <>
+inline uint64_t GetRegister<uint64_t>(const ProgramRegister& r) {return r.u_;}
+
+template <>
+inline int64_t GetRegister<int64_t>(const ProgramRegister& r) {return r.i_;}
+
+template <>
+inline double GetRegister<double>(const ProgramRegister& r) {return r.d_;}
+
+/*
+ *  Evaluates a scalar expression tree through its ExpressionProgram.
+ *  Everything but the value is taken from the head node of the tree.
+ */
+template <typename T>
+class ProgramNode : public Node<T> {
+
+  public:
+
+    ProgramNode(const Node<T>& head,
+                const ExpressionProgram& program) : head_(head),
+                                                    program_(program) { }
+
+    T operator[](unsigned index) const {
+      return GetRegister<T>(program_.Run());
+    }
+    unsigned GetSize() const {return head_.GetSize();}
+
+    // As in the tree, nothing is evaluated for an empty node
+    const T* EvaluateBatch() const {
+      this->batch_.resize(GetSize() > 0);
+      if (this->batch_.size() > 0) {
+        this->batch_[0] = GetRegister<T>(program_.Run());
+      }
+      return this->batch_.data();
+    }
+
+    const std::string& GetName() const {return head_.GetName();}
+
+    bool HasParent() const {return head_.HasParent();}
+    const std::string& GetParentName() const {return head_.GetParentName();}
+
+    bool HasGrandparent() const {return head_.HasGrandparent();}
+    const std::string& GetGrandparentName() const {
+      return head_.GetGrandparentName();
+    }
+    unsigned GetParentIndex(unsigned index) const {
+      return head_.GetParentIndex(index);
+    }
+
+    bool IsBlockConstant() const {return head_.IsBlockConstant();}
+
+  private:
+
+    const Node<T>& head_;
+    ExpressionProgram program_;
+};
+
+#endif // XCDF_UTILITY_EXPRESSION_PROGRAM_H_INCLUDED
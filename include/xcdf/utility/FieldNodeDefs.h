@@ -52,6 +52,9 @@ class FieldNode : public Node<T> {
     }
     unsigned GetSize() const {return field_.GetSize();}
 
+    // Field data are already contiguous
+    const T* EvaluateBatch() const {return field_.Begin();}
+
     const std::string& GetName() const {return field_.GetName();}
 
     bool HasParent() const {return field_.HasParent();}
@@ -63,20 +66,12 @@ class FieldNode : public Node<T> {
     }
 
     unsigned GetParentIndex(unsigned index) const {
-      ConstXCDFField<uint64_t> parent = field_.GetParent();
-      // Find the parent index corresponding to this index.
-      unsigned sum = 0;
-      for (unsigned i = 0; i < parent.GetSize(); ++i) {
-        sum += parent[i];
-        if (sum > index) {
-          return i;
-        }
-      }
-
-      // This should never happen if index < GetSize()
-      XCDFFatal("GetParentIndex(): Trying to access index " << index <<
-                     " of field " << GetName());
-      return 0;
+      return field_.GetParentIndex(index);
+    }
+
+    // A scalar stored with zero bits has the same value for the block
+    bool IsBlockConstant() const {
+      return !field_.HasParent() && field_.GetActiveSize() == 0;
     }
 
   private:
@@ -93,6 +88,7 @@ class AliasNode : public Node<T> {
 
     T operator[](unsigned index) const {return alias_[index];}
     unsigned GetSize() const {return alias_.GetSize();}
+    const T* EvaluateBatch() const {return alias_.EvaluateBatch();}
 
     const std::string& GetName() const {return alias_.GetName();}
 
@@ -109,6 +105,10 @@ class AliasNode : public Node<T> {
       return alias_.GetHeadNode().GetParentIndex(index);
     }
 
+    bool IsBlockConstant() const {
+      return alias_.GetHeadNode().IsBlockConstant();
+    }
+
   private:
 
     XCDFFieldAlias<T> alias_;
@@ -29,15 +29,152 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_UTILITY_HISTOGRAM_H_INCLUDED
 
 #include <xcdf/XCDFDefs.h>
+#include <xcdf/XCDFPtr.h>
 #include <xcdf/utility/NumericalExpression.h>
 
 #include <vector>
 #include <utility>
+#include <unordered_map>
+#include <algorithm>
 #include <stdint.h>
 #include <cmath>
 #include <limits>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+
+// Memory, in bytes, for the fills kept by histograms with deferred range
+const size_t DEFAULT_DEFERRED_BYTES = 1 << 27;
+
+/*
+ *  Memory available to histograms with deferred range for keeping their
+ *  fills until the range is known.  Histograms may share a budget.  A
+ *  histogram that finds the budget used up drops its kept fills and
+ *  must be refilled once the range is known.
+ */
+class DeferredFillBudget {
+
+  public:
+
+    DeferredFillBudget(size_t maxBytes = DEFAULT_DEFERRED_BYTES) :
+                                                  maxBytes_(maxBytes),
+                                                  usedBytes_(0) { }
+
+    /// Take bytes from the budget.  False if not enough are left.
+    bool Take(size_t bytes) {
+      if (bytes > maxBytes_ - usedBytes_) {
+        return false;
+      }
+      usedBytes_ += bytes;
+      return true;
+    }
+
+    void Release(size_t bytes) {usedBytes_ -= bytes;}
+
+    size_t GetUsedBytes() const {return usedBytes_;}
+
+  private:
+
+    size_t maxBytes_;
+    size_t usedBytes_;
+};
+
+/// The given budget, or a new one if it is null
+inline XCDFPtr<DeferredFillBudget>
+OwnBudget(XCDFPtr<DeferredFillBudget> budget) {
+  return budget.IsNull() ? xcdf_shared(new DeferredFillBudget()) : budget;
+}
+
+/*
+ *  Values kept by a histogram with deferred range.  The budget is
+ *  charged for the memory allocated to hold them, which grows by
+ *  doubling.  A copy charges the budget for its own memory, or holds
+ *  no values and is marked dropped if the budget is used up.  Memory is
+ *  returned to the budget when the values are cleared or destroyed.
+ */
+class DeferredFills {
+
+  public:
+
+    DeferredFills(XCDFPtr<DeferredFillBudget> budget =
+                                 XCDFPtr<DeferredFillBudget>()) :
+                                                  budget_(budget),
+                                                  chargedBytes_(0),
+                                                  dropped_(false) { }
+
+    DeferredFills(const DeferredFills& other) : budget_(other.budget_),
+                                                chargedBytes_(0),
+                                                dropped_(other.dropped_) {
+      if (!dropped_ && !other.values_.empty()) {
+        if (Reserve(other.values_.size())) {
+          values_.assign(other.values_.begin(), other.values_.end());
+        } else {
+          dropped_ = true;
+        }
+      }
+    }
+
+    ~DeferredFills() {Clear();}
+
+    DeferredFills& operator=(DeferredFills other) {
+      values_.swap(other.values_);
+      std::swap(budget_, other.budget_);
+      std::swap(chargedBytes_, other.chargedBytes_);
+      std::swap(dropped_, other.dropped_);
+      return *this;
+    }
+
+    bool IsDropped() const {return dropped_;}
+
+    size_t size() const {return values_.size();}
+    double operator[](size_t i) const {return values_[i];}
+
+    /// Keep n values.  If the budget is used up, the kept values are of
+    /// no use any more: they are dropped to leave the memory to others.
+    void Keep(const double* values, unsigned n) {
+      if (dropped_) {
+        return;
+      }
+      if (!Reserve(values_.size() + n)) {
+        dropped_ = true;
+        Clear();
+        return;
+      }
+      values_.insert(values_.end(), values, values + n);
+    }
+
+    /// Forget the kept values and return their memory to the budget
+    void Clear() {
+      if (chargedBytes_ > 0) {
+        budget_->Release(chargedBytes_);
+        chargedBytes_ = 0;
+      }
+      std::vector<double>().swap(values_);
+    }
+
+  private:
+
+    std::vector<double> values_;
+    XCDFPtr<DeferredFillBudget> budget_;
+    size_t chargedBytes_;
+    bool dropped_;
+
+    // Make room for n values, charging the budget for the new memory
+    bool Reserve(size_t n) {
+      if (n <= values_.capacity()) {
+        return true;
+      }
+      size_t capacity = std::max(n, std::max(2 * values_.capacity(),
+                                             static_cast<size_t>(256)));
+      size_t bytes = capacity * sizeof(double);
+      if (!budget_->Take(bytes - chargedBytes_)) {
+        return false;
+      }
+      chargedBytes_ = bytes;
+      values_.reserve(capacity);
+      return true;
+    }
+};
 
 class Histogram1D {
 
@@ -51,7 +188,8 @@ class Histogram1D {
                                                           overflowW2_(0.),
                                                           min_(min),
                                                           max_(max),
-                                                          nEntries_(0) {
+                                                          nEntries_(0),
+                                                          rangeSet_(true) {
 
       if (nbins == 0) {
         XCDFFatal("Histogram must have >0 bins");
@@ -63,6 +201,57 @@ class Histogram1D {
       rinv_ = 1. / (max - min);
     }
 
+    /// Histogram whose range is given later by SetRange().  Until then,
+    /// fills are kept in memory, as long as budget allows, and replayed
+    /// in order once the range is set.  Without a budget, the histogram
+    /// gets one of its own.
+    Histogram1D(unsigned nbins,
+                XCDFPtr<DeferredFillBudget> budget =
+                                       XCDFPtr<DeferredFillBudget>()) :
+                                                 data_(nbins, 0.),
+                                                 dataW2_(nbins, 0.),
+                                                 underflow_(0.),
+                                                 underflowW2_(0.),
+                                                 overflow_(0.),
+                                                 overflowW2_(0.),
+                                                 min_(0.),
+                                                 max_(1.),
+                                                 rinv_(1.),
+                                                 nEntries_(0),
+                                                 rangeSet_(false),
+                                                 deferred_(OwnBudget(budget)) {
+
+      if (nbins == 0) {
+        XCDFFatal("Histogram must have >0 bins");
+      }
+    }
+
+    bool IsRangeSet() const {return rangeSet_;}
+
+    /// True if the deferred fills ran out of budget before the range was
+    /// set.  The kept fills are then dropped and the data must be refilled.
+    bool HasDroppedFills() const {return deferred_.IsDropped();}
+
+    /// Set the range of a deferred histogram and apply the kept fills
+    void SetRange(double min, double max) {
+
+      if (rangeSet_) {
+        XCDFFatal("Histogram range is already set");
+      }
+      if (!(max > min)) {
+        XCDFFatal("Histogram maximum must be larger than the minimum");
+      }
+      min_ = min;
+      max_ = max;
+      rinv_ = 1. / (max - min);
+      rangeSet_ = true;
+
+      for (size_t i = 0; i < deferred_.size(); i += 2) {
+        Fill(deferred_[i], deferred_[i + 1]);
+      }
+      deferred_.Clear();
+    }
+
     unsigned GetNBins() const {return data_.size();}
     double GetMinimum() const {return min_;}
     double GetMaximum() const {return max_;}
@@ -83,24 +272,84 @@ class Histogram1D {
 
     void Fill(double value, double weight=1.) {
 
-      double ldiff = (value - min_) * rinv_ * GetNBins();
-      // Don't let integers at bin edges round down!
-      ldiff *= (1. + std::numeric_limits<double>::epsilon());
-      if (ldiff < 0.) {
-        underflow_ += weight;
-        underflowW2_ += weight*weight;
-      } else if (ldiff >= GetNBins()) {
-        overflow_ += weight;
-        overflowW2_ += weight*weight;
-      } else {
-        int64_t binno = static_cast<int64_t>(ldiff);
-        data_[binno] += weight;
-        dataW2_[binno] += weight*weight;
+      if (!rangeSet_) {
+        const double fill[] = {value, weight};
+        deferred_.Keep(fill, 2);
+        return;
       }
+
+      FillBin(FindBin(value), weight);
       ++nEntries_;
     }
 
+    /// Fill n values, with weights[i] or unit weight if weights is NULL.
+    /// Bin numbers are computed for all values before any bin is filled.
+    void Fill(const double* values, const double* weights, unsigned n) {
+
+      if (!rangeSet_) {
+        for (unsigned i = 0; i < n; ++i) {
+          Fill(values[i], weights ? weights[i] : 1.);
+        }
+        return;
+      }
+
+      FindBins(values, n);
+      for (unsigned i = 0; i < n; ++i) {
+        double weight = weights ? weights[i] : 1.;
+        FillBin(bins_[i], weight);
+      }
+      nEntries_ += n;
+    }
+
+    /// Fill n values with the same weight
+    void Fill(const double* values, double weight, unsigned n) {
+
+      if (!rangeSet_) {
+        for (unsigned i = 0; i < n; ++i) {
+          Fill(values[i], weight);
+        }
+        return;
+      }
+
+      FindBins(values, n);
+      for (unsigned i = 0; i < n; ++i) {
+        FillBin(bins_[i], weight);
+      }
+      nEntries_ += n;
+    }
+
+    /// Histogram with the same binning and no entries
+    Histogram1D EmptyCopy() const {
+      if (!rangeSet_) {
+        XCDFFatal("Cannot copy the binning of a histogram without a range");
+      }
+      return Histogram1D(GetNBins(), min_, max_);
+    }
+
+    /// Add the contents of a histogram with identical binning, e.g.
+    /// one filled in another thread
+    void Add(const Histogram1D& other) {
+
+      if (!rangeSet_ || !other.rangeSet_) {
+        XCDFFatal("Cannot add histograms without a range");
+      }
+      if (GetNBins() != other.GetNBins() ||
+          min_ != other.min_ || max_ != other.max_) {
+        XCDFFatal("Cannot add histograms with different binning");
+      }
+      for (unsigned i = 0; i < GetNBins(); ++i) {
+        data_[i] += other.data_[i];
+        dataW2_[i] += other.dataW2_[i];
+      }
+      underflow_ += other.underflow_;
+      underflowW2_ += other.underflowW2_;
+      overflow_ += other.overflow_;
+      overflowW2_ += other.overflowW2_;
+      nEntries_ += other.nEntries_;
+    }
+
     friend class Histogram2D;
+    friend class HistogramND;
 
   private:
 
@@ -116,6 +365,48 @@ class Histogram1D {
     double rinv_;
 
     uint64_t nEntries_;
+
+    // Bin numbers for batched fills: -1 for underflow, nbins for overflow
+    std::vector<int64_t> bins_;
+
+    void FindBins(const double* values, unsigned n) {
+
+      if (bins_.size() < n) {
+        bins_.resize(n);
+      }
+      for (unsigned i = 0; i < n; ++i) {
+        bins_[i] = FindBin(values[i]);
+      }
+    }
+
+    // Bin number of value: -1 for underflow, nbins for overflow.
+    // NaN is counted as underflow.
+    int64_t FindBin(double value) const {
+      const double nbins = GetNBins();
+      double ldiff = (value - min_) * rinv_ * nbins;
+      // Don't let integers at bin edges round down!
+      ldiff *= (1. + std::numeric_limits<double>::epsilon());
+      return !(ldiff >= 0.) ? -1 :
+             ldiff >= nbins ? static_cast<int64_t>(nbins) :
+             static_cast<int64_t>(ldiff);
+    }
+
+    void FillBin(int64_t binno, double weight) {
+      if (binno < 0) {
+        underflow_ += weight;
+        underflowW2_ += weight*weight;
+      } else if (binno >= static_cast<int64_t>(GetNBins())) {
+        overflow_ += weight;
+        overflowW2_ += weight*weight;
+      } else {
+        data_[binno] += weight;
+        dataW2_[binno] += weight*weight;
+      }
+    }
+
+    // Fills kept until the range is known, as (value, weight) pairs
+    bool rangeSet_;
+    DeferredFills deferred_;
 };
 
 class Histogram2D {
@@ -132,7 +423,8 @@ class Histogram2D {
                                               xMax_(maxX),
                                               yMin_(minY),
                                               yMax_(maxY),
-                                              nEntries_(0) {
+                                              nEntries_(0),
+                                              rangeSet_(true) {
 
       if (nbinsX == 0 || nbinsY == 0) {
         XCDFFatal("Histogram must have >0 bins");
@@ -145,6 +437,61 @@ class Histogram2D {
       yRinv_ = 1. / (maxY - minY);
     }
 
+    /// Histogram whose range is given later by SetRange().  Until then,
+    /// fills are kept in memory, as long as budget allows, and replayed
+    /// in order once the range is set.  Without a budget, the histogram
+    /// gets one of its own.
+    Histogram2D(unsigned nbinsX, unsigned nbinsY,
+                XCDFPtr<DeferredFillBudget> budget =
+                                       XCDFPtr<DeferredFillBudget>()) :
+                                              data_(nbinsX*nbinsY, 0.),
+                                              dataW2_(nbinsX*nbinsY, 0.),
+                                              nbinsX_(nbinsX),
+                                              nbinsY_(nbinsY),
+                                              xMin_(0.),
+                                              xMax_(1.),
+                                              yMin_(0.),
+                                              yMax_(1.),
+                                              xRinv_(1.),
+                                              yRinv_(1.),
+                                              nEntries_(0),
+                                              rangeSet_(false),
+                                              deferred_(OwnBudget(budget)) {
+
+      if (nbinsX == 0 || nbinsY == 0) {
+        XCDFFatal("Histogram must have >0 bins");
+      }
+    }
+
+    bool IsRangeSet() const {return rangeSet_;}
+
+    /// True if the deferred fills ran out of budget before the range was
+    /// set.  The kept fills are then dropped and the data must be refilled.
+    bool HasDroppedFills() const {return deferred_.IsDropped();}
+
+    /// Set the range of a deferred histogram and apply the kept fills
+    void SetRange(double minX, double maxX, double minY, double maxY) {
+
+      if (rangeSet_) {
+        XCDFFatal("Histogram range is already set");
+      }
+      if (!(maxX > minX) || !(maxY > minY)) {
+        XCDFFatal("Histogram maximum must be larger than the minimum");
+      }
+      xMin_ = minX;
+      xMax_ = maxX;
+      yMin_ = minY;
+      yMax_ = maxY;
+      xRinv_ = 1. / (maxX - minX);
+      yRinv_ = 1. / (maxY - minY);
+      rangeSet_ = true;
+
+      for (size_t i = 0; i < deferred_.size(); i += 3) {
+        Fill(deferred_[i], deferred_[i + 1], deferred_[i + 2]);
+      }
+      deferred_.Clear();
+    }
+
     unsigned GetNBins() const {return data_.size();}
     unsigned GetNBinsX() const {return nbinsX_;}
     unsigned GetNBinsY() const {return nbinsY_;}
@@ -181,6 +528,12 @@ class Histogram2D {
 
     void Fill(double xValue, double yValue, double weight=1.) {
 
+      if (!rangeSet_) {
+        const double fill[] = {xValue, yValue, weight};
+        deferred_.Keep(fill, 3);
+        return;
+      }
+
       double xdiff = (xValue - xMin_) * xRinv_ * nbinsX_;
       double ydiff = (yValue - yMin_) * yRinv_ * nbinsY_;
       // Don't let integers at bin edges round down!
@@ -198,6 +551,71 @@ class Histogram2D {
       ++nEntries_;
     }
 
+    /// Fill n (x, y) pairs, with weights[i] or unit weight if weights
+    /// is NULL.  Bin numbers are computed for all pairs before any bin
+    /// is filled.
+    void Fill(const double* xValues, const double* yValues,
+              const double* weights, unsigned n) {
+
+      if (!rangeSet_) {
+        for (unsigned i = 0; i < n; ++i) {
+          Fill(xValues[i], yValues[i], weights ? weights[i] : 1.);
+        }
+        return;
+      }
+
+      if (bins_.size() < n) {
+        bins_.resize(n);
+      }
+      // Same arithmetic as the single-value Fill so the bins agree
+      const double eps = 1. + std::numeric_limits<double>::epsilon();
+      const double nbinsX = nbinsX_;
+      const double nbinsY = nbinsY_;
+      for (unsigned i = 0; i < n; ++i) {
+        double xdiff = (xValues[i] - xMin_) * xRinv_ * nbinsX * eps;
+        double ydiff = (yValues[i] - yMin_) * yRinv_ * nbinsY * eps;
+        bool inRange = xdiff >= 0. && xdiff < nbinsX &&
+                       ydiff >= 0. && ydiff < nbinsY;
+        bins_[i] = inRange ? static_cast<int64_t>(ydiff) * nbinsX_ +
+                             static_cast<int64_t>(xdiff) : -1;
+      }
+      for (unsigned i = 0; i < n; ++i) {
+        if (bins_[i] >= 0) {
+          double weight = weights ? weights[i] : 1.;
+          data_[bins_[i]] += weight;
+          dataW2_[bins_[i]] += weight*weight;
+        }
+      }
+      nEntries_ += n;
+    }
+
+    /// Histogram with the same binning and no entries
+    Histogram2D EmptyCopy() const {
+      if (!rangeSet_) {
+        XCDFFatal("Cannot copy the binning of a histogram without a range");
+      }
+      return Histogram2D(nbinsX_, xMin_, xMax_, nbinsY_, yMin_, yMax_);
+    }
+
+    /// Add the contents of a histogram with identical binning, e.g.
+    /// one filled in another thread
+    void Add(const Histogram2D& other) {
+
+      if (!rangeSet_ || !other.rangeSet_) {
+        XCDFFatal("Cannot add histograms without a range");
+      }
+      if (nbinsX_ != other.nbinsX_ || nbinsY_ != other.nbinsY_ ||
+          xMin_ != other.xMin_ || xMax_ != other.xMax_ ||
+          yMin_ != other.yMin_ || yMax_ != other.yMax_) {
+        XCDFFatal("Cannot add histograms with different binning");
+      }
+      for (unsigned i = 0; i < GetNBins(); ++i) {
+        data_[i] += other.data_[i];
+        dataW2_[i] += other.dataW2_[i];
+      }
+      nEntries_ += other.nEntries_;
+    }
+
     Histogram1D ProfileX(unsigned i) {
       return ProfileX(std::vector<unsigned>(1, i));
     }
@@ -230,6 +648,8 @@ class Histogram2D {
       return out;
     }
 
+    friend class HistogramND;
+
   private:
 
     std::vector<double> data_;
@@ -245,6 +665,221 @@ class Histogram2D {
     double yRinv_;
 
     uint64_t nEntries_;
+
+    // Bin numbers for batched fills, -1 if out of range
+    std::vector<int64_t> bins_;
+
+    // Fills kept until the range is known, as (x, y, weight) triples
+    bool rangeSet_;
+    DeferredFills deferred_;
+};
+
+/*
+ *  Sparse histogram in any number of dimensions.  Only bins with entries
+ *  are stored, keyed by the bin numbers packed into a single integer, so
+ *  fine binning in many dimensions costs memory only for the populated
+ *  bins.  Entries outside the range in any dimension are summed into a
+ *  single out-of-range total.
+ */
+class HistogramND {
+
+  public:
+
+    HistogramND(const std::vector<unsigned>& nbins,
+                const std::vector<double>& mins,
+                const std::vector<double>& maxs) : nbins_(nbins),
+                                                   mins_(mins),
+                                                   maxs_(maxs),
+                                                   rinvs_(nbins.size()),
+                                                   strides_(nbins.size()),
+                                                   outOfRange_(0.),
+                                                   outOfRangeW2_(0.),
+                                                   nEntries_(0) {
+
+      if (nbins.size() == 0 ||
+          mins.size() != nbins.size() || maxs.size() != nbins.size()) {
+        XCDFFatal("Histogram needs a bin count and range for each dimension");
+      }
+
+      uint64_t stride = 1;
+      for (unsigned i = 0; i < nbins.size(); ++i) {
+        if (nbins[i] == 0) {
+          XCDFFatal("Histogram must have >0 bins");
+        }
+        if (!(maxs[i] > mins[i])) {
+          XCDFFatal("Histogram maximum must be larger than the minimum");
+        }
+        rinvs_[i] = 1. / (maxs[i] - mins[i]);
+        strides_[i] = stride;
+        if (stride > std::numeric_limits<uint64_t>::max() / nbins[i]) {
+          XCDFFatal("Too many histogram bins: bin numbers must fit in 64 bits");
+        }
+        stride *= nbins[i];
+      }
+    }
+
+    unsigned GetNDimensions() const {return nbins_.size();}
+    unsigned GetNBins(unsigned dim) const {return nbins_[dim];}
+    double GetMinimum(unsigned dim) const {return mins_[dim];}
+    double GetMaximum(unsigned dim) const {return maxs_[dim];}
+    double GetBinMinimum(unsigned dim, unsigned i) const {
+      return mins_[dim] + (i+0.) / (rinvs_[dim] * nbins_[dim]);
+    }
+    double GetBinCenter(unsigned dim, unsigned i) const {
+      return mins_[dim] + (i+0.5) / (rinvs_[dim] * nbins_[dim]);
+    }
+    uint64_t GetNEntries() const {return nEntries_;}
+    double GetOutOfRange() const {return outOfRange_;}
+    double GetOutOfRangeW2Sum() const {return outOfRangeW2_;}
+
+    /// Number of bins with entries
+    uint64_t GetNFilledBins() const {return bins_.size();}
+
+    double GetData(const std::vector<unsigned>& bins) const {
+      BinMap::const_iterator it = bins_.find(GetKey(bins));
+      return it == bins_.end() ? 0. : it->second.first;
+    }
+
+    double GetW2Sum(const std::vector<unsigned>& bins) const {
+      BinMap::const_iterator it = bins_.find(GetKey(bins));
+      return it == bins_.end() ? 0. : it->second.second;
+    }
+
+    /// Fill with one value per dimension
+    void Fill(const double* values, double weight=1.) {
+
+      uint64_t key = 0;
+      for (unsigned i = 0; i < nbins_.size(); ++i) {
+        double ldiff = (values[i] - mins_[i]) * rinvs_[i] * nbins_[i];
+        // Don't let integers at bin edges round down!
+        ldiff *= (1. + std::numeric_limits<double>::epsilon());
+        if (!(ldiff >= 0. && ldiff < nbins_[i])) {
+          outOfRange_ += weight;
+          outOfRangeW2_ += weight*weight;
+          ++nEntries_;
+          return;
+        }
+        key += static_cast<uint64_t>(ldiff) * strides_[i];
+      }
+      std::pair<double, double>& bin = bins_[key];
+      bin.first += weight;
+      bin.second += weight*weight;
+      ++nEntries_;
+    }
+
+    void Fill(const std::vector<double>& values, double weight=1.) {
+      if (values.size() != nbins_.size()) {
+        XCDFFatal("Expected " << nbins_.size() << " values to fill histogram");
+      }
+      Fill(&values[0], weight);
+    }
+
+    /// Add the contents of a histogram with identical binning
+    void Add(const HistogramND& other) {
+
+      if (nbins_ != other.nbins_ ||
+          mins_ != other.mins_ || maxs_ != other.maxs_) {
+        XCDFFatal("Cannot add histograms with different binning");
+      }
+      for (BinMap::const_iterator it = other.bins_.begin();
+                                  it != other.bins_.end(); ++it) {
+        std::pair<double, double>& bin = bins_[it->first];
+        bin.first += it->second.first;
+        bin.second += it->second.second;
+      }
+      outOfRange_ += other.outOfRange_;
+      outOfRangeW2_ += other.outOfRangeW2_;
+      nEntries_ += other.nEntries_;
+    }
+
+    /// Sum over all dimensions except dim
+    Histogram1D Project(unsigned dim) const {
+
+      CheckDimension(dim);
+      Histogram1D out(nbins_[dim], mins_[dim], maxs_[dim]);
+      for (BinMap::const_iterator it = bins_.begin();
+                                  it != bins_.end(); ++it) {
+        unsigned i = GetBin(it->first, dim);
+        out.data_[i] += it->second.first;
+        out.dataW2_[i] += it->second.second;
+      }
+      out.nEntries_ = nEntries_;
+      return out;
+    }
+
+    /// Sum over all dimensions except dimX and dimY
+    Histogram2D Project(unsigned dimX, unsigned dimY) const {
+
+      CheckDimension(dimX);
+      CheckDimension(dimY);
+      Histogram2D out(nbins_[dimX], mins_[dimX], maxs_[dimX],
+                      nbins_[dimY], mins_[dimY], maxs_[dimY]);
+      for (BinMap::const_iterator it = bins_.begin();
+                                  it != bins_.end(); ++it) {
+        unsigned bb = GetBin(it->first, dimY) * nbins_[dimX] +
+                      GetBin(it->first, dimX);
+        out.data_[bb] += it->second.first;
+        out.dataW2_[bb] += it->second.second;
+      }
+      out.nEntries_ = nEntries_;
+      return out;
+    }
+
+    /// Packed bin keys of the filled bins, in increasing order
+    std::vector<uint64_t> GetFilledBins() const {
+      std::vector<uint64_t> keys;
+      keys.reserve(bins_.size());
+      for (BinMap::const_iterator it = bins_.begin();
+                                  it != bins_.end(); ++it) {
+        keys.push_back(it->first);
+      }
+      std::sort(keys.begin(), keys.end());
+      return keys;
+    }
+
+    /// Bin number in dimension dim of a packed bin key
+    unsigned GetBin(uint64_t key, unsigned dim) const {
+      return (key / strides_[dim]) % nbins_[dim];
+    }
+
+    double GetData(uint64_t key) const {
+      BinMap::const_iterator it = bins_.find(key);
+      return it == bins_.end() ? 0. : it->second.first;
+    }
+
+  private:
+
+    typedef std::unordered_map<uint64_t, std::pair<double, double> > BinMap;
+
+    std::vector<unsigned> nbins_;
+    std::vector<double> mins_;
+    std::vector<double> maxs_;
+    std::vector<double> rinvs_;
+    std::vector<uint64_t> strides_;
+
+    // Sum of weights and of squared weights for each filled bin
+    BinMap bins_;
+
+    double outOfRange_;
+    double outOfRangeW2_;
+    uint64_t nEntries_;
+
+    void CheckDimension(unsigned dim) const {
+      if (dim >= nbins_.size()) {
+        XCDFFatal("Histogram has no dimension " << dim);
+      }
+    }
+
+    uint64_t GetKey(const std::vector<unsigned>& bins) const {
+      if (bins.size() != nbins_.size()) {
+        XCDFFatal("Expected " << nbins_.size() << " bin numbers");
+      }
+      uint64_t key = 0;
+      for (unsigned i = 0; i < bins.size(); ++i) {
+        key += static_cast<uint64_t>(bins[i]) * strides_[i];
+      }
+      return key;
+    }
 };
 
 class RangeTest {
@@ -262,6 +897,26 @@ class RangeTest {
       }
     }
 
+    /// Include every entry of the expression for the current event
+    void Fill(const NumericalExpression<double>& ne) {
+      unsigned size = ne.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne.EvaluateBatch();
+      for (unsigned i = 0; i < size; ++i) {
+        Fill(x[i]);
+      }
+    }
+
+    /// Include the range of another test
+    void Add(const RangeTest& other) {
+      if (other.min_ <= other.max_) {
+        Fill(other.min_);
+        Fill(other.max_);
+      }
+    }
+
     // Use range [0,1] if no entries are made
     double GetMax() const {
       if (min_ > max_) {
@@ -307,27 +962,8 @@ class RangeChecker {
 
       // First, check if all expressions are fields in the file.
       // If so, we can just get the range directly
-      bool allFields = true;
-      for (unsigned i = 0; i < exprs_.size(); ++i) {
-        if (!f.HasField(exprs_[i])) {
-          allFields = false;
-          break;
-        }
-      }
-
-      if (allFields) {
-        for (unsigned i = 0; i < exprs_.size(); ++i) {
-          if (f.IsUnsignedIntegerField(exprs_[i])) {
-            rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).second);
-          } else if (f.IsSignedIntegerField(exprs_[i])) {
-            rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).second);
-          } else {
-            rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).first);
-            rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).second);
-          }
-        }
+      if (HasFieldRanges(f)) {
+        FillFieldRanges(f);
         return;
       }
 
@@ -340,18 +976,49 @@ class RangeChecker {
 
       while (f.Read()) {
         for (unsigned i = 0; i < exprs_.size(); ++i) {
-          unsigned max = nes[i].GetSize();
-          if (max == 1) {
-            rts_[i].Fill(nes[i].Evaluate());
-          } else {
-            for (unsigned j = 0; j < max; ++j) {
-              rts_[i].Fill(nes[i].Evaluate(j));
-            }
-          }
+          Fill(i, nes[i]);
+        }
+      }
+    }
+
+    /// True if all expressions are fields, so the ranges can be taken
+    /// from the file globals without reading events
+    bool HasFieldRanges(XCDFFile& f) const {
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        if (!f.HasField(exprs_[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    void FillFieldRanges(XCDFFile& f) {
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        if (f.IsUnsignedIntegerField(exprs_[i])) {
+          rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).first);
+          rts_[i].Fill(f.GetUnsignedIntegerFieldRange(exprs_[i]).second);
+        } else if (f.IsSignedIntegerField(exprs_[i])) {
+          rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).first);
+          rts_[i].Fill(f.GetSignedIntegerFieldRange(exprs_[i]).second);
+        } else {
+          rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).first);
+          rts_[i].Fill(f.GetFloatingPointFieldRange(exprs_[i]).second);
         }
       }
     }
 
+    /// Include the current event's values of expression i
+    void Fill(unsigned i, const NumericalExpression<double>& ne) {
+      rts_[i].Fill(ne);
+    }
+
+    /// Include the ranges found by a checker of the same expressions
+    void Add(const RangeChecker& other) {
+      for (unsigned i = 0; i < rts_.size(); ++i) {
+        rts_[i].Add(other.rts_[i]);
+      }
+    }
+
   private:
 
     std::vector<std::string> exprs_;
@@ -382,4 +1049,25 @@ std::ostream& operator<<(std::ostream& out, const Histogram2D& h) {
   return out;
 }
 
+// Print the filled bins only
+std::ostream& operator<<(std::ostream& out, const HistogramND& h) {
+
+  for (unsigned d = 0; d < h.GetNDimensions(); ++d) {
+    std::stringstream name;
+    name << "X" << d;
+    out << std::setw(8) << name.str() << " ";
+  }
+  out << "Value" << std::endl;
+  std::vector<uint64_t> keys = h.GetFilledBins();
+  for (std::vector<uint64_t>::const_iterator it = keys.begin();
+                                             it != keys.end(); ++it) {
+    for (unsigned d = 0; d < h.GetNDimensions(); ++d) {
+      out << std::setw(8) << h.GetBinCenter(d, h.GetBin(*it, d)) << " ";
+    }
+    out << h.GetData(*it) << std::endl;
+  }
+  out << std::endl;
+  return out;
+}
+
 #endif // XCDF_UTILITY_HISTOGRAM_H_INCLUDED
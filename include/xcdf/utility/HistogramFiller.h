@@ -27,9 +27,16 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_UTILITY_HISTOGRAM_FILLER_H_INCLUDED
 
 #include <xcdf/utility/NumericalExpression.h>
+#include <xcdf/utility/EventSelectExpression.h>
 #include <xcdf/utility/Histogram.h>
 #include <xcdf/XCDFPtr.h>
 
+#include <map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <exception>
+
 /*
  *  Objects that fill histograms.  Filling is dependent on the type
  *  of field and the relationships of the histogram field(s) and the
@@ -74,9 +81,13 @@ class VectorFiller1D : public DynamicFiller1D {
                    const NumericalExpression<double>& ne2) :
                                       DynamicFiller1D(ne1, ne2) { }
     void Fill(Histogram1D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i), ne2_.Evaluate());
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
       }
+      const double* x = ne1_.EvaluateBatch();
+      double w = ne2_.Evaluate();
+      FillPolicy::Fill(h, x, w, size);
     }
 };
 
@@ -89,9 +100,14 @@ class ParentFiller1D : public DynamicFiller1D {
                    const NumericalExpression<double>& ne2) :
                                       DynamicFiller1D(ne1, ne2) { }
     void Fill(Histogram1D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* w = ne2_.EvaluateBatch();
+      for (unsigned i = 0; i < size; ++i) {
+        FillPolicy::Fill(h, x[i], w[ne1_.GetHeadNode().GetParentIndex(i)]);
       }
     }
 };
@@ -104,9 +120,13 @@ class Vector12Filler1D : public DynamicFiller1D {
                      const NumericalExpression<double>& ne2) :
                                       DynamicFiller1D(ne1, ne2) { }
     void Fill(Histogram1D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        h.Fill(ne1_.Evaluate(i), ne2_.Evaluate(i));
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
       }
+      const double* x = ne1_.EvaluateBatch();
+      const double* w = ne2_.EvaluateBatch();
+      h.Fill(x, w, size);
     }
 };
 
@@ -114,10 +134,18 @@ typedef XCDFPtr<DynamicFiller1D> DynamicFiller1DPtr;
 
 struct FillXY {
   static void Fill(Histogram1D& h, double x, double y) {h.Fill(x, y);}
+  static void Fill(Histogram1D& h, const double* x, double y, unsigned n) {
+    h.Fill(x, y, n);
+  }
 };
 
 struct FillYX {
   static void Fill(Histogram1D& h, double y, double x) {h.Fill(x, y);}
+  static void Fill(Histogram1D& h, const double* y, double x, unsigned n) {
+    for (unsigned i = 0; i < n; ++i) {
+      h.Fill(x, y[i]);
+    }
+  }
 };
 
 DynamicFiller1DPtr GetFiller(NodeRelationType type,
@@ -170,6 +198,44 @@ class Filler1D {
       }
     }
 
+    /// Fill h from events [start, end) of f
+    void Fill(Histogram1D& h, XCDFFile& f, uint64_t start, uint64_t end) {
+
+      NumericalExpression<double> xne(xExpr_, f);
+      NumericalExpression<double> wne(wExpr_, f);
+      DynamicFiller1DPtr filler =
+               GetFiller(xne.GetNodeRelationType(wne), xne, wne);
+
+      if (start >= end || !f.Seek(start)) {
+        return;
+      }
+      filler->Fill(h);
+      for (uint64_t i = start + 1; i < end && f.Read(); ++i) {
+        filler->Fill(h);
+      }
+    }
+
+    /// Fill h while collecting the range of the x expression in rc,
+    /// so a deferred-range histogram needs only one pass over the data
+    void Fill(Histogram1D& h, XCDFFile& f, RangeChecker& rc) {
+
+      if (rc.HasFieldRanges(f)) {
+        rc.FillFieldRanges(f);
+        Fill(h, f);
+        return;
+      }
+
+      NumericalExpression<double> xne(xExpr_, f);
+      NumericalExpression<double> wne(wExpr_, f);
+      DynamicFiller1DPtr filler =
+               GetFiller(xne.GetNodeRelationType(wne), xne, wne);
+
+      while (f.Read()) {
+        filler->Fill(h);
+        rc.Fill(0, xne);
+      }
+    }
+
   private:
 
     std::string xExpr_;
@@ -218,9 +284,15 @@ class VectorFiller2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(), ne3_.Evaluate());
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      double y = ne2_.Evaluate();
+      double w = ne3_.Evaluate();
+      for (unsigned i = 0; i < size; ++i) {
+        FillPolicy::Fill(h, x[i], y, w);
       }
     }
 };
@@ -236,9 +308,15 @@ class Vector12Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(i), ne3_.Evaluate());
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      double w = ne3_.Evaluate();
+      for (unsigned i = 0; i < size; ++i) {
+        FillPolicy::Fill(h, x[i], y[i], w);
       }
     }
 };
@@ -254,10 +332,16 @@ class Parent12Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)),
-                         ne3_.Evaluate());
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      double w = ne3_.Evaluate();
+      for (unsigned i = 0; i < size; ++i) {
+        FillPolicy::Fill(h, x[i],
+                         y[ne1_.GetHeadNode().GetParentIndex(i)], w);
       }
     }
 };
@@ -272,9 +356,14 @@ class Vector123Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        h.Fill(ne1_.Evaluate(i), ne2_.Evaluate(i), ne3_.Evaluate(i));
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
       }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      const double* w = ne3_.EvaluateBatch();
+      h.Fill(x, y, w, size);
     }
 };
 
@@ -289,10 +378,16 @@ class Parent12v3Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(i),
-                         ne3_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      const double* w = ne3_.EvaluateBatch();
+      for (unsigned i = 0; i < size; ++i) {
+        FillPolicy::Fill(h, x[i], y[i],
+                         w[ne1_.GetHeadNode().GetParentIndex(i)]);
       }
     }
 };
@@ -308,10 +403,16 @@ class Parent1v23Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
-        FillPolicy::Fill(h, ne1_.Evaluate(i),
-                         ne2_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)),
-                         ne3_.Evaluate(ne1_.GetHeadNode().GetParentIndex(i)));
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      const double* w = ne3_.EvaluateBatch();
+      for (unsigned i = 0; i < size; ++i) {
+        unsigned parentIdx = ne1_.GetHeadNode().GetParentIndex(i);
+        FillPolicy::Fill(h, x[i], y[parentIdx], w[parentIdx]);
       }
     }
 };
@@ -327,10 +428,17 @@ class Parent1v2v3Filler2D : public DynamicFiller2D {
                                  DynamicFiller2D(ne1, ne2, ne3) { }
 
     void Fill(Histogram2D& h) const {
-      for (unsigned i = 0; i < ne1_.GetSize(); ++i) {
+      unsigned size = ne1_.GetSize();
+      if (size == 0) {
+        return;
+      }
+      const double* x = ne1_.EvaluateBatch();
+      const double* y = ne2_.EvaluateBatch();
+      const double* w = ne3_.EvaluateBatch();
+      for (unsigned i = 0; i < size; ++i) {
         unsigned interIdx = ne1_.GetHeadNode().GetParentIndex(i);
-        FillPolicy::Fill(h, ne1_.Evaluate(i), ne2_.Evaluate(interIdx),
-                ne3_.Evaluate(ne2_.GetHeadNode().GetParentIndex(interIdx)));
+        FillPolicy::Fill(h, x[i], y[interIdx],
+                         w[ne2_.GetHeadNode().GetParentIndex(interIdx)]);
       }
     }
 };
@@ -525,6 +633,51 @@ class Filler2D {
       }
     }
 
+    /// Fill h from events [start, end) of f
+    void Fill(Histogram2D& h, XCDFFile& f, uint64_t start, uint64_t end) {
+
+      NumericalExpression<double> xne(xExpr_, f);
+      NumericalExpression<double> yne(yExpr_, f);
+      NumericalExpression<double> wne(wExpr_, f);
+      DynamicFiller2DPtr filler =
+                 GetFiller(xne.GetNodeRelationType(yne),
+                           xne.GetNodeRelationType(wne),
+                           yne.GetNodeRelationType(wne), xne, yne, wne);
+
+      if (start >= end || !f.Seek(start)) {
+        return;
+      }
+      filler->Fill(h);
+      for (uint64_t i = start + 1; i < end && f.Read(); ++i) {
+        filler->Fill(h);
+      }
+    }
+
+    /// Fill h while collecting the ranges of the x and y expressions
+    /// in rc, so a deferred-range histogram needs only one pass
+    void Fill(Histogram2D& h, XCDFFile& f, RangeChecker& rc) {
+
+      if (rc.HasFieldRanges(f)) {
+        rc.FillFieldRanges(f);
+        Fill(h, f);
+        return;
+      }
+
+      NumericalExpression<double> xne(xExpr_, f);
+      NumericalExpression<double> yne(yExpr_, f);
+      NumericalExpression<double> wne(wExpr_, f);
+      DynamicFiller2DPtr filler =
+                 GetFiller(xne.GetNodeRelationType(yne),
+                           xne.GetNodeRelationType(wne),
+                           yne.GetNodeRelationType(wne), xne, yne, wne);
+
+      while (f.Read()) {
+        filler->Fill(h);
+        rc.Fill(0, xne);
+        rc.Fill(1, yne);
+      }
+    }
+
   private:
 
     std::string xExpr_;
@@ -532,4 +685,348 @@ class Filler2D {
     std::string wExpr_;
 };
 
+/*
+ *  Fill an N-dimensional histogram from one expression per axis and a
+ *  weight expression.  Each expression may be a scalar, a vector of the
+ *  same length as the longest expression, or the parent of the longest
+ *  expression.
+ */
+class FillerND {
+
+  public:
+
+    FillerND(const std::vector<std::string>& exprs,
+             const std::string& wExpr) : exprs_(exprs) {
+      exprs_.push_back(wExpr);
+    }
+
+    void Fill(HistogramND& h, XCDFFile& f) {
+
+      std::vector<NumericalExpression<double> > nes;
+      for (unsigned i = 0; i < exprs_.size(); ++i) {
+        nes.push_back(NumericalExpression<double>(exprs_[i], f));
+      }
+
+      // Find the expression that sets the number of entries per event
+      unsigned lead = 0;
+      for (unsigned i = 1; i < nes.size(); ++i) {
+        NodeRelationType type = nes[lead].GetNodeRelationType(nes[i]);
+        if (type == SCALAR_FIRST || type == PARENT_FIRST) {
+          lead = i;
+        }
+      }
+
+      // How each expression is indexed from the lead expression
+      std::vector<NodeRelationType> types(nes.size());
+      bool useParent = false;
+      for (unsigned i = 0; i < nes.size(); ++i) {
+        types[i] = nes[lead].GetNodeRelationType(nes[i]);
+        useParent |= i != lead && types[i] == PARENT_SECOND;
+        if (i != lead && !(types[i] == SCALAR ||
+                           types[i] == SCALAR_SECOND ||
+                           types[i] == VECTOR_VECTOR ||
+                           types[i] == PARENT_SECOND)) {
+          XCDFFatal("Cannot fill histogram: " << exprs_[i] <<
+                      " is not compatible with " << exprs_[lead]);
+        }
+      }
+
+      unsigned ndim = exprs_.size() - 1;
+      std::vector<const double*> data(nes.size());
+      std::vector<double> values(ndim);
+      while (f.Read()) {
+
+        unsigned size = nes[lead].GetSize();
+        if (size == 0) {
+          continue;
+        }
+        for (unsigned j = 0; j < nes.size(); ++j) {
+          data[j] = nes[j].GetSize() > 0 ? nes[j].EvaluateBatch() : NULL;
+        }
+
+        for (unsigned i = 0; i < size; ++i) {
+          unsigned parentIdx = useParent ?
+                      nes[lead].GetHeadNode().GetParentIndex(i) : 0;
+          double weight = 0.;
+          for (unsigned j = 0; j < nes.size(); ++j) {
+            unsigned idx = 0;
+            if (j == lead || types[j] == VECTOR_VECTOR) {
+              idx = i;
+            } else if (useParent && types[j] == PARENT_SECOND) {
+              idx = parentIdx;
+            }
+            if (j < ndim) {
+              values[j] = data[j][idx];
+            } else {
+              weight = data[j][idx];
+            }
+          }
+          h.Fill(&values[0], weight);
+        }
+      }
+    }
+
+  private:
+
+    // Axis expressions followed by the weight expression
+    std::vector<std::string> exprs_;
+};
+
+/*
+ *  Fill a histogram from several threads.  The events of each file are
+ *  split into contiguous ranges, and each range is read by its own
+ *  cloned reader into its own copy of the histogram.  The copies are
+ *  added to the result in range order once all threads finish, so no
+ *  locking is needed while filling.  Files without a block table, e.g.
+ *  streams, are filled serially.  FillPolicy is Filler1D or Filler2D.
+ */
+template <typename Histogram, typename FillPolicy>
+class ThreadedFiller {
+
+  public:
+
+    ThreadedFiller(FillPolicy& fill,
+                   unsigned nThreads) : fill_(fill),
+                                        nThreads_(nThreads > 0 ?
+                                                  nThreads : 1) { }
+
+    void Fill(Histogram& h, XCDFFile& f) {
+
+      if (nThreads_ == 1 || !f.HasBlockTable()) {
+        fill_.Fill(h, f);
+        return;
+      }
+
+      uint64_t count = f.GetEventCount();
+      std::vector<XCDFPtr<XCDFFile> > readers;
+      std::vector<Histogram> parts(nThreads_, h.EmptyCopy());
+      std::vector<std::exception_ptr> errors(nThreads_);
+      for (unsigned i = 0; i < nThreads_; ++i) {
+        readers.push_back(f.CloneReader());
+      }
+
+      std::vector<std::thread> threads;
+      for (unsigned i = 0; i < nThreads_; ++i) {
+        threads.push_back(std::thread(FillRange, &fill_, &parts[i],
+                                      readers[i],
+                                      count * i / nThreads_,
+                                      count * (i + 1) / nThreads_,
+                                      &errors[i]));
+      }
+      for (unsigned i = 0; i < nThreads_; ++i) {
+        threads[i].join();
+      }
+
+      for (unsigned i = 0; i < nThreads_; ++i) {
+        if (errors[i]) {
+          std::rethrow_exception(errors[i]);
+        }
+      }
+      for (unsigned i = 0; i < nThreads_; ++i) {
+        h.Add(parts[i]);
+      }
+    }
+
+  private:
+
+    FillPolicy& fill_;
+    unsigned nThreads_;
+
+    static void FillRange(FillPolicy* fill, Histogram* h,
+                          XCDFPtr<XCDFFile> f, uint64_t start,
+                          uint64_t end, std::exception_ptr* error) {
+      try {
+        fill->Fill(*h, *f, start, end);
+      } catch (...) {
+        *error = std::current_exception();
+      }
+    }
+};
+
+/*
+ *  Fill any number of 1D and 2D histograms in a single pass over the
+ *  data.  Each histogram has its own weight and an optional selection.
+ *  Fields are decoded once per event regardless of how many histograms
+ *  use them, identical expressions are compiled once, and identical
+ *  selections are evaluated once per event.  Expensive sub-expressions
+ *  shared between histograms can be defined as aliases, which are
+ *  evaluated once per event.
+ */
+class MultiFiller {
+
+  public:
+
+    /// Add a histogram.  If rc is given, the range of the axis
+    /// expression(s) over the filled entries is collected in rc.
+    void Add(Histogram1D& h,
+             const std::string& xExpr,
+             const std::string& wExpr,
+             const std::string& selExpr = "",
+             RangeChecker* rc = NULL) {
+
+      entries_.push_back(Entry(&h, NULL, xExpr, "", wExpr, selExpr, rc));
+    }
+
+    void Add(Histogram2D& h,
+             const std::string& xExpr,
+             const std::string& yExpr,
+             const std::string& wExpr,
+             const std::string& selExpr = "",
+             RangeChecker* rc = NULL) {
+
+      entries_.push_back(Entry(NULL, &h, xExpr, yExpr, wExpr, selExpr, rc));
+    }
+
+    unsigned GetNHistograms() const {return entries_.size();}
+
+    void Fill(XCDFFile& f) {
+
+      ExpressionMap nes;
+      std::map<std::string, int> selIndex;
+      std::vector<XCDFPtr<EventSelectExpression> > sels;
+      std::vector<ActiveEntry> active;
+      bool allSelected = true;
+
+      for (std::vector<Entry>::iterator it = entries_.begin();
+                                        it != entries_.end(); ++it) {
+
+        ActiveEntry a;
+        a.entry_ = &(*it);
+        a.sel_ = -1;
+        if (it->selExpr_ != "") {
+          std::map<std::string, int>::iterator sit =
+                                           selIndex.find(it->selExpr_);
+          if (sit == selIndex.end()) {
+            sels.push_back(xcdf_shared(
+                    new EventSelectExpression(it->selExpr_, f)));
+            sit = selIndex.insert(
+                    std::make_pair(it->selExpr_, sels.size() - 1)).first;
+          }
+          a.sel_ = sit->second;
+        } else {
+          allSelected = false;
+        }
+
+        // Ranges of bare fields come from the file globals, as long as
+        // every event is filled
+        a.checkRange_ = false;
+        if (it->rc_) {
+          if (a.sel_ < 0 && it->rc_->HasFieldRanges(f)) {
+            it->rc_->FillFieldRanges(f);
+          } else {
+            a.checkRange_ = true;
+          }
+        }
+
+        NumericalExpression<double>& xne = GetExpression(nes, it->xExpr_, f);
+        NumericalExpression<double>& wne = GetExpression(nes, it->wExpr_, f);
+        a.xne_ = &xne;
+        a.yne_ = NULL;
+        if (it->h1_) {
+          a.filler1D_ = GetFiller(xne.GetNodeRelationType(wne), xne, wne);
+        } else {
+          NumericalExpression<double>& yne =
+                                        GetExpression(nes, it->yExpr_, f);
+          a.yne_ = &yne;
+          a.filler2D_ = GetFiller(xne.GetNodeRelationType(yne),
+                                  xne.GetNodeRelationType(wne),
+                                  yne.GetNodeRelationType(wne),
+                                  xne, yne, wne);
+        }
+        active.push_back(a);
+      }
+
+      std::vector<char> pass(sels.size());
+      while (f.Read()) {
+
+        bool anyPass = !allSelected;
+        bool blockConstant = true;
+        for (unsigned i = 0; i < sels.size(); ++i) {
+          pass[i] = sels[i]->SelectEvent();
+          anyPass |= pass[i];
+          blockConstant &= sels[i]->IsBlockConstant();
+        }
+
+        // Nothing is filled from the rest of this block
+        if (!anyPass) {
+          if (blockConstant) {
+            f.SkipBlock();
+          }
+          continue;
+        }
+
+        for (std::vector<ActiveEntry>::iterator it = active.begin();
+                                                it != active.end(); ++it) {
+
+          if (it->sel_ >= 0 && !pass[it->sel_]) {
+            continue;
+          }
+          if (!it->filler1D_.IsNull()) {
+            it->filler1D_->Fill(*(it->entry_->h1_));
+          } else {
+            it->filler2D_->Fill(*(it->entry_->h2_));
+          }
+          if (it->checkRange_) {
+            it->entry_->rc_->Fill(0, *(it->xne_));
+            if (it->yne_) {
+              it->entry_->rc_->Fill(1, *(it->yne_));
+            }
+          }
+        }
+      }
+    }
+
+  private:
+
+    struct Entry {
+
+      Entry(Histogram1D* h1,
+            Histogram2D* h2,
+            const std::string& xExpr,
+            const std::string& yExpr,
+            const std::string& wExpr,
+            const std::string& selExpr,
+            RangeChecker* rc) : h1_(h1), h2_(h2),
+                                xExpr_(xExpr), yExpr_(yExpr),
+                                wExpr_(wExpr), selExpr_(selExpr),
+                                rc_(rc) { }
+
+      Histogram1D* h1_;
+      Histogram2D* h2_;
+      std::string xExpr_;
+      std::string yExpr_;
+      std::string wExpr_;
+      std::string selExpr_;
+      RangeChecker* rc_;
+    };
+
+    // Per-file state of an entry
+    struct ActiveEntry {
+      Entry* entry_;
+      DynamicFiller1DPtr filler1D_;
+      DynamicFiller2DPtr filler2D_;
+      const NumericalExpression<double>* xne_;
+      const NumericalExpression<double>* yne_;
+      int sel_;
+      bool checkRange_;
+    };
+
+    typedef std::map<std::string,
+                     XCDFPtr<NumericalExpression<double> > > ExpressionMap;
+
+    static NumericalExpression<double>&
+    GetExpression(ExpressionMap& nes,
+                  const std::string& exp, const XCDFFile& f) {
+
+      ExpressionMap::iterator it = nes.find(exp);
+      if (it == nes.end()) {
+        it = nes.insert(std::make_pair(exp, xcdf_shared(
+                   new NumericalExpression<double>(exp, f)))).first;
+      }
+      return *(it->second);
+    }
+
+    std::vector<Entry> entries_;
+};
+
 #endif // XCDF_UTILITY_HISTOGRAM_FILLER_H_INCLUDED
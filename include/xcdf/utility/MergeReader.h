@@ -0,0 +1,179 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_MERGE_READER_H_INCLUDED
+#define XCDF_UTILITY_MERGE_READER_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFPtr.h>
+#include <xcdf/utility/NumericalExpression.h>
+
+#include <vector>
+#include <queue>
+#include <string>
+#include <utility>
+#include <cmath>
+#include <stdint.h>
+
+/*
+ *  True if key comes before the previous key of an ordered file.
+ *  Floating point values re-quantized in a new XCDF block can step back
+ *  by a few units in the last place, which is tolerated.
+ */
+inline bool KeyDecreases(double key, double previous) {
+  return KeyLess(key, previous) &&
+         !(previous - key <= 1e-12 * std::fabs(previous));
+}
+
+inline bool KeyDecreases(uint64_t key, uint64_t previous) {
+  return key < previous;
+}
+
+inline bool KeyDecreases(int64_t key, int64_t previous) {
+  return key < previous;
+}
+
+/*
+ *  Reads several files, each ordered by a key expression, as a single
+ *  stream of events in key order.  Only the current block of each file is
+ *  held in memory.  Events with equal keys are read from earlier files
+ *  first.  After Read(), the event is in the fields of GetCurrentFile().
+ *  Key is the type used to compare keys, e.g. uint64_t for exact
+ *  comparison of integer times.  A file whose keys decrease gives a
+ *  warning, and its events are then merged in the order read.
+ *
+ *  Example:
+ *
+ *    MergeReader<uint64_t> reader(fileNames, "gpsTime");
+ *    while (reader.Read()) {
+ *      XCDFFile& f = reader.GetCurrentFile();
+ *      ...
+ *    }
+ */
+template <typename Key>
+class MergeReader {
+
+  public:
+
+    MergeReader(const std::vector<std::string>& fileNames,
+                const std::string& keyExp) : keyExp_(keyExp),
+                                             started_(false),
+                                             current_(0),
+                                             currentKey_(0) {
+
+      for (unsigned i = 0; i < fileNames.size(); ++i) {
+        files_.push_back(xcdf_shared(new XCDFFile(fileNames[i].c_str(), "r")));
+        if (!files_.back()->IsOpen()) {
+          XCDFFatal("Unable to open " << fileNames[i] << " for merging");
+        }
+        keys_.push_back(xcdf_shared(
+                      new NumericalExpression<Key>(keyExp, *files_[i])));
+        lastKeys_.push_back(0);
+        hasLastKey_.push_back(false);
+        unordered_.push_back(false);
+      }
+    }
+
+    unsigned GetNFiles() const {return files_.size();}
+    XCDFFile& GetFile(unsigned i) {return *files_[i];}
+
+    /// Read the next event in key order.  False when all files are done.
+    bool Read() {
+
+      // Read the first event of every file, or the next one of the
+      // file the last event came from
+      if (!started_) {
+        started_ = true;
+        for (unsigned i = 0; i < files_.size(); ++i) {
+          Advance(i);
+        }
+      } else if (current_ < files_.size()) {
+        Advance(current_);
+      }
+
+      if (next_.empty()) {
+        current_ = files_.size();
+        return false;
+      }
+      current_ = next_.top().second;
+      currentKey_ = next_.top().first;
+      next_.pop();
+      return true;
+    }
+
+    unsigned GetCurrentFileIndex() const {return current_;}
+    XCDFFile& GetCurrentFile() {return *files_[current_];}
+    Key GetCurrentKey() const {return currentKey_;}
+
+  private:
+
+    typedef std::pair<Key, unsigned> Entry;
+
+    // Orders the heap so the smallest key, then earliest file, is on top
+    struct After {
+      bool operator()(const Entry& a, const Entry& b) const {
+        return KeyLess(b.first, a.first) ||
+               (!KeyLess(a.first, b.first) && a.second > b.second);
+      }
+    };
+
+    std::string keyExp_;
+    std::vector<XCDFPtr<XCDFFile> > files_;
+    std::vector<XCDFPtr<NumericalExpression<Key> > > keys_;
+    std::vector<Key> lastKeys_;
+    std::vector<bool> hasLastKey_;
+    std::vector<bool> unordered_;
+    std::priority_queue<Entry, std::vector<Entry>, After> next_;
+    bool started_;
+    unsigned current_;
+    Key currentKey_;
+
+    void Advance(unsigned i) {
+
+      if (!files_[i]->Read()) {
+        return;
+      }
+
+      const NumericalExpression<Key>& key = *keys_[i];
+      if (key.GetSize() != 1) {
+        XCDFFatal("Merge key \"" << keyExp_ << "\" has " << key.GetSize() <<
+                          " values in event of " <<
+                          files_[i]->GetCurrentFileName() << ", expected 1");
+      }
+
+      Key k = key.Evaluate();
+      if (hasLastKey_[i] && !unordered_[i] && KeyDecreases(k, lastKeys_[i])) {
+        XCDFWarn("File " << files_[i]->GetCurrentFileName() <<
+                 " is not ordered by \"" << keyExp_ << "\"");
+        unordered_[i] = true;
+      }
+      lastKeys_[i] = k;
+      hasLastKey_[i] = true;
+      next_.push(Entry(k, i));
+    }
+};
+
+#endif // XCDF_UTILITY_MERGE_READER_H_INCLUDED
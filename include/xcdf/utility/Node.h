@@ -30,6 +30,8 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/utility/Symbol.h>
 #include <xcdf/XCDFDefs.h>
 
+#include <vector>
+
 template <typename T>
 class Node : public Symbol {
 
@@ -39,6 +41,19 @@ class Node : public Symbol {
     virtual T operator[](unsigned index) const = 0;
     virtual unsigned GetSize() const = 0;
 
+    // Evaluate all GetSize() entries of the node for the current event
+    // in one pass.  The returned array is valid until the node is next
+    // evaluated.  Derived nodes override this with tight loops over the
+    // batches of their children.
+    virtual const T* EvaluateBatch() const {
+      unsigned size = GetSize();
+      batch_.resize(size);
+      for (unsigned i = 0; i < size; ++i) {
+        batch_[i] = (*this)[i];
+      }
+      return batch_.data();
+    }
+
     // Need to know more about vector fields to understand
     // proper evaluation relationships.  Treat any node as
     // if it is derived from an XCDFField.  This is a bit
@@ -53,6 +68,16 @@ class Node : public Symbol {
     virtual bool HasGrandparent() const {return false;}
     virtual const std::string& GetGrandparentName() const {return NO_PARENT;}
     virtual unsigned GetParentIndex(unsigned index) const {return 0;}
+
+    // True if the node has the same value for every event in the block
+    // currently being read, e.g. it depends only on constants and on
+    // scalar fields stored with zero bits in the block.
+    virtual bool IsBlockConstant() const {return false;}
+
+  protected:
+
+    // Output buffer for batch evaluation
+    mutable std::vector<T> batch_;
 };
 
 template <> inline
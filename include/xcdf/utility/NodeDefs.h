@@ -32,7 +32,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cmath>
 #include <algorithm>
-#include <set>
+#include <vector>
 
 template <typename T>
 class ConstNode : public Node<T> {
@@ -43,6 +43,8 @@ class ConstNode : public Node<T> {
 
     T operator[](unsigned index) const {return datum_;}
     unsigned GetSize() const {return 1;}
+    const T* EvaluateBatch() const {return &datum_;}
+    bool IsBlockConstant() const {return true;}
 
   private:
 
@@ -135,16 +137,74 @@ class BinaryNode : public Node<ReturnType> {
       switch (type_) {
         default:
         case SCALAR:
-        case SCALAR_FIRST: return DoEvaluation(n1_[0], n2_[index]);
-        case VECTOR_VECTOR: return DoEvaluation(n1_[index], n2_[index]);
-        case SCALAR_SECOND: return DoEvaluation(n1_[index], n2_[0]);
-        case PARENT_FIRST: return DoEvaluation(
-                               n1_[n2_.GetParentIndex(index)], n2_[index]);
-        case PARENT_SECOND: return DoEvaluation(
-                               n1_[index], n2_[n1_.GetParentIndex(index)]);
+        case SCALAR_FIRST: return EvaluatePair(0, index);
+        case VECTOR_VECTOR: return EvaluatePair(index, index);
+        case SCALAR_SECOND: return EvaluatePair(index, 0);
+        case PARENT_FIRST: return EvaluatePair(
+                               n2_.GetParentIndex(index), index);
+        case PARENT_SECOND: return EvaluatePair(
+                               index, n1_.GetParentIndex(index));
       }
     }
 
+    const ReturnType* EvaluateBatch() const {
+
+      unsigned size = GetSize();
+      this->batch_.resize(size);
+      ReturnType* out = this->batch_.data();
+      if (size == 0) {
+        return out;
+      }
+
+      const T* a = n1_.EvaluateBatch();
+      if (static_cast<const Derived*>(this)->CanShortCircuit()) {
+        unsigned nDecided = ShortCircuitBatch(a, out, size);
+        if (nDecided == size) {
+          return out;
+        }
+        // The second operand may be guarded by the first, as in
+        // "d != 0 && n / d > 1", so only evaluate it where needed
+        if (nDecided > 0) {
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = (*this)[i];
+          }
+          return out;
+        }
+      }
+
+      const U* b = n2_.EvaluateBatch();
+      switch (type_) {
+        default:
+        case SCALAR:
+        case SCALAR_FIRST:
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = DoEvaluation(a[0], b[i]);
+          }
+          break;
+        case VECTOR_VECTOR:
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = DoEvaluation(a[i], b[i]);
+          }
+          break;
+        case SCALAR_SECOND:
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = DoEvaluation(a[i], b[0]);
+          }
+          break;
+        case PARENT_FIRST:
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = DoEvaluation(a[n2_.GetParentIndex(i)], b[i]);
+          }
+          break;
+        case PARENT_SECOND:
+          for (unsigned i = 0; i < size; ++i) {
+            out[i] = DoEvaluation(a[i], b[n1_.GetParentIndex(i)]);
+          }
+          break;
+      }
+      return out;
+    }
+
     GetSizePolicy::ReturnType GetSize() const {
       return ApplyToLargerNode(GetSizePolicy());
     }
@@ -174,6 +234,10 @@ class BinaryNode : public Node<ReturnType> {
       return ApplyToLargerNode(GetParentIndexPolicy(index));
     }
 
+    bool IsBlockConstant() const {
+      return n1_.IsBlockConstant() && n2_.IsBlockConstant();
+    }
+
   private:
 
     Node<T>& n1_;
@@ -200,6 +264,53 @@ class BinaryNode : public Node<ReturnType> {
       return static_cast<const Derived*>(this)->Evaluate(
                  static_cast<DominantType>(a), static_cast<DominantType>(b));
     }
+
+    bool DoShortCircuit(T a, ReturnType& result) const {
+      return static_cast<const Derived*>(this)->ShortCircuit(
+                                      static_cast<DominantType>(a), result);
+    }
+
+    // Only evaluate the second operand if the first does not decide
+    ReturnType EvaluatePair(unsigned index1, unsigned index2) const {
+      T a = n1_[index1];
+      ReturnType result;
+      if (DoShortCircuit(a, result)) {
+        return result;
+      }
+      return DoEvaluation(a, n2_[index2]);
+    }
+
+    // Fill the batch entries decided by the first operand alone.
+    // Returns the number of decided entries.
+    unsigned ShortCircuitBatch(const T* a,
+                               ReturnType* out, unsigned size) const {
+      unsigned nDecided = 0;
+      for (unsigned i = 0; i < size; ++i) {
+        unsigned index1 = i;
+        switch (type_) {
+          default:
+          case SCALAR:
+          case SCALAR_FIRST: index1 = 0; break;
+          case VECTOR_VECTOR:
+          case SCALAR_SECOND:
+          case PARENT_SECOND: break;
+          case PARENT_FIRST: index1 = n2_.GetParentIndex(i); break;
+        }
+        nDecided += DoShortCircuit(a[index1], out[i]);
+      }
+      return nDecided;
+    }
+
+  protected:
+
+    // Derived nodes may override this to decide their result from the
+    // first operand alone, skipping evaluation of the second operand.
+    bool ShortCircuit(DominantType a, ReturnType& result) const {
+      return false;
+    }
+
+    // Derived nodes overriding ShortCircuit() also return true here
+    bool CanShortCircuit() const {return false;}
 };
 
 template <typename T, typename ReturnType, typename Derived>
@@ -211,6 +322,19 @@ class UnaryNode : public Node<ReturnType> {
       return DoEvaluation(node_[idx]);
     }
 
+    const ReturnType* EvaluateBatch() const {
+      unsigned size = node_.GetSize();
+      this->batch_.resize(size);
+      ReturnType* out = this->batch_.data();
+      if (size > 0) {
+        const T* a = node_.EvaluateBatch();
+        for (unsigned i = 0; i < size; ++i) {
+          out[i] = DoEvaluation(a[i]);
+        }
+      }
+      return out;
+    }
+
     unsigned GetSize() const {return node_.GetSize();}
     const std::string& GetName() const {return node_.GetName();}
 
@@ -225,6 +349,8 @@ class UnaryNode : public Node<ReturnType> {
       return node_.GetParentIndex(index);
     }
 
+    bool IsBlockConstant() const {return node_.IsBlockConstant();}
+
   private:
 
     Node<T>& node_;
@@ -410,6 +536,16 @@ class LogicalANDNode :
                          LogicalANDNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a && b;}
+
+    bool ShortCircuit(DominantType a, uint64_t& result) const {
+      if (!a) {
+        result = 0;
+        return true;
+      }
+      return false;
+    }
+
+    bool CanShortCircuit() const {return true;}
 };
 
 template <typename T, typename U, typename DominantType>
@@ -424,6 +560,16 @@ class LogicalORNode :
                          LogicalORNode<T, U, DominantType> >(n1, n2) { }
 
     uint64_t Evaluate(DominantType a, DominantType b) const {return a || b;}
+
+    bool ShortCircuit(DominantType a, uint64_t& result) const {
+      if (a) {
+        result = 1;
+        return true;
+      }
+      return false;
+    }
+
+    bool CanShortCircuit() const {return true;}
 };
 
 template <typename T, typename U, typename DominantType>
@@ -523,22 +669,57 @@ class BitwiseNOTNode<double> :
   }
 };
 
+/// Strict ordering of values, with NaN after all other values
+template <typename T>
+inline bool KeyLess(T a, T b) {return a < b;}
+
+template <>
+inline bool KeyLess(double a, double b) {
+  return a < b || (std::isnan(b) && !std::isnan(a));
+}
+
+/// Equality under KeyLess: all NaNs are equal
+template <typename T>
+inline bool KeyEqual(T a, T b) {return !KeyLess(a, b) && !KeyLess(b, a);}
+
 template <typename T>
 class InNode : public UnaryNode<T, uint64_t, InNode<T> > {
 
   public:
 
     InNode(Node<T>& node, const std::vector<T>& data) :
-                     UnaryNode<T, uint64_t, InNode<T> >(node) {
-      for (typename std::vector<T>::const_iterator it = data.begin();
-                                                   it != data.end(); ++it) {
-        data_.insert(static_cast<T>(*it));
+                     UnaryNode<T, uint64_t, InNode<T> >(node), data_(data) {
+
+      // Keep the values in a flat sorted array for binary search.  NaN
+      // equals nothing, so it is dropped from the list.
+      data_.erase(std::remove_if(data_.begin(), data_.end(), IsNaN),
+                  data_.end());
+      std::sort(data_.begin(), data_.end(), KeyLess<T>);
+      data_.erase(std::unique(data_.begin(), data_.end()), data_.end());
+    }
+
+    uint64_t Evaluate(T a) const {
+
+      // A linear scan is faster for short lists
+      if (data_.size() <= LINEAR_SEARCH_MAX) {
+        for (unsigned i = 0; i < data_.size(); ++i) {
+          if (data_[i] == a) {
+            return true;
+          }
+        }
+        return false;
       }
+      return std::binary_search(data_.begin(), data_.end(), a, KeyLess<T>) &&
+             !IsNaN(a);
     }
-    uint64_t Evaluate(T a) const {return data_.find(a) != data_.end();}
 
   private:
-    std::set<T> data_;
+
+    static const unsigned LINEAR_SEARCH_MAX = 16;
+
+    static bool IsNaN(T a) {return a != a;}
+
+    std::vector<T> data_;
 };
 
 template <typename T, typename U>
@@ -550,97 +731,231 @@ class CastNode : public UnaryNode<U, T, CastNode<T, U> > {
   T Evaluate(U a) const {return static_cast<T>(a);}
 };
 
-template <typename T>
-class UniqueNode : public Node<uint64_t> {
+/*
+ * Base for functions reducing all entries of a node to a single value.
+ * Derived classes implement Reduce() over the evaluated batch.  Scratch
+ * space is kept by the node, so no allocation is done per event.
+ */
+template <typename T, typename ReturnType, typename Derived>
+class ReductionNode : public Node<ReturnType> {
 
   public:
 
-    UniqueNode(Node<T>& node) : node_(node) { }
-    uint64_t operator[](unsigned idx) const {
+    ReductionNode(Node<T>& node) : node_(node) { }
 
-      data_.clear();
-      for (unsigned i = 0; i < node_.GetSize(); ++i) {
-        data_.insert(node_[i]);
-      }
-      return data_.size();
+    ReturnType operator[](unsigned idx) const {
+      unsigned size = node_.GetSize();
+      const T* a = size > 0 ? node_.EvaluateBatch() : NULL;
+      return static_cast<const Derived*>(this)->Reduce(a, size);
     }
     unsigned GetSize() const {return 1;}
+    bool IsBlockConstant() const {return node_.IsBlockConstant();}
 
   private:
 
-    mutable std::set<T> data_;
     Node<T>& node_;
 };
 
 template <typename T>
-class AnyNode : public Node<uint64_t> {
+class UniqueNode : public ReductionNode<T, uint64_t, UniqueNode<T> > {
 
   public:
 
-    AnyNode(Node<T>& node) : node_(node) { }
-    uint64_t operator[](unsigned idx) const {
+    UniqueNode(Node<T>& node) :
+               ReductionNode<T, uint64_t, UniqueNode<T> >(node) { }
 
-      for (unsigned i = 0; i < node_.GetSize(); ++i) {
-        // Note that this is node_[i] != 0, as defined by the C++ spec
-        if (node_[i]) {
-          return true;
-        }
+    uint64_t Reduce(const T* a, unsigned size) const {
+      if (size < 2) {
+        return size;
       }
-      return false;
+      // Count distinct values in a sorted copy, with all NaNs counted
+      // as one value.  The buffer keeps its capacity between events.
+      data_.assign(a, a + size);
+      std::sort(data_.begin(), data_.end(), KeyLess<T>);
+      return std::unique(data_.begin(), data_.end(), KeyEqual<T>) -
+             data_.begin();
     }
-    unsigned GetSize() const {return 1;}
 
   private:
 
-    Node<T>& node_;
+    mutable std::vector<T> data_;
+};
+
+template <typename T>
+class AnyNode : public ReductionNode<T, uint64_t, AnyNode<T> > {
+
+  public:
+
+    AnyNode(Node<T>& node) : ReductionNode<T, uint64_t, AnyNode<T> >(node) { }
+
+    uint64_t Reduce(const T* a, unsigned size) const {
+      for (unsigned i = 0; i < size; ++i) {
+        // Note that this is a[i] != 0, as defined by the C++ spec
+        if (a[i]) {
+          return true;
+        }
+      }
+      return false;
+    }
 };
 
 template <typename T>
-class AllNode : public Node<uint64_t> {
+class AllNode : public ReductionNode<T, uint64_t, AllNode<T> > {
 
   public:
 
-    AllNode(Node<T>& node) : node_(node) { }
-    uint64_t operator[](unsigned idx) const {
+    AllNode(Node<T>& node) : ReductionNode<T, uint64_t, AllNode<T> >(node) { }
 
+    uint64_t Reduce(const T* a, unsigned size) const {
       // Need to explicitly check size and return false if size is zero
-      if (node_.GetSize() == 0) {
+      if (size == 0) {
         return false;
       }
-
-      for (unsigned i = 0; i < node_.GetSize(); ++i) {
-        // Note that this is node_[i] == 0, as defined by the C++ spec
-        if (!node_[i]) {
+      for (unsigned i = 0; i < size; ++i) {
+        // Note that this is a[i] == 0, as defined by the C++ spec
+        if (!a[i]) {
           return false;
         }
       }
       return true;
     }
-    unsigned GetSize() const {return 1;}
-
-  private:
-
-    Node<T>& node_;
 };
 
 template <typename T>
-class SumNode : public Node<T> {
+class SumNode : public ReductionNode<T, T, SumNode<T> > {
 
   public:
 
-    SumNode(Node<T>& node) : node_(node) { }
-    T operator[](unsigned idx) const {
+    SumNode(Node<T>& node) : ReductionNode<T, T, SumNode<T> >(node) { }
 
+    T Reduce(const T* a, unsigned size) const {
       T sum = 0;
-      for (unsigned i = 0; i < node_.GetSize(); ++i) {
-        sum += node_[i];
+      for (unsigned i = 0; i < size; ++i) {
+        sum += a[i];
       }
       return sum;
     }
-    unsigned GetSize() const {return 1;}
+};
 
-  private:
-    Node<T>& node_;
+// Minimum entry, or zero if there are no entries
+template <typename T>
+class MinNode : public ReductionNode<T, T, MinNode<T> > {
+
+  public:
+
+    MinNode(Node<T>& node) : ReductionNode<T, T, MinNode<T> >(node) { }
+
+    T Reduce(const T* a, unsigned size) const {
+      if (size == 0) {
+        return 0;
+      }
+      T min = a[0];
+      for (unsigned i = 1; i < size; ++i) {
+        min = a[i] < min ? a[i] : min;
+      }
+      return min;
+    }
+};
+
+// Maximum entry, or zero if there are no entries
+template <typename T>
+class MaxNode : public ReductionNode<T, T, MaxNode<T> > {
+
+  public:
+
+    MaxNode(Node<T>& node) : ReductionNode<T, T, MaxNode<T> >(node) { }
+
+    T Reduce(const T* a, unsigned size) const {
+      if (size == 0) {
+        return 0;
+      }
+      T max = a[0];
+      for (unsigned i = 1; i < size; ++i) {
+        max = a[i] > max ? a[i] : max;
+      }
+      return max;
+    }
+};
+
+// Mean of the entries, or NaN if there are no entries
+template <typename T>
+class MeanNode : public ReductionNode<T, double, MeanNode<T> > {
+
+  public:
+
+    MeanNode(Node<T>& node) : ReductionNode<T, double, MeanNode<T> >(node) { }
+
+    double Reduce(const T* a, unsigned size) const {
+      double sum = 0.;
+      for (unsigned i = 0; i < size; ++i) {
+        sum += static_cast<double>(a[i]);
+      }
+      return sum / size;
+    }
+};
+
+// Number of non-zero entries
+template <typename T>
+class CountNode : public ReductionNode<T, uint64_t, CountNode<T> > {
+
+  public:
+
+    CountNode(Node<T>& node) :
+               ReductionNode<T, uint64_t, CountNode<T> >(node) { }
+
+    uint64_t Reduce(const T* a, unsigned size) const {
+      uint64_t count = 0;
+      for (unsigned i = 0; i < size; ++i) {
+        count += a[i] != 0;
+      }
+      return count;
+    }
+};
+
+// Index of the first maximum entry, or zero if there are no entries
+template <typename T>
+class ArgMaxNode : public ReductionNode<T, uint64_t, ArgMaxNode<T> > {
+
+  public:
+
+    ArgMaxNode(Node<T>& node) :
+               ReductionNode<T, uint64_t, ArgMaxNode<T> >(node) { }
+
+    uint64_t Reduce(const T* a, unsigned size) const {
+      unsigned argmax = 0;
+      for (unsigned i = 1; i < size; ++i) {
+        if (a[i] > a[argmax]) {
+          argmax = i;
+        }
+      }
+      return argmax;
+    }
+};
+
+// First entry, or zero if there are no entries
+template <typename T>
+class FirstNode : public ReductionNode<T, T, FirstNode<T> > {
+
+  public:
+
+    FirstNode(Node<T>& node) : ReductionNode<T, T, FirstNode<T> >(node) { }
+
+    T Reduce(const T* a, unsigned size) const {
+      return size > 0 ? a[0] : 0;
+    }
+};
+
+// Last entry, or zero if there are no entries
+template <typename T>
+class LastNode : public ReductionNode<T, T, LastNode<T> > {
+
+  public:
+
+    LastNode(Node<T>& node) : ReductionNode<T, T, LastNode<T> >(node) { }
+
+    T Reduce(const T* a, unsigned size) const {
+      return size > 0 ? a[size - 1] : 0;
+    }
 };
 
 template <typename T>
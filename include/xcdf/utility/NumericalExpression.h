@@ -50,22 +50,20 @@ class NumericalExpression {
                         const XCDFFile& f) :
               expression_(xcdf_shared(new Expression(exp, f))) {
 
-      Symbol* start = expression_->GetHeadSymbol();
+      // Scalar expressions are evaluated through a flat program
+      Symbol* start = expression_->Compile(expression_->GetHeadSymbol());
       switch (start->GetType()) {
 
         case FLOATING_POINT_NODE:
-          masterNode_ = XCDFPtr<Node<R> >(
-             new CastNode<R, double>(*static_cast<Node<double>* >(start)));
+          SetHeadNode(static_cast<Node<double>* >(start));
           break;
 
         case SIGNED_NODE:
-          masterNode_ = XCDFPtr<Node<R> >(
-             new CastNode<R, int64_t>(*static_cast<Node<int64_t>* >(start)));
+          SetHeadNode(static_cast<Node<int64_t>* >(start));
           break;
 
         case UNSIGNED_NODE:
-          masterNode_ = XCDFPtr<Node<R> >(
-             new CastNode<R, uint64_t>(*static_cast<Node<uint64_t>* >(start)));
+          SetHeadNode(static_cast<Node<uint64_t>* >(start));
           break;
 
         default:
@@ -73,7 +71,7 @@ class NumericalExpression {
       }
     }
 
-    uint64_t GetSize() const {return masterNode_->GetSize();}
+    uint64_t GetSize() const {return headNode_->GetSize();}
 
     R Evaluate() const {return Evaluate(0);}
 
@@ -83,19 +81,34 @@ class NumericalExpression {
         XCDFFatal("Evaluation index: " << index
                            << " out of range.  Max: " << GetSize());
       }
-      return (*masterNode_)[index];
+      return (*headNode_)[index];
     }
 
+    /// Evaluate all GetSize() entries in one pass.  The returned array
+    /// is valid until the expression is next evaluated.
+    const R* EvaluateBatch() const {return headNode_->EvaluateBatch();}
+
     NodeRelationType GetNodeRelationType(const NumericalExpression& ex) const {
-      return GetRelationType(*masterNode_, *(ex.masterNode_));
+      return GetRelationType(*headNode_, *(ex.headNode_));
     }
 
-    const Node<R>& GetHeadNode() const {return *masterNode_;}
+    const Node<R>& GetHeadNode() const {return *headNode_;}
 
   private:
 
     XCDFPtr<Expression> expression_;
     XCDFPtr<Node<R> > masterNode_;
+    const Node<R>* headNode_;
+
+    // Wrap the parsed expression in a cast to the requested type
+    template <typename T>
+    void SetHeadNode(Node<T>* node) {
+      masterNode_ = XCDFPtr<Node<R> >(new CastNode<R, T>(*node));
+      headNode_ = &(*masterNode_);
+    }
+
+    // Expression already evaluates to the requested type: no cast needed
+    void SetHeadNode(Node<R>* node) {headNode_ = node;}
 };
 
 #endif // XCDF_UTILITY_NUMERICAL_EXPRESSION_INCLUDED_H
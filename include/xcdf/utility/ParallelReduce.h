@@ -0,0 +1,295 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_PARALLEL_REDUCE_H_INCLUDED
+#define XCDF_UTILITY_PARALLEL_REDUCE_H_INCLUDED
+
+#include <xcdf/XCDFFile.h>
+#include <xcdf/XCDFDefs.h>
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <stdint.h>
+
+/*
+ *  Tools to process many input files on a pool of threads.  The input is
+ *  cut into work units, each a whole file or a range of events in one
+ *  file.  Every unit produces its own result, and the results are merged
+ *  in unit order, so the outcome does not depend on thread scheduling.
+ */
+
+struct WorkUnit {
+
+  WorkUnit(const std::string& fileName) : fileName_(fileName),
+                                          start_(0),
+                                          end_(0),
+                                          wholeFile_(true) { }
+
+  WorkUnit(const std::string& fileName,
+           uint64_t start, uint64_t end) : fileName_(fileName),
+                                           start_(start),
+                                           end_(end),
+                                           wholeFile_(false) { }
+
+  bool IsWholeFile() const {return wholeFile_;}
+
+  std::string fileName_;
+
+  // Event range [start_, end_) if not the whole file
+  uint64_t start_;
+  uint64_t end_;
+  bool wholeFile_;
+};
+
+/*
+ *  Cut the files into work units for nThreads threads.  With enough
+ *  files, each file is one unit.  With fewer files than about two per
+ *  thread and splitFiles set, files with a block table are cut into
+ *  event ranges so that every thread has work.  A nonzero maxUnitEvents
+ *  also cuts files with a block table into ranges of at most that many
+ *  events, bounding the size of each unit's result.
+ */
+inline std::vector<WorkUnit> GetWorkUnits(
+                                const std::vector<std::string>& files,
+                                unsigned nThreads, bool splitFiles,
+                                uint64_t maxUnitEvents = 0) {
+
+  std::vector<WorkUnit> units;
+  bool split = splitFiles && files.size() < 2 * nThreads;
+  if (!split && maxUnitEvents == 0) {
+    for (unsigned i = 0; i < files.size(); ++i) {
+      units.push_back(WorkUnit(files[i]));
+    }
+    return units;
+  }
+
+  // Aim for a few units per thread so uneven ranges balance out
+  uint64_t nRanges = 1;
+  if (split) {
+    nRanges = (4 * nThreads + files.size() - 1) / files.size();
+  }
+  for (unsigned i = 0; i < files.size(); ++i) {
+
+    XCDFFile f(files[i].c_str(), "r");
+    uint64_t count = f.GetEventCount();
+    uint64_t n = nRanges;
+    if (maxUnitEvents > 0) {
+      n = std::max(n, (count + maxUnitEvents - 1) / maxUnitEvents);
+    }
+    if (!f.HasBlockTable() || count < n || n < 2) {
+      units.push_back(WorkUnit(files[i]));
+      continue;
+    }
+    for (uint64_t j = 0; j < n; ++j) {
+      units.push_back(WorkUnit(files[i], count * j / n,
+                                         count * (j + 1) / n));
+    }
+  }
+  return units;
+}
+
+/*
+ *  Read the events of a work unit from a file opened on its file
+ */
+class WorkUnitReader {
+
+  public:
+
+    /// Read the whole file
+    WorkUnitReader(XCDFFile& f) : f_(f),
+                                  unit_(f.GetCurrentFileName()),
+                                  first_(true),
+                                  done_(false) { }
+
+    WorkUnitReader(XCDFFile& f,
+                   const WorkUnit& unit) : f_(f),
+                                           unit_(unit),
+                                           first_(true),
+                                           done_(false) { }
+
+    bool Read() {
+
+      if (unit_.IsWholeFile()) {
+        return f_.Read();
+      }
+      if (done_) {
+        return false;
+      }
+      if (first_) {
+        first_ = false;
+        done_ = unit_.start_ >= unit_.end_ || !f_.Seek(unit_.start_);
+      } else {
+        done_ = f_.GetCurrentEventNumber() + 1 >= unit_.end_ || !f_.Read();
+      }
+      return !done_;
+    }
+
+    /// Events after the current one left in both the block and the unit
+    uint64_t GetBlockEventsRemaining() const {
+      uint64_t remaining = f_.GetBlockEventsRemaining();
+      if (!unit_.IsWholeFile()) {
+        remaining = std::min(remaining,
+                             unit_.end_ - f_.GetCurrentEventNumber() - 1);
+      }
+      return remaining;
+    }
+
+    /// Skip the events given by GetBlockEventsRemaining()
+    void SkipBlock() {
+      if (!unit_.IsWholeFile() &&
+          GetBlockEventsRemaining() < f_.GetBlockEventsRemaining()) {
+        done_ = true;
+        return;
+      }
+      f_.SkipBlock();
+    }
+
+  private:
+
+    XCDFFile& f_;
+    WorkUnit unit_;
+    bool first_;
+    bool done_;
+};
+
+/*
+ *  Compute task(unit, result) for every unit on nThreads threads, and
+ *  merge each result into total with merge(total, result).  Each result
+ *  starts as a copy of prototype.  An idle thread takes the next unit not
+ *  yet started, and results are merged in unit order as soon as all
+ *  earlier units are merged, keeping only unmerged results in memory.
+ *  One thread at a time merges, without holding the lock, so the other
+ *  threads keep working while e.g. merged events are written out.  A
+ *  unit is not started until it is within 2 * nThreads units of the next
+ *  unit to merge, bounding the number of results held in memory.
+ *  If a task or merge throws, no further units are started and the
+ *  exception of the earliest failing unit is rethrown.
+ */
+template <typename Result, typename Task, typename Merge>
+void ParallelReduce(const std::vector<WorkUnit>& units,
+                    unsigned nThreads,
+                    const Result& prototype,
+                    Task task, Merge merge, Result& total) {
+
+  unsigned nUnits = units.size();
+  std::vector<Result*> results(nUnits, static_cast<Result*>(NULL));
+  std::vector<char> done(nUnits, 0);
+  std::vector<std::exception_ptr> errors(nUnits);
+  std::atomic<unsigned> nextUnit(0);
+  std::atomic<bool> failed(false);
+  unsigned nextMerge = 0;
+  bool merging = false;
+  std::mutex mergeMutex;
+  std::condition_variable merged;
+  unsigned window = 2 * std::max(1U, nThreads);
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < std::max(1U, std::min(nThreads, nUnits)); ++t) {
+    threads.push_back(std::thread([&]() {
+
+      for (unsigned u = nextUnit++; u < nUnits && !failed; u = nextUnit++) {
+
+        // Wait for earlier results to be merged before taking on more
+        {
+          std::unique_lock<std::mutex> lock(mergeMutex);
+          merged.wait(lock, [&]() {return u < nextMerge + window || failed;});
+          if (failed) {
+            break;
+          }
+        }
+
+        Result* result = new Result(prototype);
+        try {
+          task(units[u], *result);
+        } catch (...) {
+          errors[u] = std::current_exception();
+          failed = true;
+        }
+
+        std::unique_lock<std::mutex> lock(mergeMutex);
+        results[u] = result;
+        done[u] = 1;
+
+        // Another thread is merging and will pick up this result
+        if (merging) {
+          continue;
+        }
+        merging = true;
+        while (nextMerge < nUnits && done[nextMerge]) {
+          unsigned m = nextMerge;
+          bool ok = !errors[m] && !failed;
+          lock.unlock();
+          if (ok) {
+            try {
+              merge(total, *results[m]);
+            } catch (...) {
+              errors[m] = std::current_exception();
+              failed = true;
+            }
+          }
+          delete results[m];
+          lock.lock();
+          results[m] = NULL;
+          ++nextMerge;
+          merged.notify_all();
+        }
+        merging = false;
+        if (failed) {
+          merged.notify_all();
+        }
+      }
+    }));
+  }
+
+  for (unsigned t = 0; t < threads.size(); ++t) {
+    threads[t].join();
+  }
+
+  for (unsigned u = 0; u < nUnits; ++u) {
+    delete results[u];
+  }
+  for (unsigned u = 0; u < nUnits; ++u) {
+    if (errors[u]) {
+      std::rethrow_exception(errors[u]);
+    }
+  }
+}
+
+/// Number of threads for "-j n": all hardware threads if n is zero
+inline unsigned GetThreadCount(unsigned n) {
+  if (n == 0) {
+    n = std::thread::hardware_concurrency();
+  }
+  return n > 0 ? n : 1;
+}
+
+#endif // XCDF_UTILITY_PARALLEL_REDUCE_H_INCLUDED
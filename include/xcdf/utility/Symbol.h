@@ -63,6 +63,13 @@ enum SymbolType {
     ANY,
     ALL,
     SUM,
+    MIN,
+    MAX,
+    MEAN,
+    COUNT,
+    ARGMAX,
+    FIRST,
+    LAST,
     SIN,
     COS,
     TAN,
@@ -118,6 +125,13 @@ class Symbol {
               type_ == ANY      ||
               type_ == ALL      ||
               type_ == SUM      ||
+              type_ == MIN      ||
+              type_ == MAX      ||
+              type_ == MEAN     ||
+              type_ == COUNT    ||
+              type_ == ARGMAX   ||
+              type_ == FIRST    ||
+              type_ == LAST     ||
               type_ == SIN      ||
               type_ == COS      ||
               type_ == TAN      ||
@@ -235,6 +249,13 @@ inline std::ostream& operator<<(std::ostream& os, const Symbol& s) {
     case ANY:                 os << "any"; break;
     case ALL:                 os << "all"; break;
     case SUM:                 os << "sum"; break;
+    case MIN:                 os << "min"; break;
+    case MAX:                 os << "max"; break;
+    case MEAN:                os << "mean"; break;
+    case COUNT:               os << "count"; break;
+    case ARGMAX:              os << "argmax"; break;
+    case FIRST:               os << "first"; break;
+    case LAST:                os << "last"; break;
     case SIN:                 os << "sin"; break;
     case COS:                 os << "cos"; break;
     case TAN:                 os << "tan"; break;
@@ -0,0 +1,108 @@
+
+/*
+Copyright (c) 2016, James Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef XCDF_UTILITY_TEXT_BUFFER_H_INCLUDED
+#define XCDF_UTILITY_TEXT_BUFFER_H_INCLUDED
+
+#include <string>
+#include <ostream>
+#include <cstdio>
+#include <cmath>
+#include <stdint.h>
+
+/*
+ *  Accumulates formatted text in memory for fast text export.  Numbers
+ *  are printed exactly as std::ostream prints them with the given
+ *  precision: integers in decimal and floating point values as "%.*g".
+ *  Integers and integral floating point values are converted without
+ *  going through printf.  Write() hands the text to a stream in large
+ *  chunks instead of one value at a time.
+ */
+class TextBuffer {
+
+  public:
+
+    TextBuffer(int precision) : precision_(precision),
+                                maxIntegral_(std::pow(10., precision)) { }
+
+    void Append(char c) {buf_.push_back(c);}
+    void Append(const char* s) {buf_.append(s);}
+    void Append(const std::string& s) {buf_.append(s);}
+
+    void Append(uint64_t value) {
+      char digits[20];
+      char* end = digits + sizeof(digits);
+      char* p = end;
+      do {
+        *--p = '0' + value % 10;
+        value /= 10;
+      } while (value != 0);
+      buf_.append(p, end - p);
+    }
+
+    void Append(int64_t value) {
+      if (value < 0) {
+        buf_.push_back('-');
+        // Negate as unsigned to handle the most negative value
+        Append(static_cast<uint64_t>(0) - static_cast<uint64_t>(value));
+      } else {
+        Append(static_cast<uint64_t>(value));
+      }
+    }
+
+    void Append(double value) {
+
+      // "%g" prints integers below 10^precision without exponent
+      // or decimal point.  Keep "-0" for negative zero.
+      if (value == std::floor(value) && std::fabs(value) < maxIntegral_ &&
+          !(value == 0. && std::signbit(value))) {
+        Append(static_cast<int64_t>(value));
+        return;
+      }
+      char str[32];
+      int n = snprintf(str, sizeof(str), "%.*g", precision_, value);
+      buf_.append(str, n);
+    }
+
+    size_t Size() const {return buf_.size();}
+    const std::string& GetString() const {return buf_;}
+
+    /// Write the text to out if more than minSize is held, and clear it
+    void Write(std::ostream& out, size_t minSize = 0) {
+      if (buf_.size() > minSize) {
+        out.write(buf_.data(), buf_.size());
+        buf_.clear();
+      }
+    }
+
+  private:
+
+    std::string buf_;
+    int precision_;
+    double maxIntegral_;
+};
+
+#endif // XCDF_UTILITY_TEXT_BUFFER_H_INCLUDED
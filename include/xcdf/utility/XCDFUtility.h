@@ -29,6 +29,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define XCDF_UTILITY_UTILITY_INCLUDED_H
 
 #include <xcdf/XCDF.h>
+#include <xcdf/utility/TextBuffer.h>
 
 #include <string>
 #include <iostream>
@@ -37,6 +38,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <utility>
 #include <algorithm>
 #include <set>
+#include <deque>
+#include <future>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
 
 #include <unistd.h>
 
@@ -49,18 +56,26 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class DumpFieldVisitor {
   public:
 
+    DumpFieldVisitor(TextBuffer& buf) : buf_(buf) { }
+
     template <typename T>
     void operator()(ConstXCDFField<T> field) {
 
-      std::cout << field.GetName() << ": ";
+      buf_.Append(field.GetName());
+      buf_.Append(": ");
       for (typename ConstXCDFField<T>::ConstIterator
                                         it = field.Begin();
                                         it != field.End(); ++it) {
 
-        std::cout << std::setprecision(10) << *it << " ";
+        buf_.Append(*it);
+        buf_.Append(' ');
       }
-      std::cout << std::endl;
+      buf_.Append('\n');
     }
+
+  private:
+
+    TextBuffer& buf_;
 };
 
 class MatchFieldsVisitor {
@@ -168,13 +183,13 @@ class PrintFieldNameVisitor {
 class PrintFieldDataVisitor {
   public:
 
-    PrintFieldDataVisitor() : firstCall_(true) { }
+    PrintFieldDataVisitor(TextBuffer& buf) : buf_(buf), firstCall_(true) { }
 
     template <typename T>
     void operator()(ConstXCDFField<T> field) {
 
       if (!firstCall_) {
-        std::cout << ",";
+        buf_.Append(',');
       }
       firstCall_ = false;
 
@@ -183,10 +198,10 @@ class PrintFieldDataVisitor {
                                         it != field.End(); ++it) {
 
         if (it != field.Begin()) {
-          std::cout << ":";
+          buf_.Append(':');
         }
 
-        std::cout << std::setprecision(15) << *it;
+        buf_.Append(*it);
       }
     }
 
@@ -194,6 +209,7 @@ class PrintFieldDataVisitor {
 
   private:
 
+    TextBuffer& buf_;
     bool firstCall_;
 };
 
@@ -353,6 +369,22 @@ class FileCompare {
     }
 };
 
+/// Get the field of f named name, with the type of the last argument
+inline XCDFUnsignedIntegerField GetField(XCDFFile& f,
+                                         const std::string& name, uint64_t) {
+  return f.GetUnsignedIntegerField(name);
+}
+
+inline XCDFSignedIntegerField GetField(XCDFFile& f,
+                                       const std::string& name, int64_t) {
+  return f.GetSignedIntegerField(name);
+}
+
+inline XCDFFloatingPointField GetField(XCDFFile& f,
+                                       const std::string& name, double) {
+  return f.GetFloatingPointField(name);
+}
+
 class FieldCopyBuffer {
 
   public:
@@ -429,8 +461,11 @@ class FieldCopyBuffer {
                         std::pair<XCDFField<T>, XCDFField<T> > >::iterator
                                                           it = map.find(name);
       if (it == map.end()) {
-        XCDFField<T> newField =
-            AllocateField(name, field.GetResolution(), parentName);
+
+        // Fill a field already in the file, or allocate a new one
+        XCDFField<T> newField = file_.HasField(name) ?
+                  GetField(file_, name, T()) :
+                  AllocateField(name, field.GetResolution(), parentName);
         map.insert(std::make_pair(field.GetName(),
                                           std::make_pair(field, newField)));
       } else {
@@ -457,6 +492,219 @@ class FieldCopyBuffer {
     }
 };
 
+/*
+ *  Holds the values of selected events in memory so they can be written
+ *  to another file later, e.g. after events read by other threads or in
+ *  a different order.  Store() copies the current event of the source
+ *  file, and may only be called while that file is open.  Writing uses
+ *  only the stored values.
+ */
+class EventBuffer {
+
+  private:
+
+    // Values of one field.  Vector fields also keep the start of the
+    // values of each event.
+    template <typename T>
+    struct Column {
+
+      Column(XCDFField<T> field, bool isVector) : name_(field.GetName()),
+                                                  in_(field),
+                                                  isVector_(isVector) { }
+
+      uint64_t GetStart(uint64_t e) const {
+        return isVector_ ? starts_[e] : e;
+      }
+
+      uint64_t GetEnd(uint64_t e) const {
+        if (!isVector_) {
+          return e + 1;
+        }
+        return e + 1 < starts_.size() ? starts_[e + 1] : values_.size();
+      }
+
+      std::string name_;
+      XCDFField<T> in_;
+      bool isVector_;
+      std::vector<T> values_;
+      std::vector<uint64_t> starts_;
+    };
+
+  public:
+
+    EventBuffer(XCDFFile& f,
+                const std::set<std::string>& fields) : nEvents_(0) {
+      AddFieldVisitor visitor(*this, f, fields);
+      f.ApplyFieldVisitor(visitor);
+    }
+
+    uint64_t GetNEvents() const {return nEvents_;}
+
+    /// Approximate memory used by the stored events, in bytes
+    size_t GetMemorySize() const {
+      return GetMemorySize(uiColumns_) +
+             GetMemorySize(siColumns_) +
+             GetMemorySize(fpColumns_);
+    }
+
+    /// Store further events from f, which must have all buffered fields
+    void SetSource(XCDFFile& f) {
+      SetSource(f, uiColumns_);
+      SetSource(f, siColumns_);
+      SetSource(f, fpColumns_);
+    }
+
+    void Store() {
+      StoreImpl(uiColumns_);
+      StoreImpl(siColumns_);
+      StoreImpl(fpColumns_);
+      ++nEvents_;
+    }
+
+    /// Remove the stored events and free their memory
+    void Clear() {
+      ClearImpl(uiColumns_);
+      ClearImpl(siColumns_);
+      ClearImpl(fpColumns_);
+      nEvents_ = 0;
+    }
+
+    /// Write the stored events to fields of the same names in out
+    void Write(XCDFFile& out) const {
+
+      Writer writer(*this, out);
+      for (uint64_t e = 0; e < nEvents_; ++e) {
+        writer.Fill(e);
+        out.Write();
+      }
+    }
+
+    /*
+     *  Fills the fields of another file with stored events, in any order.
+     *  Fill(e) sets the values of event e, which the caller then writes.
+     */
+    class Writer {
+
+      public:
+
+        Writer(const EventBuffer& buf,
+               XCDFFile& out) : buf_(buf) {
+          GetFields(out, buf_.uiColumns_, uiFields_);
+          GetFields(out, buf_.siColumns_, siFields_);
+          GetFields(out, buf_.fpColumns_, fpFields_);
+        }
+
+        void Fill(uint64_t e) {
+          FillImpl(buf_.uiColumns_, uiFields_, e);
+          FillImpl(buf_.siColumns_, siFields_, e);
+          FillImpl(buf_.fpColumns_, fpFields_, e);
+        }
+
+      private:
+
+        const EventBuffer& buf_;
+        std::vector<XCDFUnsignedIntegerField> uiFields_;
+        std::vector<XCDFSignedIntegerField> siFields_;
+        std::vector<XCDFFloatingPointField> fpFields_;
+
+        template <typename T>
+        static void GetFields(XCDFFile& out,
+                              const std::vector<Column<T> >& columns,
+                              std::vector<XCDFField<T> >& fields) {
+          for (unsigned i = 0; i < columns.size(); ++i) {
+            fields.push_back(GetField(out, columns[i].name_, T()));
+          }
+        }
+
+        template <typename T>
+        static void FillImpl(const std::vector<Column<T> >& columns,
+                             std::vector<XCDFField<T> >& fields,
+                             uint64_t e) {
+          for (unsigned i = 0; i < columns.size(); ++i) {
+            uint64_t end = columns[i].GetEnd(e);
+            for (uint64_t j = columns[i].GetStart(e); j < end; ++j) {
+              fields[i] << columns[i].values_[j];
+            }
+          }
+        }
+    };
+
+  private:
+
+    class AddFieldVisitor {
+      public:
+        AddFieldVisitor(EventBuffer& buf,
+                        XCDFFile& f,
+                        const std::set<std::string>& fields) :
+                                 buf_(buf), f_(f), fields_(fields) { }
+
+        template <typename T>
+        void operator()(XCDFField<T> field) {
+          if (fields_.find(field.GetName()) != fields_.end()) {
+            buf_.GetColumns(T()).push_back(
+                      Column<T>(field, f_.IsVectorField(field.GetName())));
+          }
+        }
+
+      private:
+        EventBuffer& buf_;
+        XCDFFile& f_;
+        const std::set<std::string>& fields_;
+    };
+
+    std::vector<Column<uint64_t> > uiColumns_;
+    std::vector<Column<int64_t> > siColumns_;
+    std::vector<Column<double> > fpColumns_;
+    uint64_t nEvents_;
+
+    std::vector<Column<uint64_t> >& GetColumns(uint64_t) {return uiColumns_;}
+    std::vector<Column<int64_t> >& GetColumns(int64_t) {return siColumns_;}
+    std::vector<Column<double> >& GetColumns(double) {return fpColumns_;}
+
+    template <typename T>
+    static size_t GetMemorySize(const std::vector<Column<T> >& columns) {
+      size_t size = 0;
+      for (unsigned i = 0; i < columns.size(); ++i) {
+        size += columns[i].values_.capacity() * sizeof(T) +
+                columns[i].starts_.capacity() * sizeof(uint64_t);
+      }
+      return size;
+    }
+
+    template <typename T>
+    static void SetSource(XCDFFile& f, std::vector<Column<T> >& columns) {
+      for (typename std::vector<Column<T> >::iterator it = columns.begin();
+                                                  it != columns.end(); ++it) {
+        if (!f.HasField(it->name_)) {
+          XCDFFatal("Unable to read field \"" <<
+                                 it->name_ << "\": Field not present");
+        }
+        it->in_ = GetField(f, it->name_, T());
+      }
+    }
+
+    template <typename T>
+    static void StoreImpl(std::vector<Column<T> >& columns) {
+      for (typename std::vector<Column<T> >::iterator it = columns.begin();
+                                                  it != columns.end(); ++it) {
+        if (it->isVector_) {
+          it->starts_.push_back(it->values_.size());
+        }
+        it->values_.insert(it->values_.end(), it->in_.Begin(), it->in_.End());
+      }
+    }
+
+    template <typename T>
+    static void ClearImpl(std::vector<Column<T> >& columns) {
+      // Release the memory as well: GetMemorySize() counts capacity
+      for (typename std::vector<Column<T> >::iterator it = columns.begin();
+                                                  it != columns.end(); ++it) {
+        std::vector<T>().swap(it->values_);
+        std::vector<uint64_t>().swap(it->starts_);
+      }
+    }
+};
+
 class SelectFieldVisitor {
   public:
 
@@ -500,146 +748,378 @@ class SelectFieldVisitor {
     FieldCopyBuffer& buf_;
 };
 
+/*
+ *  Reads events from comma-separated text.  The first line gives the
+ *  fields as name{[parent]}/type/resolution, and each following line one
+ *  event, with vector entries separated by ':'.  Text is read in large
+ *  chunks of whole lines, which are parsed into memory and then copied
+ *  event by event into the fields with CopyLine().  With nThreads > 1,
+ *  up to nThreads chunks are parsed on separate threads while earlier
+ *  chunks are copied, keeping the order of the lines.
+ */
 class CSVInputHandler {
 
   public:
 
     CSVInputHandler(XCDFFile& f,
-                    std::istream& in) : f_(f),
-                                        in_(in),
-                                        delim_(',') {
+                    std::istream& in,
+                    unsigned nThreads = 1) : f_(f),
+                                             in_(in),
+                                             delim_(','),
+                                             nThreads_(nThreads),
+                                             eof_(false) {
       ProcessFieldDefs();
     }
 
     CSVInputHandler(XCDFFile& f,
                     std::istream& in,
-                    char& delim) : f_(f),
-                                in_(in),
-                                delim_(delim) {
+                    char& delim,
+                    unsigned nThreads = 1) : f_(f),
+                                             in_(in),
+                                             delim_(delim),
+                                             nThreads_(nThreads),
+                                             eof_(false) {
       ProcessFieldDefs();
     }
 
     bool CopyLine() {
 
-      ParseLine();
-      if (!in_.good()) {
-        return false;
+      while (chunk_.event_ == chunk_.nEvents_) {
+        if (!chunk_.error_.empty()) {
+          std::string error = chunk_.error_;
+          chunk_.error_.clear();
+          XCDFFatal(error);
+        }
+        if (!NextChunk()) {
+          return false;
+        }
       }
 
-      if (currentParsedLine_.size() != fieldTypeList_.size()) {
-        XCDFFatal("Expected " << fieldTypeList_.size() <<
-                             " entries in line " << currentLine_);
-      }
+      for (unsigned i = 0; i < fieldTypeList_.size(); ++i) {
 
-      std::vector<XCDFUnsignedIntegerField>::iterator
-                   currentUnsignedField = unsignedFields_.begin();
-      std::vector<XCDFSignedIntegerField>::iterator
-                   currentSignedField = signedFields_.begin();
-      std::vector<XCDFFloatingPointField>::iterator
-                   currentFloatingPointField = floatingPointFields_.begin();
+        uint32_t size = chunk_.sizes_[chunk_.sizePos_++];
+        switch(fieldTypeList_[i]) {
 
-      unsigned long long uval;
-      long long ival;
-      double fval;
+          case XCDF_UNSIGNED_INTEGER:
+            CopyValues(unsignedFields_[fieldIndexList_[i]],
+                       chunk_.unsignedValues_, chunk_.unsignedPos_, size);
+            break;
 
-      unsigned count;
-      std::vector<std::string> entries;
+          case XCDF_SIGNED_INTEGER:
+            CopyValues(signedFields_[fieldIndexList_[i]],
+                       chunk_.signedValues_, chunk_.signedPos_, size);
+            break;
 
-      for (unsigned i = 0; i < fieldTypeList_.size(); ++i) {
+          case XCDF_FLOATING_POINT:
+            CopyValues(floatingPointFields_[fieldIndexList_[i]],
+                       chunk_.floatingPointValues_,
+                       chunk_.floatingPointPos_, size);
+            break;
+        }
+      }
 
-        count = 0;
-        ParseString(currentParsedLine_[i], entries);
+      ++chunk_.event_;
+      return true;
+    }
 
-        switch(fieldTypeList_[i]) {
+  private:
 
-          case XCDF_UNSIGNED_INTEGER:
+    // Parsed events of a chunk of text
+    struct ParsedChunk {
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
+      ParsedChunk() : nEvents_(0), event_(0), sizePos_(0),
+                      unsignedPos_(0), signedPos_(0), floatingPointPos_(0) { }
 
-              count += sscanf(it->c_str(), "%llu", &uval);
-              *currentUnsignedField << uval;
-            }
-            currentUnsignedField++;
-            break;
+      uint64_t nEvents_;
 
-          case XCDF_SIGNED_INTEGER:
+      // Number of entries of each field of each event, and the values
+      std::vector<uint32_t> sizes_;
+      std::vector<uint64_t> unsignedValues_;
+      std::vector<int64_t> signedValues_;
+      std::vector<double> floatingPointValues_;
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
+      // Error in the line after the last parsed event
+      std::string error_;
 
-              count += sscanf(it->c_str(), "%lld", &ival);
-              *currentSignedField << ival;
-            }
-            currentSignedField++;
-            break;
+      // Position of the next event to copy
+      uint64_t event_;
+      size_t sizePos_;
+      size_t unsignedPos_;
+      size_t signedPos_;
+      size_t floatingPointPos_;
+    };
 
-          case XCDF_FLOATING_POINT:
+    static const size_t CHUNK_SIZE = 1 << 22;
+
+    XCDFFile& f_;
+    std::istream& in_;
+    char delim_;
+    unsigned nThreads_;
+    bool eof_;
 
-            for (std::vector<std::string>::iterator it = entries.begin();
-                                                 it != entries.end(); ++it) {
+    // Start of an unfinished line after the last chunk
+    std::string carry_;
 
-              count += sscanf(it->c_str(), "%lg", &fval);
-              *currentFloatingPointField << fval;
-            }
-            currentFloatingPointField++;
-            break;
+    ParsedChunk chunk_;
+    std::deque<std::future<ParsedChunk> > pending_;
 
-        }
+    template <typename T>
+    static void CopyValues(XCDFField<T>& field,
+                           const std::vector<T>& values,
+                           size_t& pos, uint32_t size) {
+      for (uint32_t j = 0; j < size; ++j) {
+        field << values[pos++];
+      }
+    }
+
+    bool NextChunk() {
 
-        if (count != entries.size()) {
-          XCDFFatal("Bad input string: " << currentParsedLine_[i]);
+      if (nThreads_ < 2) {
+        std::string text;
+        if (!ReadText(text)) {
+          return false;
         }
+        chunk_ = Parse(text);
+        return true;
       }
 
+      // Keep nThreads_ chunks parsing ahead of the one being copied
+      while (pending_.size() < nThreads_) {
+        std::string text;
+        if (!ReadText(text)) {
+          break;
+        }
+        pending_.push_back(std::async(std::launch::async,
+                                      &CSVInputHandler::Parse,
+                                      this, std::move(text)));
+      }
+      if (pending_.empty()) {
+        return false;
+      }
+      chunk_ = pending_.front().get();
+      pending_.pop_front();
       return true;
     }
 
-  private:
+    /*
+     *  Read about CHUNK_SIZE bytes of whole lines into text.  As with
+     *  std::getline, a last line without a newline is not an event.
+     */
+    bool ReadText(std::string& text) {
+
+      text.swap(carry_);
+      carry_.clear();
+      while (!eof_) {
+
+        size_t pos = text.size();
+        text.resize(pos + CHUNK_SIZE);
+        in_.read(&text[pos], CHUNK_SIZE);
+        text.resize(pos + in_.gcount());
+        if (!in_.good()) {
+          eof_ = true;
+        }
 
-    XCDFFile& f_;
-    std::istream& in_;
-    char delim_;
+        size_t last = text.rfind('\n');
+        if (last != std::string::npos && last >= pos) {
+          carry_.assign(text, last + 1, std::string::npos);
+          text.resize(last + 1);
+          return true;
+        }
+      }
+      text.clear();
+      return false;
+    }
 
-    void ProcessFieldDefs() {
+    /// Parse the whole lines in text.  Only reads the field definitions.
+    ParsedChunk Parse(const std::string& text) const {
 
-      ParseLine();
-      for (std::vector<std::string>::iterator
-                          it = currentParsedLine_.begin();
-                          it != currentParsedLine_.end(); ++it) {
-        AddField(*it);
+      ParsedChunk chunk;
+      const char* pos = text.c_str();
+      const char* end = pos + text.size();
+      while (pos < end) {
+        const char* eol = static_cast<const char*>(
+                                   memchr(pos, '\n', end - pos));
+        if (!ParseLine(pos, eol, chunk)) {
+          break;
+        }
+        ++chunk.nEvents_;
+        pos = eol + 1;
       }
+      return chunk;
     }
 
-    void ParseLine() {
+    bool ParseLine(const char* begin,
+                   const char* end,
+                   ParsedChunk& chunk) const {
 
-      currentParsedLine_.clear();
-      std::getline(in_, currentLine_);
-      std::stringstream sstream(currentLine_);
-      std::string currentString;
+      // An empty line has no entries, otherwise count the delimiters
+      size_t nEntries = 0;
+      if (begin != end) {
+        nEntries = 1 + std::count(begin, end, delim_);
+      }
+      if (nEntries != fieldTypeList_.size()) {
+        std::stringstream error;
+        error << "Expected " << fieldTypeList_.size() <<
+                 " entries in line " << std::string(begin, end);
+        chunk.error_ = error.str();
+        return false;
+      }
 
-      while (std::getline(sstream, currentString, delim_)) {
+      const char* entry = begin;
+      for (unsigned i = 0; i < fieldTypeList_.size(); ++i) {
+
+        const char* entryEnd = std::find(entry, end, delim_);
+        bool ok = true;
+        switch(fieldTypeList_[i]) {
+
+          case XCDF_UNSIGNED_INTEGER:
+            ok = ParseEntry(entry, entryEnd,
+                            chunk.unsignedValues_, chunk.sizes_);
+            break;
 
-        currentParsedLine_.push_back(currentString);
+          case XCDF_SIGNED_INTEGER:
+            ok = ParseEntry(entry, entryEnd,
+                            chunk.signedValues_, chunk.sizes_);
+            break;
+
+          case XCDF_FLOATING_POINT:
+            ok = ParseEntry(entry, entryEnd,
+                            chunk.floatingPointValues_, chunk.sizes_);
+            break;
+        }
+
+        if (!ok) {
+          chunk.error_ = "Bad input string: " +
+                                        std::string(entry, entryEnd);
+          return false;
+        }
+        entry = entryEnd + 1;
       }
+      return true;
+    }
 
-      // Check for an empty delimiter
-      if (currentLine_.size() > 0) {
-        if (currentLine_[currentLine_.size() - 1] == delim_) {
-          currentParsedLine_.push_back("");
+    /*
+     *  Parse the ':' separated values of one entry.  An empty entry has
+     *  no values, and a trailing ':' is ignored.
+     */
+    template <typename T>
+    static bool ParseEntry(const char* begin,
+                           const char* end,
+                           std::vector<T>& values,
+                           std::vector<uint32_t>& sizes) {
+
+      uint32_t size = 0;
+      const char* value = begin;
+      while (value != end) {
+        const char* valueEnd = std::find(value, end, ':');
+        T v;
+        if (!ParseValue(value, valueEnd, v)) {
+          return false;
         }
+        values.push_back(v);
+        ++size;
+        if (valueEnd == end) {
+          break;
+        }
+        value = valueEnd + 1;
       }
+      sizes.push_back(size);
+      return true;
     }
 
-    void ParseString(const std::string& input,
-                     std::vector<std::string>& vec) {
+    /*
+     *  Number parsers.  Plain decimal integers of up to 18 digits (which
+     *  cannot overflow) and numbers that strtod reads up to trailing
+     *  whitespace are converted directly.  Anything else goes through
+     *  sscanf, so the accepted input and values match sscanf.
+     */
+    static bool IsDigit(char c) {return c >= '0' && c <= '9';}
+
+    static bool ParseDigits(const char* begin,
+                            const char* end, uint64_t& value) {
+      const char* pos = begin;
+      uint64_t v = 0;
+      while (pos != end && pos - begin < 18 && IsDigit(*pos)) {
+        v = 10 * v + (*pos - '0');
+        ++pos;
+      }
+      if (pos == begin || (pos != end && IsDigit(*pos))) {
+        return false;
+      }
+      value = v;
+      return true;
+    }
 
-      vec.clear();
-      std::stringstream sstream(input);
-      std::string currentString;
-      while (std::getline(sstream, currentString, ':')) {
+    static bool ParseValue(const char* begin,
+                           const char* end, uint64_t& value) {
+      if (ParseDigits(begin, end, value)) {
+        return true;
+      }
+      unsigned long long v;
+      if (sscanf(std::string(begin, end).c_str(), "%llu", &v) != 1) {
+        return false;
+      }
+      value = v;
+      return true;
+    }
 
-        vec.push_back(currentString);
+    static bool ParseValue(const char* begin,
+                           const char* end, int64_t& value) {
+      bool negative = begin != end && *begin == '-';
+      uint64_t v;
+      if (ParseDigits(begin + negative, end, v)) {
+        value = negative ? -static_cast<int64_t>(v) : v;
+        return true;
+      }
+      long long sv;
+      if (sscanf(std::string(begin, end).c_str(), "%lld", &sv) != 1) {
+        return false;
+      }
+      value = sv;
+      return true;
+    }
+
+    static bool ParseValue(const char* begin,
+                           const char* end, double& value) {
+
+      // The text is null-terminated and strtod stops at any delimiter
+      char* stop;
+      double v = strtod(begin, &stop);
+      const char* pos = stop;
+      if (pos > begin && pos <= end) {
+        while (pos != end && isspace(*pos)) {
+          ++pos;
+        }
+        if (pos == end) {
+          value = v;
+          return true;
+        }
+      }
+      if (sscanf(std::string(begin, end).c_str(), "%lg", &v) != 1) {
+        return false;
+      }
+      value = v;
+      return true;
+    }
+
+    void ProcessFieldDefs() {
+
+      std::string line;
+      std::getline(in_, line);
+      const char* begin = line.c_str();
+      const char* end = begin + line.size();
+      if (begin == end) {
+        return;
+      }
+      const char* entry = begin;
+      while (true) {
+        const char* entryEnd = std::find(entry, end, delim_);
+        std::string str(entry, entryEnd);
+        AddField(str);
+        if (entryEnd == end) {
+          break;
+        }
+        entry = entryEnd + 1;
       }
     }
 
@@ -692,6 +1172,7 @@ class CSVInputHandler {
      switch (fieldType) {
        case 'U': {
          fieldTypeList_.push_back(XCDF_UNSIGNED_INTEGER);
+         fieldIndexList_.push_back(unsignedFields_.size());
          uint64_t resolution;
          strStream >> resolution;
          unsignedFields_.push_back(f_.AllocateUnsignedIntegerField(
@@ -701,6 +1182,7 @@ class CSVInputHandler {
 
        case 'I': {
          fieldTypeList_.push_back(XCDF_SIGNED_INTEGER);
+         fieldIndexList_.push_back(signedFields_.size());
          int64_t resolution;
          strStream >> resolution;
          signedFields_.push_back(f_.AllocateSignedIntegerField(
@@ -710,6 +1192,7 @@ class CSVInputHandler {
 
        case 'F': {
          fieldTypeList_.push_back(XCDF_FLOATING_POINT);
+         fieldIndexList_.push_back(floatingPointFields_.size());
          double resolution;
          strStream >> resolution;
          floatingPointFields_.push_back(f_.AllocateFloatingPointField(
@@ -730,8 +1213,9 @@ class CSVInputHandler {
    std::vector<XCDFFloatingPointField> floatingPointFields_;
 
    std::vector<XCDFFieldType> fieldTypeList_;
-   std::vector<std::string> currentParsedLine_;
-   std::string currentLine_;
+
+   // Index of each field in the list of fields of its type
+   std::vector<unsigned> fieldIndexList_;
 };
 
 class AliasAdder {
@@ -26,7 +26,9 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <xcdf/utility/Expression.h>
 #include <xcdf/utility/NodeDefs.h>
 #include <xcdf/utility/FieldNodeDefs.h>
+#include <xcdf/utility/ExpressionProgram.h>
 #include <sstream>
+#include <fstream>
 #include <cctype>
 
 void
@@ -64,6 +66,7 @@ Expression::operator=(Expression e) {
   std::swap(expString_, e.expString_);
   std::swap(allocatedSymbols_, e.allocatedSymbols_);
   std::swap(parsedSymbols_, e.parsedSymbols_);
+  std::swap(nodeRecords_, e.nodeRecords_);
   return *this;
 }
 
@@ -90,6 +93,11 @@ Expression::GetNextSymbol(const std::string& exp, size_t& pos) {
     return NULL;
   }
 
+  // "@path" is a list of constants read from a file, e.g. in(run, @runs.txt)
+  if (exp[pos] == '@') {
+    return ParseFileList(exp, pos);
+  }
+
   // Get the position of next operator character
   size_t operpos = exp.find_first_of(",/*%^)(=><&|!~", pos);
 
@@ -201,6 +209,46 @@ Expression::ParseOperator(const std::string& exp,
   return op;
 }
 
+/*
+ *  Read a list of numerical constants from the file named after "@".
+ *  Values are separated by whitespace or commas; "#" starts a comment
+ *  running to the end of the line.
+ */
+Symbol*
+Expression::ParseFileList(const std::string& exp, size_t& pos) {
+
+  size_t endpos = exp.find_first_of(",) \n\r\t", pos);
+  std::string fileName = endpos == std::string::npos ?
+                             exp.substr(pos + 1) :
+                             exp.substr(pos + 1, endpos - pos - 1);
+  pos = endpos;
+
+  std::ifstream in(fileName.c_str());
+  if (!in) {
+    XCDFFatal("Unable to open list file \"" << fileName << "\"");
+  }
+
+  ListSymbol* list = new ListSymbol();
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::stringstream ss(line);
+    std::string token;
+    while (ss >> token) {
+      Symbol* value = ParseNumerical(token);
+      if (!value) {
+        delete list;
+        XCDFFatal("Cannot parse \"" << token <<
+                  "\" in list file \"" << fileName << "\"");
+      }
+      allocatedSymbols_.push_back(value);
+      list->PushBack(value);
+    }
+  }
+  return list;
+}
+
 template <typename T, typename M>
 Symbol* DoConstNode(const std::string& numerical, M manip) {
   std::stringstream ss(numerical);
@@ -310,6 +358,39 @@ Expression::ParseValueImpl(std::string exp) const {
     return new Symbol(SUM);
   }
 
+  // Return the smallest/largest element
+  if (!exp.compare("min")) {
+    return new Symbol(MIN);
+  }
+
+  if (!exp.compare("max")) {
+    return new Symbol(MAX);
+  }
+
+  // Return the average of the elements
+  if (!exp.compare("mean")) {
+    return new Symbol(MEAN);
+  }
+
+  // Return the number of true elements
+  if (!exp.compare("count")) {
+    return new Symbol(COUNT);
+  }
+
+  // Return the index of the largest element
+  if (!exp.compare("argmax")) {
+    return new Symbol(ARGMAX);
+  }
+
+  // Return the first/last element
+  if (!exp.compare("first")) {
+    return new Symbol(FIRST);
+  }
+
+  if (!exp.compare("last")) {
+    return new Symbol(LAST);
+  }
+
   if (!exp.compare("sin")) {
     return new Symbol(SIN);
   }
@@ -811,6 +892,20 @@ Symbol* GetNodeImpl(Node<T>* n1, SymbolType type) {
       return new AllNode<T>(*n1);
     case SUM:
       return new SumNode<T>(*n1);
+    case MIN:
+      return new MinNode<T>(*n1);
+    case MAX:
+      return new MaxNode<T>(*n1);
+    case MEAN:
+      return new MeanNode<T>(*n1);
+    case COUNT:
+      return new CountNode<T>(*n1);
+    case ARGMAX:
+      return new ArgMaxNode<T>(*n1);
+    case FIRST:
+      return new FirstNode<T>(*n1);
+    case LAST:
+      return new LastNode<T>(*n1);
     case SIN:
       return new SinNode<T>(*n1);
     case COS:
@@ -1010,6 +1105,164 @@ DoGetNode(Symbol* n1, Symbol* n2, SymbolType type) {
   }
 }
 
+bool IsConstNode(Symbol* s) {
+  switch (s->GetType()) {
+    case FLOATING_POINT_NODE:
+      return dynamic_cast<ConstNode<double>* >(s) != NULL;
+    case SIGNED_NODE:
+      return dynamic_cast<ConstNode<int64_t>* >(s) != NULL;
+    case UNSIGNED_NODE:
+      return dynamic_cast<ConstNode<uint64_t>* >(s) != NULL;
+    default:
+      return false;
+  }
+}
+
+template <typename T>
+bool IsConstValue(Symbol* s, double value) {
+  ConstNode<T>* cn = dynamic_cast<ConstNode<T>* >(s);
+  return cn && static_cast<double>((*cn)[0]) == value;
+}
+
+bool IsConstNode(Symbol* s, double value) {
+  switch (s->GetType()) {
+    case FLOATING_POINT_NODE: return IsConstValue<double>(s, value);
+    case SIGNED_NODE: return IsConstValue<int64_t>(s, value);
+    case UNSIGNED_NODE: return IsConstValue<uint64_t>(s, value);
+    default: return false;
+  }
+}
+
+template <typename T>
+Symbol* FoldConstant(Symbol* s) {
+  return new ConstNode<T>((*static_cast<Node<T>* >(s))[0]);
+}
+
+Symbol* DoFoldConstant(Symbol* s) {
+  switch (s->GetType()) {
+    default:
+    case FLOATING_POINT_NODE: return FoldConstant<double>(s);
+    case SIGNED_NODE: return FoldConstant<int64_t>(s);
+    case UNSIGNED_NODE: return FoldConstant<uint64_t>(s);
+  }
+}
+
+template <typename T>
+Symbol* GetSquareNode(Node<T>* n) {
+  // Same double-precision result as pow(x, 2)
+  return new MultiplicationNode<T, T, double>(*n, *n);
+}
+
+Symbol* DoGetSquareNode(Symbol* n) {
+  switch (n->GetType()) {
+    default:
+    case FLOATING_POINT_NODE:
+      return GetSquareNode(static_cast<Node<double>* >(n));
+    case SIGNED_NODE:
+      return GetSquareNode(static_cast<Node<int64_t>* >(n));
+    case UNSIGNED_NODE:
+      return GetSquareNode(static_cast<Node<uint64_t>* >(n));
+  }
+}
+
+/*
+ * Rewrite a newly-built node into a cheaper equivalent where possible.
+ * Operations on constants are folded into a single constant, operations
+ * that cannot change their operand (x*1, x/1, x-0, integer x+0, double(x)
+ * on a double) are replaced by the operand itself, and pow(x, 2) is
+ * replaced by x*x when x has no side effects.  Identities are only
+ * applied when the operand already has the result type, so evaluation
+ * results are unchanged.
+ */
+Symbol*
+Expression::Optimize(Symbol* symbol,
+                     Symbol* n1,
+                     Symbol* n2,
+                     SymbolType type) {
+
+  if (!symbol->IsNode()) {
+    return symbol;
+  }
+
+  // Bitwise operations on floating point data are rejected at evaluation
+  // time.  Leave them in place rather than failing while parsing.
+  bool bitwise = type == BITWISE_AND ||
+                 type == BITWISE_OR  ||
+                 type == BITWISE_NOT;
+  bool floatBitwise = bitwise && (n1->GetType() == FLOATING_POINT_NODE ||
+                                  (n2 && n2->GetType() == FLOATING_POINT_NODE));
+
+  if (IsConstNode(n1) && !floatBitwise &&
+      (!n2 || type == IN || IsConstNode(n2))) {
+    Symbol* folded = DoFoldConstant(symbol);
+    allocatedSymbols_.push_back(folded);
+    return folded;
+  }
+
+  SymbolType resultType = symbol->GetType();
+  switch (type) {
+
+    case MULTIPLICATION:
+      if (IsConstNode(n2, 1.) && n1->GetType() == resultType) {
+        return n1;
+      }
+      if (IsConstNode(n1, 1.) && n2->GetType() == resultType) {
+        return n2;
+      }
+      break;
+
+    case DIVISION:
+      if (IsConstNode(n2, 1.) && n1->GetType() == resultType) {
+        return n1;
+      }
+      break;
+
+    case SUBTRACTION:
+      if (IsConstNode(n2, 0.) && n1->GetType() == resultType) {
+        return n1;
+      }
+      break;
+
+    case ADDITION:
+      // -0. + 0. is 0., so only drop integer additions
+      if (resultType == FLOATING_POINT_NODE) {
+        break;
+      }
+      if (IsConstNode(n2, 0.) && n1->GetType() == resultType) {
+        return n1;
+      }
+      if (IsConstNode(n1, 0.) && n2->GetType() == resultType) {
+        return n2;
+      }
+      break;
+
+    case POWER:
+    case POW:
+      // x*x evaluates x twice, so x must be free of side effects
+      if (IsConstNode(n2, 2.) && IsTotal(n1)) {
+        Symbol* square = DoGetSquareNode(n1);
+        allocatedSymbols_.push_back(square);
+        RecordNode(square, MULTIPLICATION, n1, n1);
+        return square;
+      }
+      if (IsConstNode(n2, 1.) && n1->GetType() == resultType) {
+        return n1;
+      }
+      break;
+
+    case DOUBLE:
+      if (n1->GetType() == resultType) {
+        return n1;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  return symbol;
+}
+
 Symbol*
 Expression::GetUnarySymbol(std::list<Symbol*>::iterator start,
                            std::list<Symbol*>::iterator end,
@@ -1040,7 +1293,11 @@ Expression::GetUnarySymbol(std::list<Symbol*>::iterator start,
 
   Symbol* symbol = DoGetNode(n1, type);
   allocatedSymbols_.push_back(symbol);
-  return symbol;
+  Symbol* optimized = Optimize(symbol, n1, NULL, type);
+  if (optimized == symbol) {
+    RecordNode(symbol, type, n1, NULL);
+  }
+  return optimized;
 }
 
 Symbol*
@@ -1103,7 +1360,12 @@ Expression::GetBinarySymbol(std::list<Symbol*>::iterator start,
 
   Symbol* symbol = DoGetNode(n1, n2, type);
   allocatedSymbols_.push_back(symbol);
-  return symbol;
+  Symbol* optimized = Optimize(symbol, n1, n2, type);
+  if (optimized == symbol) {
+    // The list of an "in" operation is not a node
+    RecordNode(symbol, type, n1, type == IN ? NULL : n2);
+  }
+  return optimized;
 }
 
 Symbol* GetNodeImpl(SymbolType type) {
@@ -1134,5 +1396,436 @@ Expression::GetVoidSymbol(std::list<Symbol*>::iterator start,
 
   Symbol* symbol = GetNodeImpl(type);
   allocatedSymbols_.push_back(symbol);
+  RecordNode(symbol, type, NULL, NULL);
   return symbol;
 }
+
+void
+Expression::RecordNode(Symbol* node,
+                       SymbolType type,
+                       Symbol* n1,
+                       Symbol* n2) {
+
+  NodeRecord& record = nodeRecords_[node];
+  record.operation_ = type;
+  record.operands_[0] = n1;
+  record.operands_[1] = n2;
+}
+
+SymbolType
+Expression::GetOperation(const Symbol* node) const {
+
+  std::map<const Symbol*, NodeRecord>::const_iterator it =
+                                                nodeRecords_.find(node);
+  return it == nodeRecords_.end() ? VOID : it->second.operation_;
+}
+
+Symbol*
+Expression::GetOperand(const Symbol* node, unsigned i) const {
+
+  std::map<const Symbol*, NodeRecord>::const_iterator it =
+                                                nodeRecords_.find(node);
+  if (it == nodeRecords_.end() || i > 1) {
+    return NULL;
+  }
+  return it->second.operands_[i];
+}
+
+template <typename T>
+bool IsTotalLeaf(const Symbol* s) {
+  return dynamic_cast<const FieldNode<T>* >(s) != NULL ||
+         dynamic_cast<const ConstNode<T>* >(s) != NULL;
+}
+
+bool
+Expression::IsTotal(const Symbol* node) const {
+
+  std::map<const Symbol*, NodeRecord>::const_iterator it =
+                                                nodeRecords_.find(node);
+
+  // Leaves: fields, constants and the event counter.  Aliases are
+  // evaluated through their own expression and are not inspected.
+  if (it == nodeRecords_.end()) {
+    return IsTotalLeaf<double>(node)  ||
+           IsTotalLeaf<int64_t>(node) ||
+           IsTotalLeaf<uint64_t>(node) ||
+           dynamic_cast<const CounterNode*>(node) != NULL;
+  }
+
+  const NodeRecord& record = it->second;
+  bool floatOperand = false;
+  for (unsigned i = 0; i < 2; ++i) {
+    if (record.operands_[i]) {
+      if (!IsTotal(record.operands_[i])) {
+        return false;
+      }
+      floatOperand |= record.operands_[i]->GetType() == FLOATING_POINT_NODE;
+    }
+  }
+
+  switch (record.operation_) {
+
+    // Integer division by zero traps; floating point division does not
+    case DIVISION:
+      return node->GetType() == FLOATING_POINT_NODE;
+
+    case MODULUS:
+      return false;
+
+    // Out-of-range floating point conversions are undefined
+    case INT:
+    case UNSIGNED:
+      return !floatOperand;
+
+    // Bitwise operations on floating point data are fatal
+    case BITWISE_AND:
+    case BITWISE_OR:
+    case BITWISE_NOT:
+      return !floatOperand;
+
+    // Advances the random number generator
+    case RAND:
+      return false;
+
+    default:
+      return true;
+  }
+}
+
+namespace {
+
+// The U, I and D variants of a program operation are consecutive
+ProgramOp GetTypedOp(ProgramOp op, SymbolType type) {
+  switch (type) {
+    case UNSIGNED_NODE: return op;
+    case SIGNED_NODE: return static_cast<ProgramOp>(op + 1);
+    default: return static_cast<ProgramOp>(op + 2);
+  }
+}
+
+// Type to which a comparison or logical node casts its operands,
+// as chosen in DoGetNode
+SymbolType GetDominantType(SymbolType t1, SymbolType t2) {
+  if (t1 == FLOATING_POINT_NODE || t2 == FLOATING_POINT_NODE) {
+    return FLOATING_POINT_NODE;
+  }
+  if (t1 == SIGNED_NODE || t2 == SIGNED_NODE) {
+    return SIGNED_NODE;
+  }
+  return UNSIGNED_NODE;
+}
+
+typedef double (*MathFunction1)(double);
+typedef double (*MathFunction2)(double, double);
+
+MathFunction1 GetMathFunction1(SymbolType type) {
+  switch (type) {
+    case SIN: return static_cast<MathFunction1>(sin);
+    case COS: return static_cast<MathFunction1>(cos);
+    case TAN: return static_cast<MathFunction1>(tan);
+    case ASIN: return static_cast<MathFunction1>(asin);
+    case ACOS: return static_cast<MathFunction1>(acos);
+    case ATAN: return static_cast<MathFunction1>(atan);
+    case LOG: return static_cast<MathFunction1>(log);
+    case LOG10: return static_cast<MathFunction1>(log10);
+    case EXP: return static_cast<MathFunction1>(exp);
+    case ABS: return static_cast<MathFunction1>(fabs);
+    case SQRT: return static_cast<MathFunction1>(sqrt);
+    case CEIL: return static_cast<MathFunction1>(ceil);
+    case FLOOR: return static_cast<MathFunction1>(floor);
+    case SINH: return static_cast<MathFunction1>(sinh);
+    case COSH: return static_cast<MathFunction1>(cosh);
+    case TANH: return static_cast<MathFunction1>(tanh);
+    default: return NULL;
+  }
+}
+
+MathFunction2 GetMathFunction2(SymbolType type) {
+  switch (type) {
+    case POWER:
+    case POW: return static_cast<MathFunction2>(pow);
+    case FMOD: return static_cast<MathFunction2>(fmod);
+    case ATAN2: return static_cast<MathFunction2>(atan2);
+    default: return NULL;
+  }
+}
+
+/*
+ * Lowers a scalar expression tree into an ExpressionProgram.  Each
+ * operation is replaced by the program operations giving the same result
+ * as the node, including the casts to the dominant type of binary nodes.
+ * Nodes that are not lowered (reductions, "in", aliases, rand(), etc.)
+ * are evaluated as trees from within the program.
+ */
+class ProgramCompiler {
+
+  public:
+
+    ProgramCompiler(const Expression& e,
+                    ExpressionProgram& program) : e_(e), program_(program) { }
+
+    bool IsLowered(const Symbol* node) const {
+
+      Symbol* n1 = e_.GetOperand(node, 0);
+      switch (e_.GetOperation(node)) {
+
+        case ADDITION:
+        case SUBTRACTION:
+        case MULTIPLICATION:
+        case DIVISION:
+        case MODULUS:
+        case POWER:
+        case POW:
+        case FMOD:
+        case ATAN2:
+        case EQUALITY:
+        case INEQUALITY:
+        case GREATER_THAN:
+        case LESS_THAN:
+        case GREATER_THAN_EQUAL:
+        case LESS_THAN_EQUAL:
+        case LOGICAL_AND:
+        case LOGICAL_OR:
+        case LOGICAL_NOT:
+        case SIN:
+        case COS:
+        case TAN:
+        case ASIN:
+        case ACOS:
+        case ATAN:
+        case LOG:
+        case LOG10:
+        case EXP:
+        case ABS:
+        case SQRT:
+        case CEIL:
+        case FLOOR:
+        case ISNAN:
+        case ISINF:
+        case SINH:
+        case COSH:
+        case TANH:
+        case INT:
+        case UNSIGNED:
+        case DOUBLE:
+          return true;
+
+        // Fatal on floating point data: leave that to the tree
+        case BITWISE_AND:
+        case BITWISE_OR:
+          return node->GetType() != FLOATING_POINT_NODE;
+        case BITWISE_NOT:
+          return n1->GetType() != FLOATING_POINT_NODE;
+
+        default:
+          return false;
+      }
+    }
+
+    // Emit the operations evaluating the node.  Returns the register
+    // holding the result, which has the type of the node.
+    unsigned Emit(const Symbol* node) {
+
+      if (!IsLowered(node)) {
+        switch (node->GetType()) {
+          case UNSIGNED_NODE:
+            return EmitLeaf(static_cast<const Node<uint64_t>* >(node));
+          case SIGNED_NODE:
+            return EmitLeaf(static_cast<const Node<int64_t>* >(node));
+          default:
+            return EmitLeaf(static_cast<const Node<double>* >(node));
+        }
+      }
+
+      SymbolType type = e_.GetOperation(node);
+      Symbol* n1 = e_.GetOperand(node, 0);
+      Symbol* n2 = e_.GetOperand(node, 1);
+      if (type == LOGICAL_AND || type == LOGICAL_OR) {
+        return EmitLogical(type, n1, n2);
+      }
+      if (!n2) {
+        return EmitUnary(type, n1);
+      }
+      return EmitBinary(node, type, n1, n2);
+    }
+
+  private:
+
+    const Expression& e_;
+    ExpressionProgram& program_;
+
+    unsigned Add(ProgramOp op, unsigned a = 0, unsigned b = 0) {
+      unsigned out = program_.AddRegister();
+      program_.AddInstruction(ProgramInstruction(op, out, a, b));
+      return out;
+    }
+
+    // Constants are preloaded, scalar fields are read in place, and
+    // anything else is evaluated as a tree
+    template <typename T>
+    unsigned EmitLeaf(const Node<T>* node) {
+
+      const ConstNode<T>* constant = dynamic_cast<const ConstNode<T>* >(node);
+      if (constant) {
+        return program_.AddConstant((*constant)[0]);
+      }
+
+      SymbolType type = node->GetType();
+      ProgramInstruction in(GetTypedOp(NODE_U, type), program_.AddRegister());
+      in.source_ = node;
+      const FieldNode<T>* field = dynamic_cast<const FieldNode<T>* >(node);
+      if (field && !field->HasParent()) {
+        in.op_ = GetTypedOp(LOAD_U, type);
+        in.source_ = field->EvaluateBatch();
+      }
+      program_.AddInstruction(in);
+      return in.out_;
+    }
+
+    unsigned Convert(unsigned reg, SymbolType from, SymbolType to) {
+
+      if (from == to) {
+        return reg;
+      }
+      switch (from) {
+        case UNSIGNED_NODE:
+          return Add(to == SIGNED_NODE ? U_TO_I : U_TO_D, reg);
+        case SIGNED_NODE:
+          return Add(to == UNSIGNED_NODE ? I_TO_U : I_TO_D, reg);
+        default:
+          return Add(to == UNSIGNED_NODE ? D_TO_U : D_TO_I, reg);
+      }
+    }
+
+    // The second operand is skipped when the first decides the result
+    unsigned EmitLogical(SymbolType type, Symbol* n1, Symbol* n2) {
+
+      unsigned out = program_.AddRegister();
+      unsigned a = Emit(n1);
+      program_.AddInstruction(
+               ProgramInstruction(GetTypedOp(TEST_U, n1->GetType()), out, a));
+      unsigned jump = program_.AddInstruction(ProgramInstruction(
+                 type == LOGICAL_AND ? JUMP_ZERO : JUMP_NONZERO, out, out));
+      unsigned b = Emit(n2);
+      program_.AddInstruction(
+               ProgramInstruction(GetTypedOp(TEST_U, n2->GetType()), out, b));
+      program_.GetInstruction(jump).b_ = program_.GetNInstructions();
+      return out;
+    }
+
+    unsigned EmitUnary(SymbolType type, Symbol* n1) {
+
+      SymbolType t1 = n1->GetType();
+      unsigned a = Emit(n1);
+      switch (type) {
+
+        case LOGICAL_NOT: return Add(GetTypedOp(NOT_U, t1), a);
+        case BITWISE_NOT: return Add(GetTypedOp(BITWISE_NOT_U, t1), a);
+        case INT: return Add(GetTypedOp(INT_U, t1), a);
+        case UNSIGNED: return Add(GetTypedOp(UNSIGNED_U, t1), a);
+        case DOUBLE: return Convert(a, t1, FLOATING_POINT_NODE);
+        case ISNAN:
+          return Add(ISNAN_D, Convert(a, t1, FLOATING_POINT_NODE));
+        case ISINF:
+          return Add(ISINF_D, Convert(a, t1, FLOATING_POINT_NODE));
+
+        default: {
+          ProgramInstruction in(CALL1_D, program_.AddRegister(),
+                                Convert(a, t1, FLOATING_POINT_NODE));
+          in.function1_ = GetMathFunction1(type);
+          program_.AddInstruction(in);
+          return in.out_;
+        }
+      }
+    }
+
+    unsigned EmitBinary(const Symbol* node,
+                        SymbolType type, Symbol* n1, Symbol* n2) {
+
+      // Arithmetic nodes compute in their result type
+      SymbolType dominant = node->GetType();
+      ProgramOp op = CALL2_D;
+      switch (type) {
+        case ADDITION: op = ADD_U; break;
+        case SUBTRACTION: op = SUB_U; break;
+        case MULTIPLICATION: op = MUL_U; break;
+        case DIVISION: op = DIV_U; break;
+        case BITWISE_AND: op = BITWISE_AND_U; break;
+        case BITWISE_OR: op = BITWISE_OR_U; break;
+        case MODULUS: op = MOD_U; break;
+        case EQUALITY: op = EQ_U; break;
+        case INEQUALITY: op = NE_U; break;
+        case GREATER_THAN: op = GT_U; break;
+        case LESS_THAN: op = LT_U; break;
+        case GREATER_THAN_EQUAL: op = GE_U; break;
+        case LESS_THAN_EQUAL: op = LE_U; break;
+        default: break;
+      }
+      if (op >= EQ_U && op <= LE_D) {
+        dominant = GetDominantType(n1->GetType(), n2->GetType());
+      }
+
+      unsigned a = Convert(Emit(n1), n1->GetType(), dominant);
+      // Squares use their operand twice: evaluate it once
+      unsigned b = n2 == n1 ? a : Convert(Emit(n2), n2->GetType(), dominant);
+      if (op != CALL2_D) {
+        return Add(GetTypedOp(op, dominant), a, b);
+      }
+
+      ProgramInstruction in(CALL2_D, program_.AddRegister(), a, b);
+      in.function2_ = GetMathFunction2(type);
+      program_.AddInstruction(in);
+      return in.out_;
+    }
+};
+
+template <typename T>
+Symbol* GetProgramNode(Symbol* head, const ExpressionProgram& program) {
+  return new ProgramNode<T>(*static_cast<Node<T>* >(head), program);
+}
+
+bool HasParent(const Symbol* s) {
+  switch (s->GetType()) {
+    case FLOATING_POINT_NODE:
+      return static_cast<const Node<double>* >(s)->HasParent();
+    case SIGNED_NODE:
+      return static_cast<const Node<int64_t>* >(s)->HasParent();
+    case UNSIGNED_NODE:
+      return static_cast<const Node<uint64_t>* >(s)->HasParent();
+    default:
+      return true;
+  }
+}
+
+} // namespace
+
+Symbol*
+Expression::Compile(Symbol* node) {
+
+  // Vector expressions are evaluated in batches by the tree itself
+  if (HasParent(node)) {
+    return node;
+  }
+
+  ExpressionProgram program;
+  ProgramCompiler compiler(*this, program);
+  if (!compiler.IsLowered(node)) {
+    return node;
+  }
+  program.SetResult(compiler.Emit(node));
+
+  Symbol* compiled;
+  switch (node->GetType()) {
+    case UNSIGNED_NODE:
+      compiled = GetProgramNode<uint64_t>(node, program);
+      break;
+    case SIGNED_NODE:
+      compiled = GetProgramNode<int64_t>(node, program);
+      break;
+    default:
+      compiled = GetProgramNode<double>(node, program);
+      break;
+  }
+  allocatedSymbols_.push_back(compiled);
+  return compiled;
+}
@@ -42,6 +42,10 @@ void XCDFFile::Init() {
   blockCount_ = 0;
   blockEventCount_ = 0;
 
+  generationCounter_ = 0;
+  eventGeneration_ = 0;
+  blockGeneration_ = 0;
+
   isModifiable_ = true;
   blockTableComplete_ = false;
   headerWritten_ = false;
@@ -126,10 +130,12 @@ void XCDFFile::Close() {
   streamHandler_.Close();
 
   fieldList_.clear();
+  decodePlan_.Clear();
 
   eventCount_ = 0;
   blockCount_ = 0;
   blockEventCount_ = 0;
+  eventGeneration_ = 0;
 
   isModifiable_ = true;
   blockTableComplete_ = false;
@@ -227,6 +233,72 @@ bool XCDFFile::Open(const char* fileName,
   return isOpen_;
 }
 
+XCDFPtr<XCDFFile> XCDFFile::CloneReader() const {
+
+  if (!isOpen_ || !IsReadable()) {
+    XCDFFatal("CloneReader(): File not opened for reading");
+  }
+
+  XCDFPtr<XCDFFile> clone = xcdf_shared(new XCDFFile());
+  clone->OpenClone(*this);
+  return clone;
+}
+
+/*
+ *  Open the file backing source and load the metadata already parsed
+ *  by source.  Then position at the first event.
+ */
+void XCDFFile::OpenClone(const XCDFFile& source) {
+
+  streamHandler_.OpenInputStream(source.currentFileName_.c_str());
+  if (!streamHandler_.IsReadable()) {
+    XCDFFatal("CloneReader(): Unable to open " <<
+                  source.currentFileName_ << " for reading");
+  }
+
+  isOpen_ = true;
+  isModifiable_ = false;
+  recover_ = source.recover_;
+  currentFileName_ = source.currentFileName_;
+
+  fileHeader_ = source.fileHeader_;
+  for (std::vector<XCDFFieldDescriptor>::const_iterator
+                        it = fileHeader_.FieldDescriptorsBegin();
+                        it != fileHeader_.FieldDescriptorsEnd(); ++it) {
+
+    XCDFFieldType type = static_cast<XCDFFieldType>(it->type_);
+    AllocateField(it->name_, type, it->rawResolution_, it->parentName_);
+  }
+
+  // Aliases are parsed again so the nodes refer to our own fields
+  for (AliasList::const_iterator it = source.aliasList_.begin();
+                                 it != source.aliasList_.end(); ++it) {
+    aliasList_.push_back(NewAlias((*it)->GetName(), (*it)->GetExpression()));
+  }
+
+  // A partial block table is rebuilt as trailers are encountered
+  if (source.blockTableComplete_) {
+    fileTrailer_ = source.fileTrailer_;
+    blockTableComplete_ = true;
+  }
+  isSimple_ = source.isSimple_;
+  unusableGlobalsFromFile_ = source.unusableGlobalsFromFile_;
+
+  if (source.haveV3Globals_) {
+    for (unsigned i = 0; i < fieldList_.size(); ++i) {
+      const XCDFFieldDataBase& field = *(source.fieldList_[i]);
+      if (field.GlobalsSet()) {
+        fieldList_[i]->SetRawGlobalMin(field.GetRawGlobalMin());
+        fieldList_[i]->SetRawGlobalMax(field.GetRawGlobalMax());
+        fieldList_[i]->SetTotalBytes(field.GetTotalBytes());
+      }
+    }
+    haveV3Globals_ = true;
+  }
+
+  Rewind();
+}
+
 /*
  *  Prepare the file for append operation.  Read block table,
  *  read last incomplete block or start new one, transfer block data
@@ -319,6 +391,9 @@ bool XCDFFile::PrepareAppend(const char* fileName,
     FieldListForEach(ResetField);
   }
 
+  // Fields are now filled by the caller: stop caching alias values
+  eventGeneration_ = 0;
+
   eventCount_ = finalEventCount;
   blockEventCount_ = cnt;
   streamHandler_.CloseInputStream();
@@ -326,16 +401,16 @@ bool XCDFFile::PrepareAppend(const char* fileName,
 }
 
 /*
- *  Write currentFrame_ to ostream_
+ *  Write frame to ostream_
  */
-void XCDFFile::WriteFrame() {
+void XCDFFile::WriteFrame(XCDFFrame& frame) {
 
   assert(IsWritable());
 
   bool writeDeflate = true;
   // don't deflate file headers, since they will be rewritten and must
   // be the same size
-  if (currentFrame_.GetType() == XCDF_FILE_HEADER) {
+  if (frame.GetType() == XCDF_FILE_HEADER) {
     writeDeflate = false;
   }
 
@@ -343,7 +418,7 @@ void XCDFFile::WriteFrame() {
   // Save start-of-frame file pointer
   currentFrameStartOffset_ = ostream.tellp();
   try {
-    currentFrame_.Write(ostream, writeDeflate);
+    frame.Write(ostream, writeDeflate);
   } catch (std::ostream::failure& e) {
     ostream.setstate(std::ostream::failbit);
   }
@@ -357,9 +432,10 @@ void XCDFFile::WriteFrame() {
 }
 
 /*
- *  Read a frame from istream_ into currentFrame_
+ *  Read a frame from istream_ into currentFrame_.  If inflate is false,
+ *  a deflated payload is left compressed.
  */
-void XCDFFile::ReadFrame() {
+void XCDFFile::ReadFrame(bool inflate) {
 
   assert(IsReadable());
 
@@ -368,7 +444,7 @@ void XCDFFile::ReadFrame() {
   // Save start-of-frame file pointer
   currentFrameStartOffset_ = istream.tellg();
   try {
-    currentFrame_.Read(istream);
+    currentFrame_.Read(istream, inflate);
   } catch (std::istream::failure& e) {
     istream.setstate(std::istream::failbit);
   }
@@ -430,10 +506,10 @@ int XCDFFile::Write() {
 /*
  *  Write a block of data to ostream_.  This involves:
  *
- *  1. Read data from the uncompressed buffer
- *  2. Calculate active size for each field
- *  3. Zero align the active mins
- *  4. Create the block header
+ *  1. Calculate the active min/max over the uncompressed buffer
+ *  2. Zero align the active mins
+ *  3. Calculate active size for each field and create the block header
+ *  4. Quantize the uncompressed buffer
  *  5. Serialize the data
  *  6. Write the block header and serialized data to file
  *  7. Reset counters
@@ -446,6 +522,9 @@ void XCDFFile::WriteBlock() {
   blockData_.Clear();
   blockHeader_.SetEventCount(blockEventCount_);
 
+  // Find the block min/max for each field
+  FieldListForEach(CalculateActiveRangeField);
+
   // Align the field bins with zero if possible
   if (zeroAlign_) {
     FieldListForEach(ZeroAlignField);
@@ -460,6 +539,9 @@ void XCDFFile::WriteBlock() {
     blockHeader_.AddFieldHeader(header);
   }
 
+  // Convert the buffered data to integer units
+  FieldListForEach(QuantizeField);
+
   // Write the data block
   for (unsigned i = 0; i < blockEventCount_; ++i) {
     WriteEvent();
@@ -492,6 +574,159 @@ void XCDFFile::WriteBlock() {
   blockEventCount_ = 0;
 }
 
+/*
+ *  Copy the blocks of source directly to ostream_.  This involves:
+ *
+ *  1. Flush any events already written to this file
+ *  2. Read each block header and compressed data frame from source
+ *  3. Add a block table entry and write both frames unchanged
+ *  4. Merge the source field globals into our fields
+ *
+ *  The globals of a file opened for recovery cannot be trusted, so in that
+ *  case each block is also decoded to rebuild them, before any of it is
+ *  written.  The data frames are still written as read.
+ */
+bool XCDFFile::CopyBlocks(XCDFFile& source) {
+
+  // Check that stream is ready and opened for writing
+  if (!IsWritable()) {
+    XCDFFatal("XCDF CopyBlocks Failed: File not opened for writing");
+  }
+
+  if (!source.IsReadable()) {
+    XCDFFatal("XCDF CopyBlocks Failed: Source not opened for reading");
+  }
+
+  if (!CanCopyBlocks(source)) {
+    return false;
+  }
+
+  // Format is fixed after first write.  Prevent changes.
+  isModifiable_ = false;
+
+  // Write out any buffered events so block order matches event order
+  FieldListForEach(CheckFieldContents);
+  if (blockEventCount_ > 0) {
+    WriteBlock();
+  }
+
+  // If header not written, write the header
+  if (!headerWritten_) {
+    fileHeader_.PackFrame(currentFrame_);
+    WriteFrame();
+    headerWritten_ = true;
+  }
+
+  bool decode = source.recover_;
+  XCDFFrame dataFrame;
+  try {
+
+    while (source.ReadNextBlock(false)) {
+
+      uint32_t count = source.blockEventCount_;
+      if (count == 0) {
+        continue;
+      }
+
+      // Decode the block before writing anything, so that a block that
+      // fails to decode is not copied.  Keep a compressed copy to write.
+      if (decode) {
+        dataFrame = source.currentFrame_;
+        source.currentFrame_.Inflate();
+        source.blockData_.UnpackFrame(source.currentFrame_);
+        while (source.blockEventCount_ > 0) {
+          source.ReadEvent();
+        }
+      } else {
+        source.eventCount_ += count;
+        source.blockEventCount_ = 0;
+      }
+
+      // Mark the block starting point
+      XCDFBlockEntry entry;
+      entry.nextEventNumber_ = eventCount_;
+      entry.filePtr_ = streamHandler_.GetOutputStream().tellp();
+      fileTrailer_.AddBlockEntry(entry);
+
+      source.blockHeader_.PackFrame(currentFrame_);
+      WriteFrame();
+      WriteFrame(decode ? dataFrame : source.currentFrame_);
+
+      eventCount_ += count;
+      blockCount_++;
+    }
+  } catch (XCDFException& e) {
+
+    // Keep the output consistent with the blocks that were copied
+    MergeGlobals(source, decode);
+    throw;
+  }
+
+  MergeGlobals(source, decode);
+  return true;
+}
+
+/*
+ *  Blocks can be copied verbatim only if they decode identically in
+ *  both files
+ */
+bool XCDFFile::CanCopyBlocks(const XCDFFile& source) const {
+
+  if (source.fileHeader_.GetVersion() != XCDF_VERSION) {
+    return false;
+  }
+
+  // Globals are merged for the whole source file
+  if (source.eventCount_ != 0 || source.blockEventCount_ != 0) {
+    return false;
+  }
+
+  // Globals in the source trailer do not match its fields
+  if (source.unusableGlobalsFromFile_) {
+    return false;
+  }
+
+  if (fieldList_.size() != source.fieldList_.size()) {
+    return false;
+  }
+
+  for (unsigned i = 0; i < fieldList_.size(); ++i) {
+    const XCDFFieldDataBase& field = *(fieldList_[i]);
+    const XCDFFieldDataBase& sourceField = *(source.fieldList_[i]);
+    if (field.GetName() != sourceField.GetName() ||
+        field.GetType() != sourceField.GetType() ||
+        field.GetRawResolution() != sourceField.GetRawResolution() ||
+        field.GetParentName() != sourceField.GetParentName()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ *  Add the globals of the copied source blocks to our fields.  If the
+ *  blocks were decoded, the source globals are calculated from the data.
+ *  Otherwise, use the globals loaded from the source trailers.
+ */
+void XCDFFile::MergeGlobals(const XCDFFile& source, bool decoded) {
+
+  for (unsigned i = 0; i < fieldList_.size(); ++i) {
+
+    XCDFFieldDataBase& sourceField = *(source.fieldList_[i]);
+    if (decoded) {
+      sourceField.CalculateGlobals();
+      fieldList_[i]->AddBitsProcessed(sourceField.GetBitsProcessed());
+    } else {
+      fieldList_[i]->AddBitsProcessed(sourceField.GetTotalBytes() << 3);
+    }
+
+    if (sourceField.GlobalsSet()) {
+      fieldList_[i]->SetRawGlobalMin(sourceField.GetRawGlobalMin());
+      fieldList_[i]->SetRawGlobalMax(sourceField.GetRawGlobalMax());
+    }
+  }
+}
+
 /*
  * Read an event from the uncompressed buffer and then compress it to
  * the XCDFBlockData object.
@@ -512,17 +747,19 @@ void XCDFFile::ReadEvent() {
 
   assert(blockEventCount_ > 0);
 
-  // Read in event from the compressed buffer
-  for (FieldList::iterator it = fieldList_.begin();
-                           it != fieldList_.end(); ++it) {
-    (*it)->Load(blockData_);
-  }
+  // Read in event from the compressed buffer using the block decode plan
+  decodePlan_.Execute(blockData_);
 
   blockEventCount_--;
   eventCount_++;
+  eventGeneration_ = ++generationCounter_;
 }
 
-bool XCDFFile::ReadNextBlock() {
+/*
+ *  Load the next block.  If unpackData is false, the block data frame is
+ *  left compressed in currentFrame_ and no events can be read from it.
+ */
+bool XCDFFile::ReadNextBlock(bool unpackData) {
 
   assert(IsReadable());
 
@@ -559,28 +796,45 @@ bool XCDFFile::ReadNextBlock() {
       i++;
     }
 
+    // Build the decode plan for the block.  Field widths are now known,
+    // so each field gets a kernel specialized for its width.  The
+    // fixed-width kernels assume little-endian packing.
+    decodePlan_.Clear();
+    for (FieldList::iterator it = fieldList_.begin();
+                             it != fieldList_.end(); ++it) {
+      if (blockData_.MachineIsBigEndian()) {
+        decodePlan_.AddStep(&XCDFGenericDecode, &(**it));
+      } else {
+        decodePlan_.AddStep((*it)->GetDecodeKernel(), &(**it));
+      }
+    }
+
     // Add any remaining events in previous block to the event count
     eventCount_ += blockEventCount_;
 
     // Get event count for next block
     blockEventCount_ = blockHeader_.GetEventCount();
 
-    ReadFrame();
+    ReadFrame(unpackData);
 
     if (currentFrame_.GetType() != XCDF_BLOCK_DATA) {
       XCDFFatal("Block header not followed by data block at file offset: " <<
                                    currentFrameStartOffset_ << ". Aborting.");
     }
 
-    // Shrink internal buffers if previous block > 150 MB
-    if (blockData_.Capacity() > 150000000) {
-      blockData_.Clear();
-      blockData_.Shrink();
-      FieldListForEach(ShrinkField);
-    }
+    if (unpackData) {
+
+      // Shrink internal buffers if previous block > 150 MB
+      if (blockData_.Capacity() > 150000000) {
+        blockData_.Clear();
+        blockData_.Shrink();
+        FieldListForEach(ShrinkField);
+      }
 
-    blockData_.UnpackFrame(currentFrame_);
+      blockData_.UnpackFrame(currentFrame_);
+    }
     blockCount_++;
+    blockGeneration_++;
     return true;
 
   } else if (currentFrame_.GetType() == XCDF_FILE_TRAILER) {
@@ -609,7 +863,7 @@ bool XCDFFile::ReadNextBlock() {
       }
 
       // Go on to the next data block
-      return ReadNextBlock();
+      return ReadNextBlock(unpackData);
 
     } else {
 
@@ -1184,8 +1438,10 @@ void XCDFFile::AllocateField(const std::string& name,
    * 3. floating point
    * This preserves field order compatibility with previous versions
    */
-  fieldList_.insert(
-      std::upper_bound(fieldList_.begin(), fieldList_.end(), type), ptr);
+  FieldList::iterator it = fieldList_.insert(
+      std::upper_bound(fieldList_.begin(), fieldList_.end(), type),
+      XCDFFieldDataBasePtr());
+  *it = ptr;
 }
 
 void XCDFFile::CheckName(const std::string& name) const {
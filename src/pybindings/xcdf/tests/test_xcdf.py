@@ -154,3 +154,51 @@ def test_array_to_field(tmp_path):
             np.testing.assert_array_equal(event["B"], np.arange(5))
             np.testing.assert_array_equal(event["C"], np.arange(-2, 3))
             np.testing.assert_array_equal(event["D"], np.linspace(-1, 1, 5))
+
+
+def test_read_narrow(tmp_path):
+    # Create the test file
+    path = str(tmp_path / "test_read_narrow.xcdf")
+
+    values_B = np.array([0, 255, 256, 2**32 + 5], dtype=np.uint64)
+    values_C = np.array([-(2**40), -1, 0, 2**31 + 3], dtype=np.int64)
+    values_D = np.array([0.1, 1e30, 16777217.0, -2.5e-50])
+
+    # Write to file
+    with File(path, "w") as f:
+        field_A = f.allocate_uint_field("A", 1, "")
+        field_B = f.allocate_uint_field("B", 1, "A")
+        field_C = f.allocate_int_field("C", 1, "A")
+        field_D = f.allocate_float_field("D", 0.0, "A")
+
+        # event/row 1
+        field_A.add(4)
+        field_B.add(values_B)
+        field_C.add(values_C)
+        field_D.add(values_D)
+
+        f.write()
+
+        # event/row 2: empty vectors
+        field_A.add(0)
+
+        f.write()
+
+    # Read back: floating-point vectors are converted to float32,
+    # integer vectors keep their full width
+    with File(path, "r") as f:
+        event = f.read_narrow()
+        assert event["A"] == 4
+        assert event["B"].dtype == np.uint64
+        assert event["C"].dtype == np.int64
+        assert event["D"].dtype == np.float32
+        np.testing.assert_array_equal(event["B"], values_B)
+        np.testing.assert_array_equal(event["C"], values_C)
+        np.testing.assert_array_equal(event["D"], values_D.astype(np.float32))
+
+        event = f.read_narrow()
+        assert event["A"] == 0
+        assert event["D"].dtype == np.float32
+        assert len(event["D"]) == 0
+
+        assert f.read_narrow() is None
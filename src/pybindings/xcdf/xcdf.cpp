@@ -12,6 +12,7 @@
 #include "xcdf/XCDFFieldDescriptor.h"
 #include "xcdf/XCDFFile.h"
 #include <xcdf/XCDFField.h>
+#include <xcdf/XCDFNarrowField.h>
 #include <xcdf/version.h>
 
 namespace py = pybind11;
@@ -92,23 +93,32 @@ void write_test_file(const std::string &path) {
   f.CreateAlias("testTrailerAlias", "double(testAlias + 2)");
 }
 
+// numpy element type for vector fields; narrow mode stores doubles as float32
+template <typename T> struct NarrowType { typedef T type; };
+template <> struct NarrowType<double> { typedef float type; };
+
+template <typename S, typename T>
+py::array_t<S> MakeArray(const XCDFField<T> &field) {
+  py::array_t<S> array(field.GetSize());
+  py::buffer_info buffer = array.request();
+  XCDFNarrowField<S, T>(field).CopyTo(static_cast<S *>(buffer.ptr));
+  return array;
+}
+
 struct DictBuilder {
   py::dict data;
+  bool narrow = false;
 
   template <typename T> void operator()(const XCDFField<T> &field) {
 
     py::str key = field.GetName();
     // return vector fields as numpy arrays
     if (field.HasParent()) {
-      py::array_t<T> array(field.GetSize());
-      py::buffer_info buffer = array.request();
-      T *ptr = static_cast<T *>(buffer.ptr);
-
-      for (size_t i = 0; i < field.GetSize(); i++) {
-        ptr[i] = field[i];
+      if (narrow) {
+        data[key] = MakeArray<typename NarrowType<T>::type>(field);
+      } else {
+        data[key] = MakeArray<T>(field);
       }
-
-      data[key] = array;
       // scalar fields as python objects (None if not set)
     } else {
       if (field.GetSize() == 0) {
@@ -135,7 +145,7 @@ PYBIND11_MODULE(xcdf, m) {
            "Add a datum to the field.")
       .def("add",
            static_cast<void (XCDFField<uint64_t>::*)(
-               const std::vector<uint64_t>)>(&XCDFField<uint64_t>::Add),
+               const std::vector<uint64_t>&)>(&XCDFField<uint64_t>::Add),
            "Add an array of data to the field.");
 
   // XCDFSignedIntegerField
@@ -147,7 +157,7 @@ PYBIND11_MODULE(xcdf, m) {
            "Add a datum to the field.")
       .def(
           "add",
-          static_cast<void (XCDFField<int64_t>::*)(const std::vector<int64_t>)>(
+          static_cast<void (XCDFField<int64_t>::*)(const std::vector<int64_t>&)>(
               &XCDFField<int64_t>::Add),
           "Add an array of data to the field.");
 
@@ -159,7 +169,7 @@ PYBIND11_MODULE(xcdf, m) {
                &XCDFField<double>::Add),
            "Add a datum to the field.")
       .def("add",
-           static_cast<void (XCDFField<double>::*)(const std::vector<double>)>(
+           static_cast<void (XCDFField<double>::*)(const std::vector<double>&)>(
                &XCDFField<double>::Add),
            "Add an array of data to the field.");
 
@@ -348,6 +358,19 @@ PYBIND11_MODULE(xcdf, m) {
             return builder.data;
           },
           "Get to the next event.")
+      .def(
+          "read_narrow",
+          [](XCDFFile &self) -> py::object {
+            if (self.Read() == 0) {
+              return py::none();
+            }
+            DictBuilder builder;
+            builder.narrow = true;
+            self.ApplyFieldVisitor(builder);
+            return builder.data;
+          },
+          "Read the next event, returning floating-point vector fields as "
+          "float32 arrays. Returns None at the end of the file.")
       .def(
           "__enter__", [](XCDFFile &self) { return &self; },
           "Enter the runtime context related to the file object")
@@ -0,0 +1,102 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDFBitUnpack.h>
+
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Stop at the first batch value that differs from single-value unpacking
+template <typename T>
+void Compare(const char* what, T expected, T got,
+             unsigned width, unsigned offset, unsigned i) {
+
+  if (memcmp(&expected, &got, sizeof(T)) != 0) {
+    std::cerr << what << ": Expected: " << expected << " Got: " << got <<
+                 ".  Width: " << width << " Offset: " << offset <<
+                 " Index: " << i << std::endl;
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+
+  // Batch sizes around the 4-value AVX2 step, so the scalar tails are
+  // covered as well as the vector kernels
+  const unsigned sizes[] = {0, 1, 3, 4, 5, 7, 8, 13, 64, 101};
+  const unsigned nSizes = sizeof(sizes) / sizeof(sizes[0]);
+
+  // Random packed stream with the 8 bytes of padding the kernels expect
+  std::mt19937_64 rng(4321);
+  std::vector<char> data(101 * 8 + 2 + 8);
+  for (unsigned i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>(rng());
+  }
+  const char* stream = &data[0];
+
+  std::vector<uint64_t> raw(101);
+  std::vector<uint64_t> u(101);
+  std::vector<int64_t> s(101);
+  std::vector<double> d(101);
+
+  for (unsigned width = 0; width <= 64; ++width) {
+    for (unsigned offset = 0; offset < 10; ++offset) {
+      for (unsigned k = 0; k < nSizes; ++k) {
+
+        unsigned n = sizes[k];
+        XCDFUnpackRaw(stream, offset, width, n, &raw[0]);
+        XCDFUnpackValues(stream, offset, width, n,
+                         static_cast<uint64_t>(17),
+                         static_cast<uint64_t>(3), &u[0]);
+        XCDFUnpackValues(stream, offset, width, n,
+                         static_cast<int64_t>(-1000),
+                         static_cast<int64_t>(2), &s[0]);
+        XCDFUnpackValues(stream, offset, width, n, -12.5, 0.1, &d[0]);
+
+        for (unsigned i = 0; i < n; ++i) {
+          uint64_t datum = width > 0 ?
+                  XCDFUnpackOne(stream, offset + i * width, width) : 0;
+          // Width 64 doubles are stored raw
+          double value = width == 64 ?
+                   XCDFSafeTypePun<uint64_t, double>(datum) :
+                   -12.5 + 0.1 * datum;
+
+          Compare("Raw", datum, raw[i], width, offset, i);
+          Compare("Unsigned", 17 + 3 * datum, u[i], width, offset, i);
+          Compare("Signed", static_cast<int64_t>(-1000 + 2 * datum), s[i],
+                  width, offset, i);
+          Compare("Double", value, d[i], width, offset, i);
+        }
+      }
+    }
+  }
+
+  std::cout << "Success!" << std::endl;
+}
@@ -0,0 +1,162 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <iostream>
+#include <cstdio>
+
+/*
+ *  Check copying of compressed blocks between files with identical
+ *  fields, and recovery of the complete blocks of a damaged file
+ */
+
+const unsigned nEvents = 20000;
+const unsigned blockSize = 1000;
+
+void AllocateFields(XCDFFile& f) {
+  f.AllocateUnsignedIntegerField("n", 1);
+  f.AllocateFloatingPointField("x", 0.01);
+  f.AllocateSignedIntegerField("v", 1, "n");
+}
+
+std::string ReadBytes(const char* name) {
+  std::ifstream in(name, std::ios::binary);
+  std::ostringstream bytes;
+  bytes << in.rdbuf();
+  return bytes.str();
+}
+
+// Check that f holds the first nExpected events written by main()
+bool CheckEvents(XCDFFile& f, uint64_t nExpected, const std::string& what) {
+
+  XCDFUnsignedIntegerField n = f.GetUnsignedIntegerField("n");
+  XCDFFloatingPointField x = f.GetFloatingPointField("x");
+  XCDFSignedIntegerField v = f.GetSignedIntegerField("v");
+  uint64_t count = 0;
+  while (f.Read()) {
+    if (*n != count % 5 || fabs(*x - count * 0.37) > 0.006 ||
+        v.GetSize() != *n || (*n > 0 && v[0] != -static_cast<int64_t>(count))) {
+      std::cerr << what << ": wrong values in event " << count << std::endl;
+      return false;
+    }
+    ++count;
+  }
+  if (count != nExpected || f.GetEventCount() != nExpected) {
+    std::cerr << what << ": read " << count << " events, count " <<
+              f.GetEventCount() << ", expected " << nExpected << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+
+  int status = 0;
+
+  {
+    XCDFFile f("blockcopytest_in.xcd", "w");
+    f.SetBlockSize(blockSize);
+    AllocateFields(f);
+    XCDFUnsignedIntegerField n = f.GetUnsignedIntegerField("n");
+    XCDFFloatingPointField x = f.GetFloatingPointField("x");
+    XCDFSignedIntegerField v = f.GetSignedIntegerField("v");
+    for (unsigned i = 0; i < nEvents; ++i) {
+      n << i % 5;
+      x << i * 0.37;
+      for (unsigned j = 0; j < i % 5; ++j) {
+        v << -static_cast<int64_t>(i + j);
+      }
+      f.Write();
+    }
+    f.Close();
+  }
+
+  // Copying all blocks reproduces the file
+  {
+    XCDFFile in("blockcopytest_in.xcd", "r");
+    XCDFFile out("blockcopytest_out.xcd", "w");
+    AllocateFields(out);
+    if (!out.CopyBlocks(in)) {
+      std::cerr << "Blocks not copied" << std::endl;
+      status = 1;
+    }
+    out.Close();
+  }
+  if (ReadBytes("blockcopytest_out.xcd") !=
+      ReadBytes("blockcopytest_in.xcd")) {
+    std::cerr << "Copied file differs from the original" << std::endl;
+    status = 1;
+  }
+
+  // Different field resolutions need decoding
+  {
+    XCDFFile in("blockcopytest_in.xcd", "r");
+    XCDFFile out("blockcopytest_out.xcd", "w");
+    out.AllocateUnsignedIntegerField("n", 1);
+    out.AllocateFloatingPointField("x", 0.001);
+    out.AllocateSignedIntegerField("v", 1, "n");
+    if (out.CopyBlocks(in)) {
+      std::cerr << "Blocks copied with a different resolution" << std::endl;
+      status = 1;
+    }
+  }
+
+  // Damage the file in the data of its 12th block, by truncating it or
+  // by overwriting some bytes.  Recovery keeps the 11 blocks before it.
+  std::string bytes = ReadBytes("blockcopytest_in.xcd");
+  for (int overwrite = 0; overwrite < 2; ++overwrite) {
+    std::ofstream damaged("blockcopytest_bad.xcd", std::ios::binary);
+    size_t pos = bytes.size() * 23 / 40;
+    if (overwrite) {
+      damaged << bytes.substr(0, pos) << "XXXXXXXX" << bytes.substr(pos + 8);
+    } else {
+      damaged << bytes.substr(0, pos);
+    }
+    damaged.close();
+
+    XCDFFile in("blockcopytest_bad.xcd", "c");
+    XCDFFile out("blockcopytest_out.xcd", "w");
+    AllocateFields(out);
+    try {
+      out.CopyBlocks(in);
+    } catch (XCDFException& e) { }
+    out.Close();
+
+    XCDFFile check("blockcopytest_out.xcd", "r");
+    if (!CheckEvents(check, 11 * blockSize, "recover")) {
+      status = 1;
+    }
+  }
+
+  remove("blockcopytest_in.xcd");
+  remove("blockcopytest_out.xcd");
+  remove("blockcopytest_bad.xcd");
+  return status;
+}
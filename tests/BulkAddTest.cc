@@ -0,0 +1,113 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <vector>
+#include <list>
+#include <iostream>
+#include <cstdio>
+
+/*
+ *  Check the bulk Add overloads of fields
+ */
+
+int main(int argc, char** argv) {
+
+  const unsigned nEvents = 2000;
+  const char* name = "bulkaddtest.xcd";
+
+  XCDFFile w(name, "w");
+  w.SetBlockSize(100);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField v = w.AllocateUnsignedIntegerField("v", 1, "n");
+  XCDFFloatingPointField d = w.AllocateFloatingPointField("d", 0., "n");
+
+  std::vector<std::vector<uint64_t> > expected;
+  for (unsigned i = 0; i < nEvents; ++i) {
+
+    unsigned size = (i * 37) % 300;
+    std::vector<uint64_t> values(size);
+    std::vector<double> doubles(size);
+    for (unsigned j = 0; j < size; ++j) {
+      values[j] = i * 1000 + j;
+      doubles[j] = values[j] * 0.5;
+    }
+    expected.push_back(values);
+    n << size;
+
+    uint64_t* begin = size > 0 ? &values[0] : NULL;
+    const uint64_t* cbegin = begin;
+    switch (i % 5) {
+      case 0:
+        v.Add(values);
+        break;
+      case 1:
+        // Non-const pointers take the contiguous path
+        v.Add(begin, begin + size);
+        break;
+      case 2:
+        v.Add(cbegin, cbegin + size);
+        break;
+      case 3: {
+        std::list<uint64_t> l(values.begin(), values.end());
+        v.Add(l.begin(), l.end());
+        break;
+      }
+      case 4:
+        // A literal 0 count is not ambiguous
+        v.Add(begin, 0);
+        v.Add(begin, size);
+        break;
+    }
+    d.Add(doubles.begin(), doubles.end());
+    w.Write();
+  }
+  w.Close();
+
+  XCDFFile f(name, "r");
+  XCDFUnsignedIntegerField rv = f.GetUnsignedIntegerField("v");
+  XCDFFloatingPointField rd = f.GetFloatingPointField("d");
+  int fail = 0;
+  for (unsigned i = 0; f.Read(); ++i) {
+    const std::vector<uint64_t>& values = expected[i];
+    bool ok = rv.GetSize() == values.size() && rd.GetSize() == values.size();
+    for (unsigned j = 0; ok && j < values.size(); ++j) {
+      ok = rv[j] == values[j] && rd[j] == values[j] * 0.5;
+    }
+    if (!ok) {
+      std::cerr << "Event " << i << " differs" << std::endl;
+      ++fail;
+    }
+  }
+  if (f.GetEventCount() != nEvents) {
+    std::cerr << "Read " << f.GetEventCount() << " events" << std::endl;
+    ++fail;
+  }
+
+  std::remove(name);
+  return fail == 0 ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+
+#include <thread>
+#include <vector>
+#include <cstdio>
+
+/*
+ *  Sum field1 over events [start, end) with a cloned reader
+ */
+void SumRange(XCDFPtr<XCDFFile> reader, uint64_t start,
+              uint64_t end, uint64_t* sum) {
+
+  XCDFUnsignedIntegerField field1 = reader->GetUnsignedIntegerField("field1");
+  XCDFFloatingPointField field2 = reader->GetFloatingPointField("field2");
+  *sum = 0;
+  for (uint64_t i = start; i < end; ++i) {
+    if (!reader->Seek(i)) {
+      std::cerr << "Seek to " << i << " failed" << std::endl;
+      exit(1);
+    }
+    *sum += *field1;
+    for (unsigned j = 0; j < field2.GetSize(); ++j) {
+      *sum += static_cast<uint64_t>(field2[j]);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+
+  XCDFFile f("clonetest.xcd", "w");
+  XCDFUnsignedIntegerField field1 =
+                      f.AllocateUnsignedIntegerField("field1", 1);
+  XCDFFloatingPointField field2 =
+                      f.AllocateFloatingPointField("field2", 1., "field1");
+
+  uint64_t expected = 0;
+  for (int k = 0; k < 20000; k++) {
+    unsigned n = k % 7;
+    field1 << n;
+    expected += n;
+    for (unsigned j = 0; j < n; ++j) {
+      field2 << k + j;
+      expected += k + j;
+    }
+    f.Write();
+  }
+  f.Close();
+
+  XCDFFile h("clonetest.xcd", "r");
+  uint64_t count = h.GetEventCount();
+
+  const unsigned nThreads = 4;
+  std::vector<XCDFPtr<XCDFFile> > readers;
+  for (unsigned i = 0; i < nThreads; ++i) {
+    readers.push_back(h.CloneReader());
+  }
+
+  std::vector<uint64_t> sums(nThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < nThreads; ++i) {
+    threads.push_back(std::thread(SumRange, readers[i],
+                                  count * i / nThreads,
+                                  count * (i + 1) / nThreads, &sums[i]));
+  }
+
+  uint64_t total = 0;
+  for (unsigned i = 0; i < nThreads; ++i) {
+    threads[i].join();
+    total += sums[i];
+  }
+
+  std::cout << "Clone sum: " << total << ", expected: "
+                                    << expected << std::endl;
+  if (total != expected) {
+    std::cerr << "Clone reader sum mismatch" << std::endl;
+    exit(1);
+  }
+  h.Close();
+}
@@ -0,0 +1,226 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+/*
+ *  Write fields of every active width, scalar and vector, and check that
+ *  the per-block decode plans read back the values that were written
+ */
+
+const unsigned nEvents = 3000;
+
+std::string Name(const std::string& prefix, unsigned width) {
+  std::ostringstream name;
+  name << prefix << width;
+  return name.str();
+}
+
+uint64_t Mask(unsigned width) {
+  return width < 64 ? (static_cast<uint64_t>(1) << width) - 1 : ~0ULL;
+}
+
+// Values are drawn from the same sequence when writing and reading
+class Values {
+
+  public:
+
+    Values() : rng_(12345) { }
+
+    unsigned Size() {return rng_() % 10;}
+
+    uint64_t Unsigned(unsigned width) {return rng_() & Mask(width);}
+
+    int64_t Signed(unsigned width) {
+      return static_cast<int64_t>(rng_() & Mask(width)) -
+             static_cast<int64_t>(Mask(width - 1));
+    }
+
+    double Quantized(unsigned width) {
+      return -1000. + 0.25 * (rng_() & Mask(width));
+    }
+
+    double Raw() {
+      uint64_t r = rng_();
+      switch (r % 16) {
+        case 0: return NAN;
+        case 1: return INFINITY;
+        case 2: return -0.;
+        default: return (r >> 11) * 1e-7 - 1e5;
+      }
+    }
+
+  private:
+
+    std::mt19937_64 rng_;
+};
+
+const unsigned maxUnsigned = 64;
+const unsigned maxSigned = 62;
+const unsigned maxQuantized = 50;
+
+template <typename T>
+struct Fields {
+  std::vector<T> scalars_;
+  std::vector<T> vectors_;
+};
+
+bool Same(double a, double b) {
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int main(int argc, char** argv) {
+
+  const char* name = "decodetest.xcd";
+
+  XCDFFile w(name, "w");
+  w.SetBlockSize(700);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFFloatingPointField raw = w.AllocateFloatingPointField("raw", 0.);
+  XCDFFloatingPointField rawv = w.AllocateFloatingPointField("rawv", 0., "n");
+  Fields<XCDFUnsignedIntegerField> u;
+  Fields<XCDFSignedIntegerField> s;
+  Fields<XCDFFloatingPointField> d;
+  for (unsigned width = 1; width <= maxUnsigned; ++width) {
+    u.scalars_.push_back(w.AllocateUnsignedIntegerField(Name("u", width), 1));
+    u.vectors_.push_back(
+           w.AllocateUnsignedIntegerField(Name("uv", width), 1, "n"));
+  }
+  for (unsigned width = 2; width <= maxSigned; ++width) {
+    s.scalars_.push_back(w.AllocateSignedIntegerField(Name("s", width), 1));
+    s.vectors_.push_back(
+           w.AllocateSignedIntegerField(Name("sv", width), 1, "n"));
+  }
+  for (unsigned width = 1; width <= maxQuantized; ++width) {
+    d.scalars_.push_back(w.AllocateFloatingPointField(Name("d", width), 0.25));
+    d.vectors_.push_back(
+           w.AllocateFloatingPointField(Name("dv", width), 0.25, "n"));
+  }
+
+  Values values;
+  for (unsigned i = 0; i < nEvents; ++i) {
+    unsigned size = values.Size();
+    n << size;
+    raw << values.Raw();
+    for (unsigned j = 0; j < size; ++j) {
+      rawv << values.Raw();
+    }
+    for (unsigned k = 0; k < u.scalars_.size(); ++k) {
+      unsigned width = k + 1;
+      u.scalars_[k] << values.Unsigned(width);
+      for (unsigned j = 0; j < size; ++j) {
+        u.vectors_[k] << values.Unsigned(width);
+      }
+    }
+    for (unsigned k = 0; k < s.scalars_.size(); ++k) {
+      unsigned width = k + 2;
+      s.scalars_[k] << values.Signed(width);
+      for (unsigned j = 0; j < size; ++j) {
+        s.vectors_[k] << values.Signed(width);
+      }
+    }
+    for (unsigned k = 0; k < d.scalars_.size(); ++k) {
+      unsigned width = k + 1;
+      d.scalars_[k] << values.Quantized(width);
+      for (unsigned j = 0; j < size; ++j) {
+        d.vectors_[k] << values.Quantized(width);
+      }
+    }
+    w.Write();
+  }
+  w.Close();
+
+  XCDFFile f(name, "r");
+  n = f.GetUnsignedIntegerField("n");
+  raw = f.GetFloatingPointField("raw");
+  rawv = f.GetFloatingPointField("rawv");
+  for (unsigned width = 1; width <= maxUnsigned; ++width) {
+    u.scalars_[width - 1] = f.GetUnsignedIntegerField(Name("u", width));
+    u.vectors_[width - 1] = f.GetUnsignedIntegerField(Name("uv", width));
+  }
+  for (unsigned width = 2; width <= maxSigned; ++width) {
+    s.scalars_[width - 2] = f.GetSignedIntegerField(Name("s", width));
+    s.vectors_[width - 2] = f.GetSignedIntegerField(Name("sv", width));
+  }
+  for (unsigned width = 1; width <= maxQuantized; ++width) {
+    d.scalars_[width - 1] = f.GetFloatingPointField(Name("d", width));
+    d.vectors_[width - 1] = f.GetFloatingPointField(Name("dv", width));
+  }
+
+  int fail = 0;
+  Values expected;
+  unsigned i = 0;
+  for (; f.Read(); ++i) {
+    bool ok = true;
+    unsigned size = expected.Size();
+    ok &= *n == size;
+    ok &= Same(*raw, expected.Raw());
+    for (unsigned j = 0; j < size; ++j) {
+      ok &= Same(rawv[j], expected.Raw());
+    }
+    for (unsigned k = 0; k < u.scalars_.size(); ++k) {
+      unsigned width = k + 1;
+      ok &= *u.scalars_[k] == expected.Unsigned(width);
+      for (unsigned j = 0; j < size; ++j) {
+        ok &= u.vectors_[k][j] == expected.Unsigned(width);
+      }
+    }
+    for (unsigned k = 0; k < s.scalars_.size(); ++k) {
+      unsigned width = k + 2;
+      ok &= *s.scalars_[k] == expected.Signed(width);
+      for (unsigned j = 0; j < size; ++j) {
+        ok &= s.vectors_[k][j] == expected.Signed(width);
+      }
+    }
+    for (unsigned k = 0; k < d.scalars_.size(); ++k) {
+      unsigned width = k + 1;
+      ok &= Same(*d.scalars_[k], expected.Quantized(width));
+      for (unsigned j = 0; j < size; ++j) {
+        ok &= Same(d.vectors_[k][j], expected.Quantized(width));
+      }
+    }
+    if (!ok) {
+      std::cerr << "Event " << i << " differs" << std::endl;
+      ++fail;
+    }
+  }
+  if (i != nEvents) {
+    std::cerr << "Read " << i << " events" << std::endl;
+    ++fail;
+  }
+
+  std::remove(name);
+  return fail == 0 ? 0 : 1;
+}
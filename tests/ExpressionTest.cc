@@ -0,0 +1,373 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/EventSelectExpression.h>
+#include <xcdf/utility/NumericalExpression.h>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <set>
+#include <fstream>
+#include <iostream>
+
+/*
+ *  Check expression optimization, the short-circuit "&&" and "||"
+ *  operators, including adaptive reordering of selection cuts, the
+ *  functions reducing vectors, value lists read from files, and the
+ *  evaluation of scalar expressions through an ExpressionProgram
+ */
+
+int nFailures = 0;
+
+void Check(bool pass, const std::string& what) {
+  if (!pass) {
+    std::cerr << "Failed: " << what << std::endl;
+    ++nFailures;
+  }
+}
+
+void CheckTotal(const XCDFFile& f, const std::string& exp, bool total) {
+  Expression e(exp, f);
+  Check(e.IsTotal(e.GetHeadSymbol()) == total, "IsTotal(" + exp + ")");
+}
+
+// Count selected events with and without adaptive reordering
+void CheckSelection(const std::string& exp, uint64_t expected) {
+
+  for (int adaptive = 0; adaptive < 2; ++adaptive) {
+    XCDFFile f("expressiontest.xcd", "r");
+    EventSelectExpression sel(exp, f, adaptive);
+    uint64_t count = 0;
+    while (f.Read()) {
+      count += sel.SelectEvent();
+    }
+    if (count != expected) {
+      std::cerr << exp << (adaptive ? " (adaptive)" : "") << ": selected "
+                << count << ", expected " << expected << std::endl;
+      ++nFailures;
+    }
+  }
+}
+
+template <typename T>
+bool SameValue(T a, T b) {return a == b;}
+
+template <>
+bool SameValue(double a, double b) {
+  return a == b || (std::isnan(a) && std::isnan(b));
+}
+
+template <typename T>
+bool SameResult(const Symbol* tree, const Symbol* compiled) {
+  const Node<T>& n1 = *static_cast<const Node<T>* >(tree);
+  const Node<T>& n2 = *static_cast<const Node<T>* >(compiled);
+  if (n1.GetSize() != n2.GetSize() || n1.GetSize() == 0) {
+    return n1.GetSize() == n2.GetSize();
+  }
+  T value = n1[0];
+  return SameValue(value, n2[0]) && SameValue(value, *n2.EvaluateBatch());
+}
+
+// Compare a compiled scalar expression with the tree, event by event
+void CheckCompiled(const std::string& exp, bool lowered = true) {
+
+  XCDFFile f("expressiontest.xcd", "r");
+  Expression e(exp, f);
+  Symbol* head = e.GetHeadSymbol();
+  Symbol* compiled = e.Compile(head);
+  Check((compiled != head) == lowered, "Compile(" + exp + ")");
+  Check(compiled->GetType() == head->GetType(), "type of " + exp);
+
+  while (f.Read()) {
+    bool same;
+    switch (head->GetType()) {
+      case UNSIGNED_NODE: same = SameResult<uint64_t>(head, compiled); break;
+      case SIGNED_NODE: same = SameResult<int64_t>(head, compiled); break;
+      default: same = SameResult<double>(head, compiled); break;
+    }
+    if (!same) {
+      std::cerr << exp << ": compiled result differs at event "
+                << f.GetCurrentEventNumber() << std::endl;
+      ++nFailures;
+      return;
+    }
+  }
+}
+
+// Compare the vector functions against values computed from the fields
+void CheckReductions(XCDFFile& f) {
+
+  XCDFUnsignedIntegerField v = f.GetUnsignedIntegerField("v");
+  XCDFFloatingPointField y = f.GetFloatingPointField("y");
+
+  NumericalExpression<uint64_t> sum("sum(v)", f);
+  NumericalExpression<uint64_t> min("min(v)", f);
+  NumericalExpression<uint64_t> max("max(v)", f);
+  NumericalExpression<double> mean("mean(v)", f);
+  NumericalExpression<uint64_t> count("count(v)", f);
+  NumericalExpression<uint64_t> argmax("argmax(v)", f);
+  NumericalExpression<uint64_t> first("first(v)", f);
+  NumericalExpression<uint64_t> last("last(v)", f);
+  NumericalExpression<uint64_t> any("any(v)", f);
+  NumericalExpression<uint64_t> all("all(v)", f);
+  NumericalExpression<uint64_t> unique("unique(v)", f);
+  NumericalExpression<uint64_t> uniqueNaN("unique(y)", f);
+
+  // More values than the linear search limit of "in"
+  NumericalExpression<uint64_t> in("sum(in(y, (0.5, 1., 2., 3., 4., 5., "
+                                   "6., 7., 8., 9., 10., 11., 12., 13., "
+                                   "14., 15., 16., 17.)))", f);
+  NumericalExpression<uint64_t> inShort("sum(in(y, (0.5, 1.)))", f);
+
+  while (f.Read()) {
+
+    uint64_t eSum = 0;
+    uint64_t eMin = 0;
+    uint64_t eMax = 0;
+    uint64_t eCount = 0;
+    uint64_t eArgmax = 0;
+    std::set<uint64_t> values;
+    for (unsigned i = 0; i < v.GetSize(); ++i) {
+      eSum += v[i];
+      eMin = (i == 0 || v[i] < eMin) ? v[i] : eMin;
+      if (i == 0 || v[i] > eMax) {
+        eMax = v[i];
+        eArgmax = i;
+      }
+      eCount += v[i] != 0;
+      values.insert(v[i]);
+    }
+    unsigned size = v.GetSize();
+
+    Check(sum.Evaluate() == eSum, "sum(v)");
+    Check(min.Evaluate() == eMin, "min(v)");
+    Check(max.Evaluate() == eMax, "max(v)");
+    Check(size == 0 ? std::isnan(mean.Evaluate()) :
+                      mean.Evaluate() == double(eSum) / size, "mean(v)");
+    Check(count.Evaluate() == eCount, "count(v)");
+    Check(argmax.Evaluate() == eArgmax, "argmax(v)");
+    Check(first.Evaluate() == (size > 0 ? v[0] : 0), "first(v)");
+    Check(last.Evaluate() == (size > 0 ? v[size - 1] : 0), "last(v)");
+    Check(any.Evaluate() == (eCount > 0), "any(v)");
+    Check(all.Evaluate() == (size > 0 && eCount == size), "all(v)");
+    Check(unique.Evaluate() == values.size(), "unique(v)");
+
+    // All NaNs count as one value, and NaN is in no list
+    std::set<double> yValues;
+    bool hasNaN = false;
+    uint64_t nIn = 0;
+    for (unsigned i = 0; i < y.GetSize(); ++i) {
+      if (std::isnan(y[i])) {
+        hasNaN = true;
+      } else {
+        yValues.insert(y[i]);
+        nIn += y[i] == 0.5 || y[i] == 1.;
+      }
+    }
+    Check(uniqueNaN.Evaluate() == yValues.size() + hasNaN, "unique(y)");
+    Check(in.Evaluate() == nIn, "in(y, long list)");
+    Check(inShort.Evaluate() == nIn, "in(y, short list)");
+  }
+}
+
+// True if parsing exp fails with a message naming what
+bool ParseFails(XCDFFile& f, const std::string& exp, const std::string& what) {
+  try {
+    NumericalExpression<uint64_t> e(exp, f);
+  } catch (const XCDFException& e) {
+    return e.GetMessage().find(what) != std::string::npos;
+  }
+  return false;
+}
+
+// Check in(field, @file) lists against the values they hold
+void CheckFileLists(XCDFFile& f) {
+
+  const char* listName = "expressiontest_list.txt";
+  const char* emptyName = "expressiontest_empty.txt";
+  const char* commentName = "expressiontest_comment.txt";
+  const char* badName = "expressiontest_bad.txt";
+  {
+    // Values separated by commas, spaces and lines, with comments
+    std::ofstream list(listName);
+    list << "# values of n\n1, 3 # odd\n\n  4,\n#2\n";
+    std::ofstream empty(emptyName);
+    std::ofstream comment(commentName);
+    comment << "# no values\n";
+    std::ofstream bad(badName);
+    bad << "1, three\n";
+  }
+
+  NumericalExpression<uint64_t> inList("in(n, @expressiontest_list.txt)", f);
+  NumericalExpression<uint64_t> inEmpty("in(n, @expressiontest_empty.txt)",
+                                        f);
+  NumericalExpression<uint64_t>
+                  inComment("in(n, @expressiontest_comment.txt)", f);
+  XCDFUnsignedIntegerField n = f.GetUnsignedIntegerField("n");
+  while (f.Read()) {
+    Check(inList.Evaluate() == (*n == 1 || *n == 3 || *n == 4),
+          "in(n, @list)");
+    Check(inEmpty.Evaluate() == 0, "in(n, @empty)");
+    Check(inComment.Evaluate() == 0, "in(n, @comment)");
+  }
+
+  Check(ParseFails(f, "in(n, @expressiontest_missing.txt)",
+                   "expressiontest_missing.txt"), "missing list file");
+  Check(ParseFails(f, "in(n, @expressiontest_bad.txt)", "three"),
+        "bad value in list file");
+
+  std::remove(listName);
+  std::remove(emptyName);
+  std::remove(commentName);
+  std::remove(badName);
+}
+
+int main(int argc, char** argv) {
+
+  const unsigned nEvents = 20000;
+
+  XCDFFile w("expressiontest.xcd", "w");
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField d = w.AllocateUnsignedIntegerField("d", 1);
+  XCDFFloatingPointField x = w.AllocateFloatingPointField("x", 0.);
+  XCDFUnsignedIntegerField v = w.AllocateUnsignedIntegerField("v", 1, "n");
+  XCDFFloatingPointField y = w.AllocateFloatingPointField("y", 0., "n");
+
+  uint64_t nGuard = 0;
+  uint64_t nMixed = 0;
+  uint64_t nVector = 0;
+  for (unsigned i = 0; i < nEvents; ++i) {
+    unsigned nVal = i % 5;
+    unsigned dVal = (i / 3) % 4;
+    double xVal = (i % 100) / 100.;
+    n << nVal;
+    d << dVal;
+    x << xVal;
+    bool anyV = false;
+    for (unsigned j = 0; j < nVal; ++j) {
+      unsigned vVal = (i + j) % 3;
+      v << vVal;
+      y << ((i + j) % 7 == 0 || (i * j) % 11 == 5 ? NAN : (i * j % 3) * 0.5);
+      anyV |= vVal != 0 && 10 / vVal > 6;
+    }
+    w.Write();
+
+    bool guard = dVal != 0 && nVal / dVal > 1;
+    nGuard += guard;
+    nMixed += xVal > 0.2 && guard && xVal < 0.9;
+    nVector += anyV;
+  }
+  w.Close();
+
+  // Integer division by zero must never be evaluated
+  CheckSelection("d != 0 && n / d > 1", nGuard);
+  CheckSelection("x > 0.2 && d != 0 && n / d > 1 && x < 0.9", nMixed);
+  CheckSelection("(d != 0 && n / d > 1)", nGuard);
+  CheckSelection("!(d == 0 || n / d <= 1)", nGuard);
+  CheckSelection("v != 0 && 10 / v > 6", nVector);
+
+  XCDFFile f("expressiontest.xcd", "r");
+
+  CheckTotal(f, "n / d > 1", false);
+  CheckTotal(f, "n % d", false);
+  CheckTotal(f, "x / d > 1", true);
+  CheckTotal(f, "n + d * 2 < 5 && x > 0.5", true);
+  CheckTotal(f, "rand() > 5", false);
+  CheckTotal(f, "int(x) > 0", false);
+  CheckTotal(f, "sum(v) > 2", true);
+
+  CheckCompiled("n + d * 2 - x");
+  CheckCompiled("n - d");
+  CheckCompiled("(n + 1) / (d + 1) % 3");
+  CheckCompiled("d != 0 && n / d > 1");
+  CheckCompiled("d == 0 || n % d == 1");
+  CheckCompiled("x > 0.5 || n == 2");
+  CheckCompiled("!(x < 0.3) && !n");
+  CheckCompiled("x && n");
+  CheckCompiled("(n & 3) | (d & 1)");
+  CheckCompiled("~n + ~int(x * 10)");
+  CheckCompiled("sin(x) + cos(x) * tan(x) - atan(x)");
+  CheckCompiled("sqrt(x) + log(x + 1) + exp(x) + abs(x - 0.5) + abs(n)");
+  CheckCompiled("asin(x) + acos(x) + log10(x + 1) + sinh(x) + cosh(x)");
+  CheckCompiled("tanh(n) + ceil(x * 10) + floor(x * 10)");
+  CheckCompiled("pow(x, 2) + pow(n, 3) + fmod(x, 0.3) + atan2(x, n)");
+  CheckCompiled("x ^ 2 + n ^ 2");
+  CheckCompiled("int(x * 10) - 5");
+  CheckCompiled("int(x * 10) - 5 < n");
+  CheckCompiled("int(x * 10) * 3 >= d - 2");
+  CheckCompiled("unsigned(x * 10) + int(n) - d");
+  CheckCompiled("double(n) / 3 != x");
+  CheckCompiled("isnan(x / d) + isinf(x / d) + isnan(n)");
+  CheckCompiled("d != 0 && sum(v) / d >= 1");
+  CheckCompiled("in(n, (1, 3)) || count(y) > 1");
+  CheckCompiled("sum(v) + 1");
+
+  // Left to the tree: leaves, reductions and vectors
+  CheckCompiled("x", false);
+  CheckCompiled("sum(v)", false);
+  CheckCompiled("v + 1", false);
+
+  // pow(x, 2) is x*x, but rand() must only be drawn once
+  Expression powRand("pow(rand(), 2)", f);
+  Check(powRand.GetOperation(powRand.GetHeadSymbol()) == POW,
+        "pow(rand(), 2) is not a square");
+  Expression powX("pow(x, 2)", f);
+  Check(powX.GetOperation(powX.GetHeadSymbol()) == MULTIPLICATION,
+        "pow(x, 2) is a square");
+
+  while (f.Read()) {
+
+    // Folded constants and identities give the unoptimized results
+    NumericalExpression<double> folded("2 * 3 + 1", f);
+    Check(folded.Evaluate() == 7., "2 * 3 + 1");
+
+    NumericalExpression<double> square("pow(x, 2)", f);
+    Check(square.Evaluate() == pow(*f.GetFloatingPointField("x"), 2),
+          "pow(x, 2)");
+
+    NumericalExpression<uint64_t> identity("n * 1 + 0 - 0", f);
+    Check(identity.Evaluate() == *f.GetUnsignedIntegerField("n"),
+          "n * 1 + 0 - 0");
+
+    NumericalExpression<double> division("x / 1.", f);
+    Check(division.Evaluate() == *f.GetFloatingPointField("x"), "x / 1.");
+
+    if (f.GetCurrentEventNumber() > 10) {
+      break;
+    }
+  }
+
+  f.Rewind();
+  CheckReductions(f);
+
+  f.Rewind();
+  CheckFileLists(f);
+
+  remove("expressiontest.xcd");
+  return nFailures == 0 ? 0 : 1;
+}
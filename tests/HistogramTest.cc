@@ -0,0 +1,373 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/Histogram.h>
+#include <xcdf/utility/HistogramFiller.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+/*
+ *  Check deferred-range histograms, merging of partial histograms,
+ *  threaded and multiple fills, and sparse N-dimensional histograms
+ */
+
+const char* fileName = "histogramtest.xcd";
+const unsigned nEvents = 20000;
+
+bool Same(const Histogram1D& a, const Histogram1D& b) {
+
+  if (a.GetNBins() != b.GetNBins() ||
+      a.GetMinimum() != b.GetMinimum() ||
+      a.GetMaximum() != b.GetMaximum() ||
+      a.GetNEntries() != b.GetNEntries() ||
+      a.GetUnderflow() != b.GetUnderflow() ||
+      a.GetOverflow() != b.GetOverflow()) {
+    return false;
+  }
+  for (unsigned i = 0; i < a.GetNBins(); ++i) {
+    if (a.GetData(i) != b.GetData(i) || a.GetW2Sum(i) != b.GetW2Sum(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Same(const Histogram2D& a, const Histogram2D& b) {
+
+  if (a.GetNBinsX() != b.GetNBinsX() ||
+      a.GetNBinsY() != b.GetNBinsY() ||
+      a.GetXMinimum() != b.GetXMinimum() ||
+      a.GetXMaximum() != b.GetXMaximum() ||
+      a.GetYMinimum() != b.GetYMinimum() ||
+      a.GetYMaximum() != b.GetYMaximum() ||
+      a.GetNEntries() != b.GetNEntries()) {
+    return false;
+  }
+  for (unsigned i = 0; i < a.GetNBins(); ++i) {
+    if (a.GetData(i) != b.GetData(i) || a.GetW2Sum(i) != b.GetW2Sum(i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int Check(bool ok, const std::string& what) {
+  if (!ok) {
+    std::cerr << "Failed: " << what << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+void WriteEvents() {
+
+  XCDFFile f(fileName, "w");
+  f.SetBlockSize(1000);
+  XCDFUnsignedIntegerField n = f.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField w = f.AllocateUnsignedIntegerField("w", 1);
+  XCDFFloatingPointField x = f.AllocateFloatingPointField("x", 0.);
+  XCDFFloatingPointField y = f.AllocateFloatingPointField("y", 0.);
+  XCDFFloatingPointField v = f.AllocateFloatingPointField("v", 0.01, "n");
+  for (unsigned i = 0; i < nEvents; ++i) {
+    n << i % 4;
+    w << i % 3 + 1;
+    x << std::fmod(i * 0.731, 50.) - 10.;
+    y << std::fmod(i * 0.377, 20.);
+    for (unsigned j = 0; j < i % 4; ++j) {
+      v << std::fmod((i + j) * 0.119, 5.);
+    }
+    f.Write();
+  }
+  f.Close();
+}
+
+// Values and weights to fill directly
+void GetValues(std::vector<double>& xs,
+               std::vector<double>& ys,
+               std::vector<double>& ws) {
+  for (unsigned i = 0; i < nEvents; ++i) {
+    xs.push_back(std::fmod(i * 0.731, 50.) - 10.);
+    ys.push_back(std::fmod(i * 0.377, 20.));
+    ws.push_back(i % 3 + 1);
+  }
+}
+
+int CheckDeferred() {
+
+  int fail = 0;
+  std::vector<double> xs, ys, ws;
+  GetValues(xs, ys, ws);
+
+  Histogram1D fixed(40, -5., 35.);
+  Histogram1D deferred(40);
+  Histogram2D fixed2(20, -5., 35., 10, 0., 20.);
+  Histogram2D deferred2(20, 10);
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    fixed.Fill(xs[i], ws[i]);
+    deferred.Fill(xs[i], ws[i]);
+    fixed2.Fill(xs[i], ys[i], ws[i]);
+    deferred2.Fill(xs[i], ys[i], ws[i]);
+  }
+  fail += Check(!deferred.IsRangeSet() && !deferred.HasDroppedFills(),
+                "1D fills kept before the range is set");
+  deferred.SetRange(-5., 35.);
+  deferred2.SetRange(-5., 35., 0., 20.);
+  fail += Check(Same(fixed, deferred), "1D deferred fill");
+  fail += Check(Same(fixed2, deferred2), "2D deferred fill");
+
+  // Two histograms sharing a budget too small for both.  The one that
+  // runs out drops its fills and returns its memory.  The budget is
+  // charged for the memory allocated, which doubles from 256 values.
+  XCDFPtr<DeferredFillBudget> budget =
+                 xcdf_shared(new DeferredFillBudget(5000 * sizeof(double)));
+  Histogram1D first(40, budget);
+  Histogram2D second(20, 10, budget);
+  for (unsigned i = 0; i < 1000; ++i) {
+    first.Fill(xs[i], ws[i]);
+  }
+  for (unsigned i = 0; i < 1000; ++i) {
+    second.Fill(xs[i], ys[i], ws[i]);
+  }
+  fail += Check(second.HasDroppedFills() && !first.HasDroppedFills(),
+                "shared budget exhausted by the 2D histogram");
+  fail += Check(budget->GetUsedBytes() == 2048 * sizeof(double),
+                "dropped fills returned to the budget");
+  for (unsigned i = 1000; i < 1500; ++i) {
+    first.Fill(xs[i], ws[i]);
+  }
+  fail += Check(!first.HasDroppedFills(),
+                "returned budget used by the other histogram");
+  first.SetRange(-5., 35.);
+  fail += Check(budget->GetUsedBytes() == 0,
+                "replayed fills returned to the budget");
+  Histogram1D firstFixed(40, -5., 35.);
+  for (unsigned i = 0; i < 1500; ++i) {
+    firstFixed.Fill(xs[i], ws[i]);
+  }
+  fail += Check(Same(first, firstFixed), "deferred fill with shared budget");
+
+  // A copy is charged for its own memory and returns only that
+  Histogram1D original(40, budget);
+  for (unsigned i = 0; i < 1000; ++i) {
+    original.Fill(xs[i], ws[i]);
+  }
+  Histogram1D copy(original);
+  fail += Check(budget->GetUsedBytes() == 4048 * sizeof(double),
+                "copy of deferred fills charged to the budget");
+  Histogram1D tooMany(original);
+  fail += Check(tooMany.HasDroppedFills() && !original.HasDroppedFills() &&
+                budget->GetUsedBytes() == 4048 * sizeof(double),
+                "copy beyond the budget drops its fills");
+  original.SetRange(-5., 35.);
+  copy.SetRange(-5., 35.);
+  fail += Check(budget->GetUsedBytes() == 0,
+                "copied fills returned to the budget once");
+  fail += Check(Same(original, copy), "deferred fill of a copy");
+
+  return fail;
+}
+
+int CheckFillers() {
+
+  int fail = 0;
+  std::vector<double> xs, ys, ws;
+  GetValues(xs, ys, ws);
+
+  Histogram1D direct(30, -10., 40.);
+  Histogram1D selected(30, -10., 40.);
+  Histogram2D direct2(25, -10., 40., 20, 0., 20.);
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    direct.Fill(xs[i], ws[i]);
+    if (i % 4 != 0 && ws[i] > 1.) {
+      selected.Fill(xs[i], ws[i]);
+    }
+    direct2.Fill(xs[i], ys[i], ws[i]);
+  }
+
+  // Parts filled separately add up to the whole
+  Histogram1D merged = direct.EmptyCopy();
+  Histogram1D part = direct.EmptyCopy();
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    part.Fill(xs[i], ws[i]);
+    if (i % 7000 == 6999 || i + 1 == xs.size()) {
+      merged.Add(part);
+      part = direct.EmptyCopy();
+    }
+  }
+  fail += Check(Same(direct, merged), "EmptyCopy and Add");
+
+  XCDFFile f(fileName, "r");
+  Filler1D fill1("x", "w");
+  Histogram1D serial = direct.EmptyCopy();
+  fill1.Fill(serial, f);
+  fail += Check(Same(direct, serial), "1D fill from file");
+
+  for (unsigned nThreads = 2; nThreads <= 5; ++nThreads) {
+    Histogram1D threaded = direct.EmptyCopy();
+    ThreadedFiller<Histogram1D, Filler1D> tf(fill1, nThreads);
+    f.Rewind();
+    tf.Fill(threaded, f);
+    fail += Check(Same(direct, threaded), "threaded 1D fill");
+
+    Filler2D fill2("x", "y", "w");
+    Histogram2D threaded2 = direct2.EmptyCopy();
+    ThreadedFiller<Histogram2D, Filler2D> tf2(fill2, nThreads);
+    f.Rewind();
+    tf2.Fill(threaded2, f);
+    fail += Check(Same(direct2, threaded2), "threaded 2D fill");
+  }
+
+  // Several histograms in one pass, with a guarded selection and
+  // deferred ranges
+  Histogram1D multi = direct.EmptyCopy();
+  Histogram1D multiSel = direct.EmptyCopy();
+  Histogram1D multiDeferred(30);
+  Histogram2D multi2(25, 20);
+  RangeChecker rc("x - 0");
+  RangeChecker rc2(std::vector<std::string>{"x", "y"});
+  MultiFiller mf;
+  mf.Add(multi, "x", "w");
+  mf.Add(multiSel, "x", "w", "n != 0 && w / n >= 0 && w > 1");
+  mf.Add(multiDeferred, "x", "w", "", &rc);
+  mf.Add(multi2, "x", "y", "w", "", &rc2);
+  f.Rewind();
+  mf.Fill(f);
+  fail += Check(Same(direct, multi), "multiple fill");
+  fail += Check(Same(selected, multiSel), "multiple fill with selection");
+
+  multiDeferred.SetRange(rc.GetMin(), rc.GetMax());
+  Histogram1D rangeFixed(30, rc.GetMin(), rc.GetMax());
+  Histogram2D range2Fixed(25, rc2.GetMin(0), rc2.GetMax(0),
+                          20, rc2.GetMin(1), rc2.GetMax(1));
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    rangeFixed.Fill(xs[i], ws[i]);
+    range2Fixed.Fill(xs[i], ys[i], ws[i]);
+  }
+  multi2.SetRange(rc2.GetMin(0), rc2.GetMax(0),
+                  rc2.GetMin(1), rc2.GetMax(1));
+  fail += Check(rc.GetMin() == -10. && rc.GetMax() > 39.9,
+                "range collected while filling");
+  fail += Check(Same(rangeFixed, multiDeferred),
+                "multiple fill with deferred range");
+  fail += Check(Same(range2Fixed, multi2),
+                "multiple 2D fill with deferred range");
+  return fail;
+}
+
+// NaN values are counted as underflow, whether filled one at a time,
+// in batches or after the range of a deferred histogram is set
+int CheckNaN() {
+
+  int fail = 0;
+  const double values[] = {1.5, NAN, -3., 12., NAN, 7.25};
+  const double weights[] = {1., 2., 3., 4., 5., 6.};
+  const unsigned n = 6;
+
+  Histogram1D single(10, 0., 10.);
+  Histogram1D batch(10, 0., 10.);
+  Histogram1D deferred(10);
+  for (unsigned i = 0; i < n; ++i) {
+    single.Fill(values[i], weights[i]);
+    deferred.Fill(values[i], weights[i]);
+  }
+  batch.Fill(values, weights, n);
+  deferred.SetRange(0., 10.);
+
+  fail += Check(single.GetUnderflow() == 10. &&
+                single.GetUnderflowW2Sum() == 38. &&
+                single.GetOverflow() == 4. &&
+                single.GetData(1) == 1. && single.GetData(7) == 6. &&
+                single.GetNEntries() == n, "NaN fill counted as underflow");
+  fail += Check(Same(single, batch), "NaN batched fill");
+  fail += Check(Same(single, deferred), "NaN deferred fill");
+  return fail;
+}
+
+int CheckSparse() {
+
+  int fail = 0;
+  std::vector<double> xs, ys, ws;
+  GetValues(xs, ys, ws);
+
+  std::vector<unsigned> nbins{1000000, 1000000, 4};
+  std::vector<double> mins{-10., 0., 0.};
+  std::vector<double> maxs{40., 20., 4.};
+  HistogramND h(nbins, mins, maxs);
+  Histogram1D hx(1000000, -10., 40.);
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    std::vector<double> values{xs[i], ys[i], double(i % 4)};
+    h.Fill(values, ws[i]);
+    hx.Fill(xs[i], ws[i]);
+  }
+  fail += Check(h.GetNFilledBins() <= nEvents && h.GetNFilledBins() > 0,
+                "sparse bins");
+  fail += Check(h.GetNEntries() == nEvents, "sparse entries");
+  fail += Check(Same(hx, h.Project(0)), "sparse projection to 1D");
+
+  // Split into two halves and merge
+  HistogramND a(nbins, mins, maxs);
+  HistogramND b(nbins, mins, maxs);
+  for (unsigned i = 0; i < xs.size(); ++i) {
+    std::vector<double> values{xs[i], ys[i], double(i % 4)};
+    (i < nEvents / 2 ? a : b).Fill(values, ws[i]);
+  }
+  a.Add(b);
+  fail += Check(a.GetFilledBins() == h.GetFilledBins(), "sparse merge bins");
+  std::vector<uint64_t> keys = h.GetFilledBins();
+  bool same = true;
+  for (unsigned i = 0; i < keys.size(); ++i) {
+    std::vector<unsigned> bins;
+    for (unsigned d = 0; d < 3; ++d) {
+      bins.push_back(h.GetBin(keys[i], d));
+    }
+    same &= a.GetData(bins) == h.GetData(bins);
+  }
+  fail += Check(same, "sparse merge contents");
+  return fail;
+}
+
+int main(int argc, char** argv) {
+
+  WriteEvents();
+
+  int fail = 0;
+  fail += CheckDeferred();
+  fail += CheckFillers();
+  fail += CheckNaN();
+  fail += CheckSparse();
+
+  std::remove(fileName);
+  if (fail > 0) {
+    std::cerr << fail << " checks failed" << std::endl;
+    return 1;
+  }
+  return 0;
+}
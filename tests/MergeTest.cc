@@ -0,0 +1,123 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/MergeReader.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ *  Merge three sorted files with MergeReader and check the key order,
+ *  the order of equal keys and the contents of every event
+ */
+
+const char* names[] = {"mergetest0.xcd", "mergetest1.xcd", "mergetest2.xcd"};
+const unsigned nFiles = 3;
+const unsigned nEvents = 30000;
+
+// File i holds the events with index % 3 == i, keyed by index / 2, so
+// that consecutive keys are shared between files
+void WriteFile(unsigned file) {
+
+  XCDFFile f(names[file], "w");
+  f.SetBlockSize(1000);
+  XCDFUnsignedIntegerField index = f.AllocateUnsignedIntegerField("index", 1);
+  XCDFUnsignedIntegerField key = f.AllocateUnsignedIntegerField("key", 1);
+  for (unsigned i = file; i < nEvents; i += nFiles) {
+    index << i;
+    key << i / 2;
+    f.Write();
+  }
+  f.Close();
+}
+
+int main(int argc, char** argv) {
+
+  std::vector<std::string> files;
+  for (unsigned i = 0; i < nFiles; ++i) {
+    WriteFile(i);
+    files.push_back(names[i]);
+  }
+
+  MergeReader<uint64_t> reader(files, "key");
+  unsigned count = 0;
+  uint64_t lastKey = 0;
+  unsigned lastFile = 0;
+  while (reader.Read()) {
+
+    unsigned file = reader.GetCurrentFileIndex();
+    XCDFFile& f = reader.GetCurrentFile();
+    uint64_t index = *f.GetUnsignedIntegerField("index");
+    uint64_t key = *f.GetUnsignedIntegerField("key");
+
+    if (index % nFiles != file || key != index / 2 ||
+        reader.GetCurrentKey() != key) {
+      std::cerr << "Event " << count << ": index " << index << " key " <<
+                   key << " read from file " << file << std::endl;
+      exit(1);
+    }
+
+    // Equal keys come from earlier files first
+    if (count > 0 && (key < lastKey ||
+                      (key == lastKey && file <= lastFile))) {
+      std::cerr << "Event " << count << " out of order" << std::endl;
+      exit(1);
+    }
+    lastKey = key;
+    lastFile = file;
+    ++count;
+  }
+
+  if (count != nEvents) {
+    std::cerr << "Merged " << count << " events, expected " <<
+                 nEvents << std::endl;
+    exit(1);
+  }
+
+  // An input that cannot be opened is reported by name
+  files.push_back("mergetest_missing.xcd");
+  bool reported = false;
+  try {
+    MergeReader<uint64_t> missing(files, "key");
+  } catch (const XCDFException& e) {
+    reported = e.GetMessage().find("mergetest_missing.xcd") !=
+                                                      std::string::npos;
+  }
+  if (!reported) {
+    std::cerr << "Missing input not reported" << std::endl;
+    exit(1);
+  }
+
+  for (unsigned i = 0; i < nFiles; ++i) {
+    remove(names[i]);
+  }
+  std::cout << "Success!" << std::endl;
+}
@@ -0,0 +1,150 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+
+#include <vector>
+#include <limits>
+#include <iostream>
+#include <cstdio>
+
+/*
+ *  Check that narrow views of fields read the static_cast of the
+ *  64-bit values, for scalar and vector fields and for values out of
+ *  range of the narrow type
+ */
+
+const unsigned nEvents = 3000;
+
+uint64_t UnsignedValue(unsigned i, unsigned j) {
+  // Spans the uint8_t and uint32_t ranges and beyond
+  return (static_cast<uint64_t>(i) * 2654435761u + j) << (i % 40);
+}
+
+int64_t SignedValue(unsigned i, unsigned j) {
+  int64_t v = static_cast<int64_t>(UnsignedValue(i, j) >> 1);
+  return (i + j) % 2 ? -v : v;
+}
+
+double FloatValue(unsigned i, unsigned j) {
+  // Values that are not exact as float, and some beyond its precision
+  // and below its smallest value
+  const double values[] = {0.1, -2.5e-50, 1e30, 16777217., -3.75};
+  return values[(i + j) % 5] * (i + 1);
+}
+
+template <typename S, typename T>
+bool Same(const XCDFNarrowField<S, T>& narrow, const XCDFField<T>& wide) {
+
+  if (narrow.GetSize() != wide.GetSize()) {
+    return false;
+  }
+  std::vector<S> copy;
+  narrow.CopyTo(copy);
+  if (copy.size() != wide.GetSize()) {
+    return false;
+  }
+  for (unsigned j = 0; j < wide.GetSize(); ++j) {
+    S expected = static_cast<S>(wide[j]);
+    if (narrow[j] != expected || narrow.At(j) != expected ||
+        copy[j] != expected) {
+      return false;
+    }
+  }
+  return wide.GetSize() == 0 || *narrow == static_cast<S>(*wide);
+}
+
+int main(int argc, char** argv) {
+
+  const char* name = "narrowfieldtest.xcd";
+
+  XCDFFile w(name, "w");
+  w.SetBlockSize(128);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField u = w.AllocateUnsignedIntegerField("u", 1);
+  XCDFSignedIntegerField s = w.AllocateSignedIntegerField("s", 1);
+  XCDFFloatingPointField x = w.AllocateFloatingPointField("x", 0.);
+  XCDFUnsignedIntegerField uv = w.AllocateUnsignedIntegerField("uv", 1, "n");
+  XCDFSignedIntegerField sv = w.AllocateSignedIntegerField("sv", 1, "n");
+  XCDFFloatingPointField xv = w.AllocateFloatingPointField("xv", 0., "n");
+
+  for (unsigned i = 0; i < nEvents; ++i) {
+    unsigned size = i % 7;
+    n << size;
+    u << UnsignedValue(i, 7);
+    s << SignedValue(i, 7);
+    x << FloatValue(i, 7);
+    for (unsigned j = 0; j < size; ++j) {
+      uv << UnsignedValue(i, j);
+      sv << SignedValue(i, j);
+      xv << FloatValue(i, j);
+    }
+    w.Write();
+  }
+  w.Close();
+
+  XCDFFile f(name, "r");
+  XCDFUnsignedIntegerField ru = f.GetUnsignedIntegerField("u");
+  XCDFSignedIntegerField rs = f.GetSignedIntegerField("s");
+  XCDFFloatingPointField rx = f.GetFloatingPointField("x");
+  XCDFUnsignedIntegerField ruv = f.GetUnsignedIntegerField("uv");
+  XCDFSignedIntegerField rsv = f.GetSignedIntegerField("sv");
+  XCDFFloatingPointField rxv = f.GetFloatingPointField("xv");
+
+  XCDFUInt32Field u32 = f.GetUInt32Field("u");
+  XCDFUInt8Field u8 = f.GetUInt8Field("u");
+  XCDFBoolField b = f.GetBoolField("u");
+  XCDFInt32Field s32 = f.GetInt32Field("s");
+  XCDFFloatField x32 = f.GetFloatField("x");
+  XCDFUInt32Field uv32 = f.GetUInt32Field("uv");
+  XCDFUInt8Field uv8 = f.GetUInt8Field("uv");
+  XCDFBoolField bv = f.GetBoolField("uv");
+  XCDFInt32Field sv32 = f.GetInt32Field("sv");
+  XCDFFloatField xv32 = f.GetFloatField("xv");
+
+  int fail = 0;
+  unsigned count = 0;
+  for (unsigned i = 0; f.Read(); ++i) {
+    bool ok = *ru == UnsignedValue(i, 7) && ruv.GetSize() == i % 7;
+    ok = ok && Same(u32, ru) && Same(u8, ru) && Same(b, ru) &&
+               Same(s32, rs) && Same(x32, rx) &&
+               Same(uv32, ruv) && Same(uv8, ruv) && Same(bv, ruv) &&
+               Same(sv32, rsv) && Same(xv32, rxv);
+    if (!ok) {
+      std::cerr << "Event " << i << " differs" << std::endl;
+      ++fail;
+    }
+    ++count;
+  }
+  if (count != nEvents) {
+    std::cerr << "Read " << count << " events" << std::endl;
+    ++fail;
+  }
+
+  std::remove(name);
+  return fail == 0 ? 0 : 1;
+}
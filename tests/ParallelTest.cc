@@ -0,0 +1,147 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+
+#include <string>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ *  Run "xcdf count -e" and the histogram verbs on one to eight threads,
+ *  and check that the output matches the serial run.  The inputs have
+ *  small blocks and event counts that are not multiples of the block
+ *  size, so the event ranges given to the threads end mid-block.  The
+ *  path to the xcdf utility is the first argument.
+ */
+
+const char* inputs[] = {"paralleltest1.xcd", "paralleltest2.xcd"};
+const unsigned nInputs = 2;
+const unsigned nEvents[] = {20011, 1237};
+
+int nFailures = 0;
+
+void WriteInput(unsigned file) {
+
+  XCDFFile w(inputs[file], "w");
+  w.SetBlockSize(97);
+  XCDFUnsignedIntegerField id = w.AllocateUnsignedIntegerField("id", 1);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFSignedIntegerField v = w.AllocateSignedIntegerField("v", 1, "n");
+  XCDFFloatingPointField x = w.AllocateFloatingPointField("x", 0.25);
+
+  for (unsigned i = 0; i < nEvents[file]; ++i) {
+    id << file * 100000 + i;
+    n << i % 5;
+    for (unsigned j = 0; j < i % 5; ++j) {
+      v << static_cast<int64_t>((i * j) % 41) - 20;
+    }
+    x << ((i * 104729) % 4000) * 0.25;
+    w.Write();
+  }
+  w.Close();
+}
+
+// Output of command, or an empty string if it fails
+std::string Run(const std::string& command) {
+
+  std::string out;
+  FILE* p = popen(command.c_str(), "r");
+  if (!p) {
+    std::cerr << "Failed: " << command << std::endl;
+    ++nFailures;
+    return out;
+  }
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), p)) > 0) {
+    out.append(buf, n);
+  }
+  if (pclose(p) != 0) {
+    std::cerr << "Failed: " << command << std::endl;
+    ++nFailures;
+    out.clear();
+  }
+  return out;
+}
+
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <xcdf utility>" << std::endl;
+    return 1;
+  }
+  const std::string xcdf(argv[1]);
+
+  std::string files;
+  for (unsigned file = 0; file < nInputs; ++file) {
+    WriteInput(file);
+    files += std::string(" ") + inputs[file];
+  }
+
+  // Weights are multiples of 1/4 so the sums do not depend on the order
+  // in which the threads' histograms are added
+  const char* commands[] = {
+    " count -e 'x > 300. && n != 3'",
+    " count -e 'id % 7 == 2'",
+    " count -e 'any(v > 10)'",
+    " histogram '40, 0, 1000, x'",
+    " histogram '33, 100, 900, x, n * 0.25'",
+    " histogram '25, x + v'",
+    " histogram2d '10, 0, 1000, x, 6, 0, 6, n, 0.5'",
+    " histogram2d '12, x, 9, v'"
+  };
+  const unsigned nCommands = 8;
+  const char* threads[] = {" -j 1", " -j 2", " -j 3", " -j 8"};
+  const unsigned nThreads = 4;
+
+  for (unsigned c = 0; c < nCommands; ++c) {
+
+    std::string verb(commands[c]);
+    size_t split = verb.find(' ', 1);
+    std::string serial = Run(xcdf + verb + files);
+    if (serial.empty()) {
+      continue;
+    }
+    for (unsigned t = 0; t < nThreads; ++t) {
+      std::string command = xcdf + verb.substr(0, split) + threads[t] +
+                            verb.substr(split) + files;
+      std::string parallel = Run(command);
+      if (parallel != serial) {
+        std::cerr << "Output differs from the serial run: " << command <<
+                     std::endl << serial << std::endl << parallel << std::endl;
+        ++nFailures;
+      }
+    }
+  }
+
+  for (unsigned file = 0; file < nInputs; ++file) {
+    std::remove(inputs[file]);
+  }
+  return nFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+
+#include <vector>
+#include <iostream>
+#include <cstdio>
+
+/*
+ *  Check the parent index of entries of nested vector fields against
+ *  a walk over the parent counts, across events and blocks, including
+ *  parent entries with no children
+ */
+
+const unsigned nEvents = 2500;
+
+// Number of children of parent entry j in event i, often zero
+unsigned ChildCount(unsigned i, unsigned j) {
+  return ((i + 3) * (j + 5)) % 4;
+}
+
+// Parent entry of each child entry, found by summing the parent counts
+std::vector<unsigned> WalkParents(const XCDFUnsignedIntegerField& counts) {
+  std::vector<unsigned> parents;
+  for (unsigned j = 0; j < counts.GetSize(); ++j) {
+    for (unsigned k = 0; k < counts[j]; ++k) {
+      parents.push_back(j);
+    }
+  }
+  return parents;
+}
+
+// Check every entry of field against the walk over its parent counts
+template <typename T>
+bool CheckParents(const XCDFField<T>& field,
+                  const XCDFUnsignedIntegerField& counts) {
+  std::vector<unsigned> parents = WalkParents(counts);
+  if (parents.size() != field.GetSize()) {
+    return false;
+  }
+  for (unsigned k = 0; k < parents.size(); ++k) {
+    if (field.GetParentIndex(k) != parents[k]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+
+  const char* name = "parentindextest.xcd";
+  int fail = 0;
+
+  XCDFFile w(name, "w");
+  w.SetBlockSize(64);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField a = w.AllocateUnsignedIntegerField("a", 1, "n");
+  XCDFFloatingPointField b = w.AllocateFloatingPointField("b", 0.5, "a");
+  XCDFSignedIntegerField c = w.AllocateSignedIntegerField("c", 1, "a");
+
+  for (unsigned i = 0; i < nEvents; ++i) {
+    unsigned size = i % 6;
+    n << size;
+    for (unsigned j = 0; j < size; ++j) {
+      a << ChildCount(i, j);
+    }
+    for (unsigned j = 0; j < size; ++j) {
+      for (unsigned k = 0; k < ChildCount(i, j); ++k) {
+        b << (i + j + k) * 0.5;
+        c << static_cast<int64_t>(k) - static_cast<int64_t>(j);
+      }
+
+      // Look up an entry before all entries are added: adding more
+      // must not leave a stale index
+      if (b.GetSize() > 0 && b.GetParentIndex(0) != WalkParents(a)[0]) {
+        std::cerr << "Event " << i << " has a wrong partial index" <<
+                                                            std::endl;
+        ++fail;
+      }
+    }
+    if (!CheckParents(b, a) || !CheckParents(c, a)) {
+      std::cerr << "Written event " << i << " has wrong parents" << std::endl;
+      ++fail;
+    }
+    w.Write();
+  }
+  w.Close();
+
+  XCDFFile f(name, "r");
+  XCDFUnsignedIntegerField ra = f.GetUnsignedIntegerField("a");
+  XCDFFloatingPointField rb = f.GetFloatingPointField("b");
+  XCDFSignedIntegerField rc = f.GetSignedIntegerField("c");
+  unsigned count = 0;
+  for (unsigned i = 0; f.Read(); ++i) {
+
+    // Entries of a all belong to the single entry of n
+    bool ok = ra.GetSize() == i % 6;
+    for (unsigned j = 0; ok && j < ra.GetSize(); ++j) {
+      ok = ra.GetParentIndex(j) == 0 && ra[j] == ChildCount(i, j);
+    }
+
+    // Check c before b in every other event, so each starts from an
+    // index left by a previous event
+    if (i % 2) {
+      ok = ok && CheckParents(rc, ra) && CheckParents(rb, ra);
+    } else {
+      ok = ok && CheckParents(rb, ra) && CheckParents(rc, ra);
+    }
+    if (!ok) {
+      std::cerr << "Event " << i << " has wrong parents" << std::endl;
+      ++fail;
+    }
+    ++count;
+  }
+  if (count != nEvents) {
+    std::cerr << "Read " << count << " events" << std::endl;
+    ++fail;
+  }
+
+  // Seek back into an earlier block: the index must follow the new event
+  f.Seek(nEvents / 3);
+  if (!CheckParents(rb, ra) || !CheckParents(rc, ra)) {
+    std::cerr << "Event after seek has wrong parents" << std::endl;
+    ++fail;
+  }
+
+  std::remove(name);
+  return fail == 0 ? 0 : 1;
+}
@@ -0,0 +1,240 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/XCDFUtility.h>
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+/*
+ *  Check the text parsing of "xcdf paste": number formats, vector
+ *  entries, input spanning several chunks parsed on one or more threads,
+ *  and errors reported at the offending line
+ */
+
+const char* name = "pastetest.xcd";
+const std::string header = "n/U/1,v[n]/U/1,s/I/1,x/F/0\n";
+
+int nFailures = 0;
+
+void Check(bool pass, const std::string& what) {
+  if (!pass) {
+    std::cerr << "Failed: " << what << std::endl;
+    ++nFailures;
+  }
+}
+
+struct Event {
+  std::vector<uint64_t> v_;
+  int64_t s_;
+  double x_;
+};
+
+bool Same(double a, double b) {
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/*
+ *  Paste the text into a file and read the events back.  Returns the
+ *  number of events copied before an error, or -1 without error.
+ */
+int64_t Paste(const std::string& text, unsigned nThreads,
+              std::vector<Event>& events, std::string& error) {
+
+  int64_t nCopied = -1;
+  {
+    XCDFFile w(name, "w");
+    std::istringstream in(text);
+    CSVInputHandler handler(w, in, nThreads);
+    uint64_t n = 0;
+    try {
+      while (handler.CopyLine()) {
+        w.Write();
+        ++n;
+      }
+    } catch (const XCDFException& e) {
+      error = e.GetMessage();
+      nCopied = n;
+    }
+    w.Close();
+  }
+
+  events.clear();
+  XCDFFile f(name, "r");
+  XCDFUnsignedIntegerField v = f.GetUnsignedIntegerField("v");
+  XCDFSignedIntegerField s = f.GetSignedIntegerField("s");
+  XCDFFloatingPointField x = f.GetFloatingPointField("x");
+  while (f.Read()) {
+    Event e;
+    e.v_.assign(v.Begin(), v.End());
+    e.s_ = *s;
+    e.x_ = *x;
+    events.push_back(e);
+  }
+  std::remove(name);
+  return nCopied;
+}
+
+void CheckEvent(const std::vector<Event>& events, unsigned i,
+                const std::vector<uint64_t>& v, int64_t s, double x) {
+  std::ostringstream what;
+  what << "event " << i;
+  Check(i < events.size() && events[i].v_ == v &&
+        events[i].s_ == s && Same(events[i].x_, x), what.str());
+}
+
+std::vector<uint64_t> Values(uint64_t a) {return std::vector<uint64_t>(1, a);}
+
+void CheckFormats() {
+
+  std::string text = header +
+    "3,1:2:3,-5,1.5\n"
+    "0,,0,-0\n"
+    "2,7:8:,9223372036854775807,1e-3\n"
+    "1,18446744073709551615,-9223372036854775808,inf\n"
+    "1, 42,+7,-inf\n"
+    "1,123456789012345678, -3, 2.5 \n"
+    "1,5,1,0x10\n"
+    "1,18446744073709551616,-9223372036854775809,1\n"
+    "1,6,2,3";
+
+  for (unsigned nThreads = 1; nThreads <= 2; ++nThreads) {
+
+    std::vector<Event> events;
+    std::string error;
+    Check(Paste(text, nThreads, events, error) < 0, "formats parse");
+
+    std::vector<uint64_t> v123;
+    v123.push_back(1);
+    v123.push_back(2);
+    v123.push_back(3);
+    std::vector<uint64_t> v78;
+    v78.push_back(7);
+    v78.push_back(8);
+
+    // The last line has no newline and is not an event
+    Check(events.size() == 8, "number of events");
+    CheckEvent(events, 0, v123, -5, 1.5);
+    CheckEvent(events, 1, std::vector<uint64_t>(), 0, -0.);
+    CheckEvent(events, 2, v78, std::numeric_limits<int64_t>::max(), 1e-3);
+    CheckEvent(events, 3, Values(std::numeric_limits<uint64_t>::max()),
+               std::numeric_limits<int64_t>::min(), INFINITY);
+    CheckEvent(events, 4, Values(42), 7, -INFINITY);
+    CheckEvent(events, 5, Values(123456789012345678ULL), -3, 2.5);
+    CheckEvent(events, 6, Values(5), 1, 16.);
+
+    // Out of range integers give what sscanf gives
+    unsigned long long u;
+    long long i;
+    sscanf("18446744073709551616", "%llu", &u);
+    sscanf("-9223372036854775809", "%lld", &i);
+    CheckEvent(events, 7, Values(u), i, 1.);
+  }
+}
+
+// Input of several chunks, with values that round-trip through the text
+void CheckChunks() {
+
+  const unsigned nLines = 300000;
+  std::string text = header;
+  std::vector<Event> expected(nLines);
+  char line[256];
+  for (unsigned i = 0; i < nLines; ++i) {
+    Event& e = expected[i];
+    std::string v;
+    for (unsigned j = 0; j < i % 4; ++j) {
+      e.v_.push_back(static_cast<uint64_t>(i) * 1000003 * (j + 1));
+      snprintf(line, sizeof(line), "%s%llu", j > 0 ? ":" : "",
+               static_cast<unsigned long long>(e.v_.back()));
+      v += line;
+    }
+    e.s_ = static_cast<int64_t>((i * 2654435761ULL) % 2000001) - 1000000;
+    e.x_ = std::sin(i) * std::pow(10., static_cast<int>(i % 21) - 10);
+    snprintf(line, sizeof(line), "%u,%s,%lld,%.17g\n", i % 4, v.c_str(),
+             static_cast<long long>(e.s_), e.x_);
+    text += line;
+  }
+
+  for (unsigned nThreads = 1; nThreads <= 4; nThreads += 3) {
+    std::vector<Event> events;
+    std::string error;
+    Check(Paste(text, nThreads, events, error) < 0, "chunks parse");
+    Check(events.size() == nLines, "number of chunked events");
+    bool ok = events.size() == nLines;
+    for (unsigned i = 0; ok && i < nLines; ++i) {
+      ok = events[i].v_ == expected[i].v_ &&
+           events[i].s_ == expected[i].s_ &&
+           Same(events[i].x_, expected[i].x_);
+      if (!ok) {
+        std::cerr << "Chunked event " << i << " differs" << std::endl;
+      }
+    }
+    Check(ok, "chunked events");
+  }
+}
+
+// Events before a bad line are written, and the line is reported
+void CheckErrors() {
+
+  // Enough lines that the bad one is in the second chunk
+  const unsigned nGood = 500000;
+  std::string good = header;
+  for (unsigned i = 0; i < nGood; ++i) {
+    good += "1,1,-1,0.5\n";
+  }
+
+  const char* bad[] = {"1,1,-1\n", "1,x,-1,0.5\n", "1,1,-1,abc\n"};
+  const char* messages[] = {"Expected 4 entries in line 1,1,-1",
+                            "Bad input string: x",
+                            "Bad input string: abc"};
+  for (unsigned k = 0; k < 3; ++k) {
+    for (unsigned nThreads = 1; nThreads <= 4; nThreads += 3) {
+      std::vector<Event> events;
+      std::string error;
+      int64_t nCopied = Paste(good + bad[k] + "1,1,-1,0.5\n",
+                              nThreads, events, error);
+      Check(nCopied == nGood, std::string("events before ") + bad[k]);
+      Check(error.find(messages[k]) != std::string::npos,
+            std::string("message for ") + bad[k]);
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+
+  CheckFormats();
+  CheckChunks();
+  CheckErrors();
+  return nFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDFQuantize.h>
+
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+
+/*
+ *  Check the block-close range and quantization kernels against the
+ *  per-value min/max checks and the per-value quantization they replace.
+ *  The kernels must give identical results so that written files do not
+ *  change.
+ */
+
+// Compared bit for bit, so NaN matches NaN and -0 differs from 0
+template <typename T>
+void Expect(const char* what, T expected, T got, unsigned n) {
+
+  if (memcmp(&expected, &got, sizeof(T)) != 0) {
+    std::cerr << what << ": Expected: " << expected << " Got: " << got <<
+                 ".  Size: " << n << std::endl;
+    exit(1);
+  }
+}
+
+// The per-value check applied by XCDFFieldData::Add before block close
+template <typename T, typename Operator>
+void ReferenceCheck(const T value, T& target, bool& set, Operator op) {
+  if (op(value, target) || !set) {
+    target = value;
+  }
+  set = true;
+  if (std::isnan(static_cast<double>(value))) {
+    target = value;
+  }
+}
+
+template <typename T>
+void CheckRange(const std::vector<T>& data, const char* what) {
+
+  T min = 0;
+  T max = 0;
+  bool minSet = false;
+  bool maxSet = false;
+  for (unsigned i = 0; i < data.size(); ++i) {
+    ReferenceCheck(data[i], min, minSet, std::less<T>());
+    ReferenceCheck(data[i], max, maxSet, std::greater<T>());
+  }
+
+  T kernelMin;
+  T kernelMax;
+  XCDFRange(&data[0], data.size(), kernelMin, kernelMax);
+  Expect(what, min, kernelMin, data.size());
+  Expect(what, max, kernelMax, data.size());
+}
+
+template <typename T>
+void CheckQuantize(const std::vector<T>& data,
+                   T min, T resolution, const char* what) {
+
+  std::vector<uint64_t> out(data.size());
+  XCDFQuantize(&data[0], data.size(), min, resolution, 40, &out[0]);
+  for (unsigned i = 0; i < data.size(); ++i) {
+    Expect(what, static_cast<uint64_t>((data[i] - min) / resolution),
+           out[i], data.size());
+  }
+}
+
+void CheckQuantize(const std::vector<double>& data,
+                   double min, double resolution, const char* what) {
+
+  std::vector<uint64_t> out(data.size());
+  XCDFQuantize(&data[0], data.size(), min, resolution, 40, &out[0]);
+  for (unsigned i = 0; i < data.size(); ++i) {
+    double interval = (data[i] - min) / resolution + 0.5;
+    Expect(what, static_cast<uint64_t>(interval), out[i], data.size());
+  }
+
+  // Full 64-bit values are written as they are
+  XCDFQuantize(&data[0], data.size(), min, resolution, 64, &out[0]);
+  for (unsigned i = 0; i < data.size(); ++i) {
+    Expect("double, 64 bits", XCDFSafeTypePun<double, uint64_t>(data[i]),
+           out[i], data.size());
+  }
+}
+
+int main(int argc, char** argv) {
+
+  const unsigned sizes[] = {1, 3, 4, 5, 8, 13, 1000};
+  const double resolutions[] = {0.1, 0.25, 0.5, 1., 3., 1. / 1024, 1e-3};
+  const uint64_t unsignedResolutions[] = {1, 2, 3, 4, 10, 1024};
+  const int64_t signedResolutions[] = {1, 2, 3, 7};
+  std::mt19937_64 rng(2468);
+
+  for (unsigned k = 0; k < sizeof(sizes) / sizeof(sizes[0]); ++k) {
+
+    unsigned n = sizes[k];
+    for (unsigned r = 0; r < sizeof(resolutions) / sizeof(double); ++r) {
+
+      double resolution = resolutions[r];
+      std::vector<double> data(n);
+      for (unsigned i = 0; i < n; ++i) {
+        data[i] = -50. + resolution * (rng() % 100000) +
+                  resolution * ((rng() % 1000) / 1000. - 0.5);
+        // Halfway between two steps, where rounding is decided
+        if (i % 3 == 0) {
+          data[i] = -50. + resolution * (rng() % 100000 + 0.5);
+        }
+      }
+      CheckRange(data, "double range");
+      double min;
+      double max;
+      XCDFRange(&data[0], n, min, max);
+      CheckQuantize(data, min, resolution, "double quantize");
+
+      // Zero alignment can put the min above the smallest value
+      double aligned = resolution * std::floor(min / resolution + 0.5);
+      CheckQuantize(data, aligned, resolution, "aligned double quantize");
+    }
+
+    // Signed zeros: the first zero seen is kept as the min and max
+    std::vector<double> zeros(n);
+    for (unsigned i = 0; i < n; ++i) {
+      zeros[i] = (rng() % 2) ? -0. : 0.;
+    }
+    CheckRange(zeros, "signed zero range");
+    for (unsigned i = 0; i < n; ++i) {
+      zeros[i] = (rng() % 3) ? ((rng() % 2) ? -0. : 0.) : 1.5;
+    }
+    CheckRange(zeros, "signed zero and positive range");
+
+    // A NaN anywhere makes the range NaN; inf is an ordinary value
+    for (unsigned p = 0; p < n; p += 1 + n / 7) {
+      std::vector<double> special(n);
+      for (unsigned i = 0; i < n; ++i) {
+        special[i] = (rng() % 1000) * 0.1;
+      }
+      special[p] = NAN;
+      CheckRange(special, "range with NaN");
+      special[p] = INFINITY;
+      CheckRange(special, "range with inf");
+      special[p] = -INFINITY;
+      CheckRange(special, "range with -inf");
+    }
+
+    for (unsigned r = 0; r < sizeof(unsignedResolutions) /
+                             sizeof(uint64_t); ++r) {
+      uint64_t resolution = unsignedResolutions[r];
+      std::vector<uint64_t> data(n);
+      for (unsigned i = 0; i < n; ++i) {
+        data[i] = 1000000 + (rng() >> (rng() % 40 + 20));
+      }
+      CheckRange(data, "unsigned range");
+      uint64_t min;
+      uint64_t max;
+      XCDFRange(&data[0], n, min, max);
+      CheckQuantize(data, min, resolution, "unsigned quantize");
+    }
+
+    for (unsigned r = 0; r < sizeof(signedResolutions) / sizeof(int64_t); ++r) {
+      int64_t resolution = signedResolutions[r];
+      std::vector<int64_t> data(n);
+      for (unsigned i = 0; i < n; ++i) {
+        data[i] = static_cast<int64_t>(rng() % 2000000) - 1000000;
+      }
+      CheckRange(data, "signed range");
+      int64_t min;
+      int64_t max;
+      XCDFRange(&data[0], n, min, max);
+      CheckQuantize(data, min, resolution, "signed quantize");
+    }
+  }
+
+  std::cout << "Success!" << std::endl;
+}
@@ -0,0 +1,176 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include <xcdf/XCDF.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+
+/*
+ *  Run "xcdf select" and "xcdf select-fields" serially and on several
+ *  threads, and check that every run writes the same events in input
+ *  order.  The path to the xcdf utility is the first argument.
+ */
+
+const char* inputs[] = {"selecttest1.xcd", "selecttest2.xcd",
+                        "selecttest3.xcd"};
+const unsigned nInputs = 3;
+const unsigned nEvents[] = {20000, 300, 5000};
+
+int nFailures = 0;
+
+void WriteInput(unsigned file) {
+
+  XCDFFile w(inputs[file], "w");
+  w.SetBlockSize(250);
+  XCDFUnsignedIntegerField id = w.AllocateUnsignedIntegerField("id", 1);
+  XCDFUnsignedIntegerField n = w.AllocateUnsignedIntegerField("n", 1);
+  XCDFUnsignedIntegerField v = w.AllocateUnsignedIntegerField("v", 1, "n");
+  XCDFFloatingPointField x = w.AllocateFloatingPointField("x", 0.5);
+  XCDFSignedIntegerField s = w.AllocateSignedIntegerField("s", 1);
+
+  for (unsigned i = 0; i < nEvents[file]; ++i) {
+    id << file * 100000 + i;
+    n << i % 4;
+    for (unsigned j = 0; j < i % 4; ++j) {
+      v << i * j;
+    }
+    x << ((i * 7919) % 1000) * 0.5;
+    s << static_cast<int64_t>(i % 17) - 8;
+    w.Write();
+  }
+  w.Close();
+}
+
+bool Run(const std::string& command) {
+  if (std::system(command.c_str()) != 0) {
+    std::cerr << "Failed: " << command << std::endl;
+    ++nFailures;
+    return false;
+  }
+  return true;
+}
+
+// Event ids passing the selection, in input order
+std::vector<uint64_t> ExpectedIds() {
+
+  std::vector<uint64_t> ids;
+  for (unsigned file = 0; file < nInputs; ++file) {
+    for (unsigned i = 0; i < nEvents[file]; ++i) {
+      double x = ((i * 7919) % 1000) * 0.5;
+      if (x > 150. && i % 4 != 2) {
+        ids.push_back(file * 100000 + i);
+      }
+    }
+  }
+  return ids;
+}
+
+// Check the output events against their input events
+void CheckOutput(const std::string& name,
+                 const std::vector<uint64_t>& ids, bool allFields) {
+
+  XCDFFile f(name.c_str(), "r");
+  XCDFUnsignedIntegerField id = f.GetUnsignedIntegerField("id");
+  XCDFUnsignedIntegerField n = f.GetUnsignedIntegerField("n");
+  XCDFUnsignedIntegerField v = f.GetUnsignedIntegerField("v");
+  XCDFFloatingPointField x = f.GetFloatingPointField("x");
+  if (f.HasField("s") != allFields) {
+    std::cerr << name << ": unexpected fields" << std::endl;
+    ++nFailures;
+  }
+
+  unsigned e = 0;
+  for (; f.Read(); ++e) {
+    if (e >= ids.size() || *id != ids[e]) {
+      std::cerr << name << ": event " << e << " is out of order" << std::endl;
+      ++nFailures;
+      return;
+    }
+    uint64_t i = ids[e] % 100000;
+    bool ok = *n == i % 4 && v.GetSize() == i % 4 &&
+              *x == ((i * 7919) % 1000) * 0.5;
+    for (unsigned j = 0; ok && j < v.GetSize(); ++j) {
+      ok = v[j] == i * j;
+    }
+    if (!ok) {
+      std::cerr << name << ": event " << e << " differs" << std::endl;
+      ++nFailures;
+    }
+  }
+  if (e != ids.size()) {
+    std::cerr << name << ": " << e << " events, expected "
+              << ids.size() << std::endl;
+    ++nFailures;
+  }
+}
+
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <xcdf utility>" << std::endl;
+    return 1;
+  }
+  const std::string xcdf(argv[1]);
+
+  std::string files;
+  for (unsigned file = 0; file < nInputs; ++file) {
+    WriteInput(file);
+    files += std::string(" ") + inputs[file];
+  }
+
+  std::vector<uint64_t> selected = ExpectedIds();
+  std::vector<uint64_t> all;
+  for (unsigned file = 0; file < nInputs; ++file) {
+    for (unsigned i = 0; i < nEvents[file]; ++i) {
+      all.push_back(file * 100000 + i);
+    }
+  }
+
+  const char* threads[] = {"", " -j 1", " -j 2", " -j 3", " -j 8"};
+  for (unsigned t = 0; t < 5; ++t) {
+
+    std::string out = "selecttest_out.xcd";
+    if (Run(xcdf + " select" + threads[t] +
+            " 'x > 150. && n != 2' -o " + out + files)) {
+      CheckOutput(out, selected, true);
+    }
+    if (Run(xcdf + " select-fields" + threads[t] +
+            " 'id,n,v,x' -o " + out + files)) {
+      CheckOutput(out, all, false);
+    }
+    std::remove(out.c_str());
+  }
+
+  for (unsigned file = 0; file < nInputs; ++file) {
+    std::remove(inputs[file]);
+  }
+  return nFailures == 0 ? 0 : 1;
+}
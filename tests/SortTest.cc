@@ -0,0 +1,191 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/XCDF.h>
+#include <xcdf/utility/EventSorter.h>
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+
+/*
+ *  Check the external sort of a file larger than the memory limit
+ */
+
+const unsigned nEvents = 100000;
+
+void WriteEvents(const char* name) {
+
+  XCDFFile f(name, "w");
+  XCDFUnsignedIntegerField index = f.AllocateUnsignedIntegerField("index", 1);
+  XCDFUnsignedIntegerField key = f.AllocateUnsignedIntegerField("key", 1);
+  XCDFUnsignedIntegerField n = f.AllocateUnsignedIntegerField("n", 1);
+  XCDFFloatingPointField v = f.AllocateFloatingPointField("v", 0.1, "n");
+  XCDFFloatingPointField x = f.AllocateFloatingPointField("x", 0.01);
+  for (unsigned i = 0; i < nEvents; ++i) {
+    index << i;
+    key << (i * 7919) % 1000;
+    n << i % 4;
+    // Blocks containing NaN store unrounded values
+    x << (i % 5003 == 0 ? NAN : i * 0.001234567);
+    for (unsigned j = 0; j < i % 4; ++j) {
+      v << i + j;
+    }
+    f.Write();
+  }
+  f.Close();
+}
+
+// Events must be in key order, keeping input order for equal keys.
+// Returns the number of events.
+uint64_t CheckOrder(XCDFFile& f, const std::string& what) {
+
+  XCDFUnsignedIntegerField index = f.GetUnsignedIntegerField("index");
+  XCDFUnsignedIntegerField key = f.GetUnsignedIntegerField("key");
+  XCDFFloatingPointField v = f.GetFloatingPointField("v");
+  uint64_t count = 0;
+  uint64_t lastKey = 0;
+  uint64_t lastIndex = 0;
+  while (f.Read()) {
+    if (count > 0 && (*key < lastKey ||
+                      (*key == lastKey && *index <= lastIndex))) {
+      std::cerr << what << ": event " << count << " out of order" <<
+                                                               std::endl;
+      return 0;
+    }
+    if (v.GetSize() != *index % 4 ||
+        (v.GetSize() > 0 && v[0] != static_cast<double>(*index))) {
+      std::cerr << what << ": event " << count << " has wrong values" <<
+                                                               std::endl;
+      return 0;
+    }
+    lastKey = *key;
+    lastIndex = *index;
+    ++count;
+  }
+  return count;
+}
+
+int main(int argc, char** argv) {
+
+  int status = 0;
+
+  // Sort with a memory limit far below the size of the data
+  WriteEvents("sorttest_in.xcd");
+  {
+    XCDFFile in("sorttest_in.xcd", "r");
+    XCDFFile out("sorttest_out.xcd", "w");
+    EventSorter<uint64_t> sorter(out, "key", 1 << 20);
+    sorter.Add(in);
+    sorter.Finish();
+    out.Close();
+
+    // About 5 MB of events, so several runs of about 1 MB each
+    unsigned nRuns = sorter.GetNRuns();
+    if (nRuns < 2 || nRuns > 16) {
+      std::cerr << "Sort wrote " << nRuns << " runs" << std::endl;
+      status = 1;
+    }
+  }
+  {
+    XCDFFile out("sorttest_out.xcd", "r");
+    uint64_t count = CheckOrder(out, "sort");
+    if (count != nEvents) {
+      std::cerr << "Sort output has " << count << " events" << std::endl;
+      status = 1;
+    }
+  }
+
+  // Values are rounded to the field resolution only once, so spilling
+  // to runs gives the same output as sorting in memory
+  {
+    XCDFFile in("sorttest_in.xcd", "r");
+    XCDFFile out("sorttest_mem.xcd", "w");
+    EventSorter<uint64_t> sorter(out, "key", 1 << 30);
+    sorter.Add(in);
+    sorter.Finish();
+    out.Close();
+  }
+  {
+    XCDFFile mem("sorttest_mem.xcd", "r");
+    XCDFFile out("sorttest_out.xcd", "r");
+    XCDFFloatingPointField xMem = mem.GetFloatingPointField("x");
+    XCDFFloatingPointField xOut = out.GetFloatingPointField("x");
+    while (mem.Read() && out.Read()) {
+      if (*xMem != *xOut && !(std::isnan(*xMem) && std::isnan(*xOut))) {
+        std::cerr << "Sorted x differs: " << *xMem << " " << *xOut <<
+                                                              std::endl;
+        status = 1;
+        break;
+      }
+    }
+  }
+
+  // Merge at most three runs at once, in several passes
+  {
+    XCDFFile in("sorttest_in.xcd", "r");
+    XCDFFile out("sorttest_out.xcd", "w");
+    EventSorter<uint64_t> sorter(out, "key", 1 << 18, 3);
+    sorter.Add(in);
+    sorter.Finish();
+    out.Close();
+
+    if (sorter.GetNRuns() < 10) {
+      std::cerr << "Sort wrote " << sorter.GetNRuns() << " runs" << std::endl;
+      status = 1;
+    }
+  }
+  {
+    XCDFFile out("sorttest_out.xcd", "r");
+    uint64_t count = CheckOrder(out, "multi-pass sort");
+    if (count != nEvents) {
+      std::cerr << "Multi-pass sort output has " << count << " events" <<
+                                                                 std::endl;
+      status = 1;
+    }
+  }
+  {
+    XCDFFile mem("sorttest_mem.xcd", "r");
+    XCDFFile out("sorttest_out.xcd", "r");
+    XCDFFloatingPointField xMem = mem.GetFloatingPointField("x");
+    XCDFFloatingPointField xOut = out.GetFloatingPointField("x");
+    while (mem.Read() && out.Read()) {
+      if (*xMem != *xOut && !(std::isnan(*xMem) && std::isnan(*xOut))) {
+        std::cerr << "Multi-pass sorted x differs: " << *xMem << " " <<
+                                                      *xOut << std::endl;
+        status = 1;
+        break;
+      }
+    }
+  }
+
+  remove("sorttest_in.xcd");
+  remove("sorttest_out.xcd");
+  remove("sorttest_mem.xcd");
+  return status;
+}
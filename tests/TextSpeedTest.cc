@@ -0,0 +1,127 @@
+
+/*
+Copyright (c) 2014, J. Braun
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <xcdf/utility/TextBuffer.h>
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iostream>
+#include <limits>
+#include <cmath>
+
+#include <sys/time.h>
+
+/*
+ *  Compare the text formatting of csv/dump (TextBuffer) with
+ *  std::ostream: the output must be identical, and the time taken by
+ *  each is printed
+ */
+
+double Now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec / 1000000.;
+}
+
+// Values like those of typical fields: counters, small signed
+// integers, quantized and unquantized floating point values
+void GetValues(std::vector<uint64_t>& us,
+               std::vector<int64_t>& ss,
+               std::vector<double>& ds) {
+
+  for (unsigned k = 0; k < 1000000; ++k) {
+    us.push_back(k * 2654435761ULL % 100000007ULL);
+    ss.push_back(static_cast<int64_t>(k % 2001) - 1000);
+    switch (k % 8) {
+      case 0: ds.push_back(k * 0.1); break;
+      case 1: ds.push_back(-1.25 * k); break;
+      case 2: ds.push_back(std::sqrt(k + 0.5)); break;
+      case 3: ds.push_back(k * 1e-9); break;
+      case 4: ds.push_back(std::exp(k % 700)); break;
+      case 5: ds.push_back(k % 64 == 5 ? -0. : k); break;
+      case 6: ds.push_back(k % 128 == 6 ?
+                           std::numeric_limits<double>::infinity() :
+                           1. / (k + 1)); break;
+      default: ds.push_back(std::nan("")); break;
+    }
+  }
+}
+
+int Compare(int precision,
+            const std::vector<uint64_t>& us,
+            const std::vector<int64_t>& ss,
+            const std::vector<double>& ds) {
+
+  double start = Now();
+  std::ostringstream os;
+  os.precision(precision);
+  for (unsigned k = 0; k < ds.size(); ++k) {
+    os << us[k] << "," << ss[k] << "," << ds[k] << "\n";
+  }
+  std::string streamText = os.str();
+  double streamTime = Now() - start;
+
+  start = Now();
+  TextBuffer buf(precision);
+  for (unsigned k = 0; k < ds.size(); ++k) {
+    buf.Append(us[k]);
+    buf.Append(',');
+    buf.Append(ss[k]);
+    buf.Append(',');
+    buf.Append(ds[k]);
+    buf.Append('\n');
+  }
+  double bufferTime = Now() - start;
+
+  double mb = streamText.size() / 1e6;
+  std::cout << "Precision " << precision << ", " << mb << " MB: "
+            << "ostream " << streamTime << " s ("
+            << mb / streamTime << " MB/s), "
+            << "TextBuffer " << bufferTime << " s ("
+            << mb / bufferTime << " MB/s)" << std::endl;
+
+  if (buf.GetString() != streamText) {
+    std::cerr << "Formatted text differs at precision "
+              << precision << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+
+  std::vector<uint64_t> us;
+  std::vector<int64_t> ss;
+  std::vector<double> ds;
+  GetValues(us, ss, ds);
+
+  // The precisions of csv and dump
+  int fail = 0;
+  fail += Compare(15, us, ss, ds);
+  fail += Compare(10, us, ss, ds);
+  return fail == 0 ? 0 : 1;
+}
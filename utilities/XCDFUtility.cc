@@ -3,11 +3,15 @@
 #include <xcdf/utility/EventSelectExpression.h>
 #include <xcdf/utility/HistogramFiller.h>
 #include <xcdf/utility/Histogram.h>
+#include <xcdf/utility/ParallelReduce.h>
+#include <xcdf/utility/MergeReader.h>
+#include <xcdf/utility/EventSorter.h>
 #include <xcdf/XCDFDefs.h>
 #include <xcdf/version.h>
 
 #include <set>
 #include <sstream>
+#include <cstdlib>
 
 void Info(std::vector<std::string>& infiles) {
 
@@ -171,9 +175,18 @@ void Info(std::vector<std::string>& infiles) {
   }
 }
 
+// Formatted text is written out in chunks of about this many bytes
+const size_t TEXT_WRITE_SIZE = 1 << 20;
+
+// Events per work unit when exporting text or copying events on
+// several threads, bounding the memory held by units waiting to be written
+const uint64_t TEXT_UNIT_EVENTS = 1 << 16;
+
 void Dump(std::vector<std::string>& infiles) {
 
   uint64_t count = 0;
+  TextBuffer buf(10);
+  DumpFieldVisitor dumpFieldVisitor(buf);
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
@@ -188,17 +201,25 @@ void Dump(std::vector<std::string>& infiles) {
       f.Open(infiles[i], "r");
     }
 
-    while (f.Read()) {
+    try {
+      while (f.Read()) {
 
-      std::cout << "Event: " << count << std::endl;
-      count++;
-      std::cout << "------ " << std::endl;
+        buf.Append("Event: ");
+        buf.Append(count);
+        count++;
+        buf.Append("\n------ \n");
 
-      // Print out data from each field
-      DumpFieldVisitor dumpFieldVisitor;
-      f.ApplyFieldVisitor(dumpFieldVisitor);
-      std::cout << std::endl;
+        // Print out data from each field
+        f.ApplyFieldVisitor(dumpFieldVisitor);
+        buf.Append('\n');
+        buf.Write(std::cout, TEXT_WRITE_SIZE);
+      }
+    } catch (...) {
+      // Show the events read before the error
+      buf.Write(std::cout);
+      throw;
     }
+    buf.Write(std::cout);
 
     std::cout << std::endl << "Comments:" <<
                  std::endl << "---------" << std::endl;
@@ -214,9 +235,41 @@ void Dump(std::vector<std::string>& infiles) {
   }
 }
 
-void CSV(std::vector<std::string>& infiles) {
+void CSV(std::vector<std::string>& infiles, unsigned nThreads) {
+
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    XCDFFile f(infiles[0].c_str(), "r");
+    PrintFieldNameVisitor printFieldNameVisitor(f);
+    f.ApplyFieldVisitor(printFieldNameVisitor);
+    std::cout << std::endl;
+    f.Close();
+
+    // Format event ranges on all threads, and write them in order
+    std::string empty;
+    ParallelReduce(GetWorkUnits(infiles, nThreads, true, TEXT_UNIT_EVENTS),
+                   nThreads, empty,
+                   [](const WorkUnit& unit, std::string& part) {
+                     XCDFFile f(unit.fileName_.c_str(), "r");
+                     WorkUnitReader reader(f, unit);
+                     TextBuffer buf(15);
+                     PrintFieldDataVisitor printFieldDataVisitor(buf);
+                     while (reader.Read()) {
+                       printFieldDataVisitor.Reset();
+                       f.ApplyFieldVisitor(printFieldDataVisitor);
+                       buf.Append('\n');
+                     }
+                     part = buf.GetString();
+                   },
+                   [](std::string&, const std::string& part) {
+                     std::cout.write(part.data(), part.size());
+                   }, empty);
+    return;
+  }
 
   XCDFFile f;
+  TextBuffer buf(15);
+  PrintFieldDataVisitor printFieldDataVisitor(buf);
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
     if (i == infiles.size()) {
@@ -236,22 +289,73 @@ void CSV(std::vector<std::string>& infiles) {
       std::cout << std::endl;
     }
 
-    PrintFieldDataVisitor printFieldDataVisitor;
-    while (f.Read()) {
+    try {
+      while (f.Read()) {
 
-      printFieldDataVisitor.Reset();
-      f.ApplyFieldVisitor(printFieldDataVisitor);
-      std::cout << std::endl;
+        printFieldDataVisitor.Reset();
+        f.ApplyFieldVisitor(printFieldDataVisitor);
+        buf.Append('\n');
+        buf.Write(std::cout, TEXT_WRITE_SIZE);
+      }
+    } catch (...) {
+      // Show the events read before the error
+      buf.Write(std::cout);
+      throw;
     }
+    buf.Write(std::cout);
 
     f.Close();
   }
 }
 
+// Count the events of one file or file range satisfying exp
+uint64_t CountEvents(XCDFFile& f,
+                     WorkUnitReader& reader,
+                     const std::string& exp) {
+
+  uint64_t count = 0;
+  EventSelectExpression expression(exp, f, true);
+  while (reader.Read()) {
+    bool selected = expression.SelectEvent();
+    if (expression.IsBlockConstant()) {
+
+      // Same result for the rest of the block: count without reading
+      if (selected) {
+        count += 1 + reader.GetBlockEventsRemaining();
+      }
+      reader.SkipBlock();
+    } else if (selected) {
+      ++count;
+    }
+  }
+  return count;
+}
+
 void Count(std::vector<std::string>& infiles,
-           std::string& exp) {
+           std::string& exp, unsigned nThreads) {
 
   uint64_t count = 0;
+  if (nThreads > 1 && infiles.size() > 0) {
+    // Only split files into event ranges if events must be read
+    bool split = exp.compare("") != 0;
+    ParallelReduce(GetWorkUnits(infiles, nThreads, split),
+                   nThreads, count,
+                   [&exp](const WorkUnit& unit, uint64_t& part) {
+                     XCDFFile f(unit.fileName_.c_str(), "r");
+                     if (!exp.compare("")) {
+                       part = f.GetEventCount();
+                     } else {
+                       WorkUnitReader reader(f, unit);
+                       part = CountEvents(f, reader, exp);
+                     }
+                   },
+                   [](uint64_t& total, const uint64_t& part) {
+                     total += part;
+                   }, count);
+    std::cout << count << std::endl;
+    return;
+  }
+
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
@@ -272,12 +376,8 @@ void Count(std::vector<std::string>& infiles,
       count += f.GetEventCount();
     } else {
       // use the supplied expression
-      EventSelectExpression expression(exp, f);
-      while (f.Read()) {
-        if (expression.SelectEvent()) {
-          ++count;
-        }
-      }
+      WorkUnitReader reader(f);
+      count += CountEvents(f, reader, exp);
     }
     f.Close();
   }
@@ -285,7 +385,25 @@ void Count(std::vector<std::string>& infiles,
   std::cout << count << std::endl;
 }
 
-void Check(std::vector<std::string>& infiles) {
+void Check(std::vector<std::string>& infiles, unsigned nThreads) {
+
+  if (nThreads > 1 && infiles.size() > 0) {
+    // Check whole files: errors are reported for the earliest bad file
+    int result = 0;
+    ParallelReduce(GetWorkUnits(infiles, nThreads, false),
+                   nThreads, result,
+                   [](const WorkUnit& unit, int& part) {
+                     UNUSED(part);
+                     XCDFFile f(unit.fileName_.c_str(), "r");
+                     while (f.Read()) { /* Do nothing */ }
+                     f.Close();
+                   },
+                   [](int& total, const int& part) {
+                     UNUSED(total);
+                     UNUSED(part);
+                   }, result);
+    return;
+  }
 
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
@@ -362,10 +480,103 @@ void CopyAliases(XCDFFile& destination,
   }
 }
 
+void CopyEvents(XCDFFile& destination,
+                XCDFFile& source,
+                FieldCopyBuffer& buf) {
+
+  // Copy whole compressed blocks if the files have identical fields
+  if (destination.CopyBlocks(source)) {
+    return;
+  }
+
+  while (source.Read()) {
+    buf.CopyData();
+    destination.Write();
+  }
+}
+
+/*
+ *  Copy the events of infiles passing exp (all events if exp is empty)
+ *  into outFile on nThreads threads.  Workers decode and select events
+ *  from ranges of the input into memory, and the ranges are written in
+ *  input order as they become available.  The fields to copy must
+ *  already exist in outFile.
+ */
+void CopyEventsParallel(std::vector<std::string>& infiles,
+                        XCDFFile& outFile,
+                        const std::string& exp,
+                        unsigned nThreads) {
+
+  std::set<std::string> fields;
+  GetFieldNamesVisitor getFieldNamesVisitor(fields);
+  outFile.ApplyFieldVisitor(getFieldNamesVisitor);
+
+  XCDFPtr<EventBuffer> empty;
+  ParallelReduce(GetWorkUnits(infiles, nThreads, true, TEXT_UNIT_EVENTS),
+                 nThreads, empty,
+                 [&](const WorkUnit& unit, XCDFPtr<EventBuffer>& part) {
+                   XCDFFile f(unit.fileName_.c_str(), "r");
+                   part = xcdf_shared(new EventBuffer(f, fields));
+                   WorkUnitReader reader(f, unit);
+                   if (!exp.compare("")) {
+                     while (reader.Read()) {
+                       part->Store();
+                     }
+                     return;
+                   }
+
+                   EventSelectExpression expression(exp, f, true);
+                   while (reader.Read()) {
+                     if (expression.SelectEvent()) {
+                       part->Store();
+                     } else if (expression.IsBlockConstant()) {
+                       // Nothing else in this block passes
+                       reader.SkipBlock();
+                     }
+                   }
+                 },
+                 [&outFile](XCDFPtr<EventBuffer>&,
+                            const XCDFPtr<EventBuffer>& part) {
+                   part->Write(outFile);
+                 }, empty);
+}
+
+// Allocate the fields of f matching fieldSpecs in the buffer
+void SetSelectedFields(XCDFFile& f,
+                       const std::set<std::string>& fieldSpecs,
+                       std::set<std::string>& fields,
+                       const std::string& exp,
+                       FieldCopyBuffer& buf) {
+
+  // Build the list of fields
+  if (fields.size() == 0) {
+    MatchFieldsVisitor match(fieldSpecs);
+    f.ApplyFieldVisitor(match);
+    fields = match.GetMatches();
+    if (fields.size() == 0) {
+      XCDFFatal("Unable to match any fields from expression \"" <<
+                                                       exp << "\"");
+    }
+  }
+
+  // Check that the file contains all the fields
+  for (std::set<std::string>::iterator it = fields.begin();
+                                       it != fields.end(); ++it) {
+    if (!f.HasField(*it)) {
+      XCDFFatal("Unable to select field \"" <<
+                             *it << "\": Field not present");
+    }
+  }
+
+  SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+  f.ApplyFieldVisitor(selectFieldVisitor);
+}
+
 void SelectFields(std::vector<std::string>& infiles,
                   std::ostream& out,
                   std::string& exp,
-                  std::string& concatArgs) {
+                  std::string& concatArgs,
+                  unsigned nThreads) {
 
   XCDFFile outFile(out);
   outFile.AddComment(concatArgs);
@@ -376,6 +587,34 @@ void SelectFields(std::vector<std::string>& infiles,
 
   // Spin through the files and copy the data
   XCDFFile f;
+
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    // Set up the output fields from all files first.  Files holding
+    // only the selected fields are faster to copy serially as whole
+    // compressed blocks.
+    bool parallel = true;
+    for (unsigned i = 0; i < infiles.size(); ++i) {
+      f.Open(infiles[i], "r");
+      SetSelectedFields(f, fieldSpecs, fields, exp, buf);
+      if (f.GetNFields() == outFile.GetNFields()) {
+        parallel = false;
+      }
+      f.Close();
+    }
+
+    if (parallel) {
+      CopyEventsParallel(infiles, outFile, "", nThreads);
+      for (unsigned i = 0; i < infiles.size(); ++i) {
+        f.Open(infiles[i], "r");
+        CopyComments(outFile, f);
+        f.Close();
+      }
+      outFile.Close();
+      return;
+    }
+  }
+
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
     if (i == infiles.size()) {
@@ -389,35 +628,10 @@ void SelectFields(std::vector<std::string>& infiles,
       f.Open(infiles[i], "r");
     }
 
-    // Build the list of fields
-    if (fields.size() == 0) {
-      MatchFieldsVisitor match(fieldSpecs);
-      f.ApplyFieldVisitor(match);
-      fields = match.GetMatches();
-      if (fields.size() == 0) {
-        XCDFFatal("Unable to match any fields from expression \"" <<
-                                                         exp << "\"");
-      }
-    }
+    SetSelectedFields(f, fieldSpecs, fields, exp, buf);
 
-    // Check that the file contains all the fields
-    for (std::set<std::string>::iterator it = fields.begin();
-                                         it != fields.end(); ++it) {
-      if (!f.HasField(*it)) {
-        XCDFFatal("Unable to select field \"" <<
-                               *it << "\": Field not present");
-      }
-    }
-
-    SelectFieldVisitor selectFieldVisitor(f, fields, buf);
-    f.ApplyFieldVisitor(selectFieldVisitor);
-
-    while (f.Read()) {
-
-      // Copy the data
-      buf.CopyData();
-      outFile.Write();
-    }
+    // Copy the data
+    CopyEvents(outFile, f, buf);
 
     CopyComments(outFile, f);
     f.Close();
@@ -429,7 +643,8 @@ void SelectFields(std::vector<std::string>& infiles,
 void Select(std::vector<std::string>& infiles,
             std::ostream& out,
             std::string& exp,
-            std::string& concatArgs) {
+            std::string& concatArgs,
+            unsigned nThreads) {
 
   XCDFFile outFile(out);
   outFile.AddComment(concatArgs);
@@ -438,6 +653,33 @@ void Select(std::vector<std::string>& infiles,
 
   // Spin through the files and copy the data
   XCDFFile f;
+
+  if (nThreads > 1 && infiles.size() > 0) {
+
+    // Set up the output fields and aliases from all files, then copy
+    // the selected events in parallel
+    for (unsigned i = 0; i < infiles.size(); ++i) {
+      f.Open(infiles[i], "r");
+      std::set<std::string> fields;
+      GetFieldNamesVisitor getFieldNamesVisitor(fields);
+      f.ApplyFieldVisitor(getFieldNamesVisitor);
+      SelectFieldVisitor selectFieldVisitor(f, fields, buf);
+      f.ApplyFieldVisitor(selectFieldVisitor);
+      CopyAliases(outFile, f);
+      f.Close();
+    }
+
+    CopyEventsParallel(infiles, outFile, exp, nThreads);
+
+    for (unsigned i = 0; i < infiles.size(); ++i) {
+      f.Open(infiles[i], "r");
+      CopyComments(outFile, f);
+      f.Close();
+    }
+    outFile.Close();
+    return;
+  }
+
   for (unsigned i = 0; i <= infiles.size(); ++i) {
 
     if (i == infiles.size()) {
@@ -460,7 +702,7 @@ void Select(std::vector<std::string>& infiles,
     SelectFieldVisitor selectFieldVisitor(f, fields, buf);
     f.ApplyFieldVisitor(selectFieldVisitor);
 
-    EventSelectExpression expression(exp, f);
+    EventSelectExpression expression(exp, f, true);
 
     // Need to copy at beginning to ensure all known aliases are
     // placed into the header of the new file if at all possible
@@ -471,6 +713,9 @@ void Select(std::vector<std::string>& infiles,
       if (expression.SelectEvent()) {
         buf.CopyData();
         outFile.Write();
+      } else if (expression.IsBlockConstant()) {
+        // Nothing else in this block passes
+        f.SkipBlock();
       }
     }
 
@@ -483,6 +728,140 @@ void Select(std::vector<std::string>& infiles,
   outFile.Close();
 }
 
+template <typename Key>
+void SortEvents(std::vector<std::string>& infiles,
+                XCDFFile& f,
+                XCDFFile& outFile,
+                const std::string& exp,
+                size_t maxMemory) {
+
+  EventSorter<Key> sorter(outFile, exp, maxMemory);
+  for (unsigned i = 0; i <= infiles.size(); ++i) {
+
+    // The first input is already open
+    if (i > 0) {
+      if (i == infiles.size()) {
+        continue;
+      }
+      f.Open(infiles[i], "r");
+    }
+
+    CopyAliases(outFile, f);
+    sorter.Add(f);
+    CopyComments(outFile, f);
+    CopyAliases(outFile, f);
+    f.Close();
+  }
+  sorter.Finish();
+}
+
+void Sort(std::vector<std::string>& infiles,
+          std::ostream& out,
+          std::string& exp,
+          std::string& concatArgs,
+          unsigned maxMemoryMB) {
+
+  XCDFFile outFile(out);
+  outFile.AddComment(concatArgs);
+
+  XCDFFile f;
+  if (infiles.size() == 0) {
+    //read from stdin
+    f.Open(std::cin);
+  } else {
+    f.Open(infiles[0], "r");
+  }
+
+  // Sort on the type of the key expression
+  size_t maxMemory = static_cast<size_t>(maxMemoryMB) << 20;
+  Expression key(exp, f);
+  switch (key.GetHeadSymbol()->GetType()) {
+
+    case UNSIGNED_NODE:
+      SortEvents<uint64_t>(infiles, f, outFile, exp, maxMemory);
+      break;
+
+    case SIGNED_NODE:
+      SortEvents<int64_t>(infiles, f, outFile, exp, maxMemory);
+      break;
+
+    case FLOATING_POINT_NODE:
+      SortEvents<double>(infiles, f, outFile, exp, maxMemory);
+      break;
+
+    default:
+      XCDFFatal("Expression does not evaluate: " << exp);
+  }
+
+  outFile.Close();
+}
+
+template <typename Key>
+void MergeSortedFiles(std::vector<std::string>& infiles,
+                      XCDFFile& outFile,
+                      const std::string& exp) {
+
+  MergeReader<Key> reader(infiles, exp);
+
+  // The output has the fields of the first file
+  std::set<std::string> fields;
+  GetFieldNamesVisitor getFieldNamesVisitor(fields);
+  reader.GetFile(0).ApplyFieldVisitor(getFieldNamesVisitor);
+
+  for (unsigned i = 0; i < reader.GetNFiles(); ++i) {
+    for (std::set<std::string>::iterator it = fields.begin();
+                                         it != fields.end(); ++it) {
+      if (!reader.GetFile(i).HasField(*it)) {
+        XCDFFatal("Unable to merge field \"" << *it << "\": Field not " <<
+                  "present in " << infiles[i]);
+      }
+    }
+    CopyAliases(outFile, reader.GetFile(i));
+  }
+
+  CopyMerged(reader, outFile, fields);
+
+  for (unsigned i = 0; i < reader.GetNFiles(); ++i) {
+    CopyComments(outFile, reader.GetFile(i));
+    CopyAliases(outFile, reader.GetFile(i));
+  }
+}
+
+void MergeSorted(std::vector<std::string>& infiles,
+                 std::ostream& out,
+                 std::string& exp,
+                 std::string& concatArgs) {
+
+  XCDFFile outFile(out);
+  outFile.AddComment(concatArgs);
+
+  // Compare keys with the type of the key expression
+  XCDFFile f(infiles[0].c_str(), "r");
+  Expression key(exp, f);
+  SymbolType type = key.GetHeadSymbol()->GetType();
+  f.Close();
+
+  switch (type) {
+
+    case UNSIGNED_NODE:
+      MergeSortedFiles<uint64_t>(infiles, outFile, exp);
+      break;
+
+    case SIGNED_NODE:
+      MergeSortedFiles<int64_t>(infiles, outFile, exp);
+      break;
+
+    case FLOATING_POINT_NODE:
+      MergeSortedFiles<double>(infiles, outFile, exp);
+      break;
+
+    default:
+      XCDFFatal("Expression does not evaluate: " << exp);
+  }
+
+  outFile.Close();
+}
+
 void Compare(const std::string& fileName1,
              const std::string& fileName2) {
 
@@ -557,12 +936,7 @@ void Recover(std::vector<std::string>& infiles,
     f.ApplyFieldVisitor(selectFieldVisitor);
 
     CopyAliases(outFile, f);
-    while (f.Read()) {
-
-      // Copy the data if true
-      buf.CopyData();
-      outFile.Write();
-    }
+    CopyEvents(outFile, f, buf);
   } catch (XCDFException& e) {
     std::cerr << "Corrupt file: Recovered " << outFile.GetEventCount()
                                                << " events." << std::endl;
@@ -603,12 +977,7 @@ void RemoveComments(std::vector<std::string>& infiles,
   f.ApplyFieldVisitor(selectFieldVisitor);
 
   CopyAliases(outFile, f);
-  while (f.Read()) {
-
-    // Copy the data if true
-    buf.CopyData();
-    outFile.Write();
-  }
+  CopyEvents(outFile, f, buf);
   CopyAliases(outFile, f);
   outFile.Close();
 }
@@ -661,10 +1030,7 @@ void RemoveAlias(std::vector<std::string>& infiles,
     // Need to copy at beginning to ensure all known aliases are
     // placed into the header of the new file if at all possible
     CopyAliases(outFile, f, name);
-    while (f.Read()) {
-      buf.CopyData();
-      outFile.Write();
-    }
+    CopyEvents(outFile, f, buf);
 
     CopyComments(outFile, f);
     // Copy any aliases unavailable at beginning
@@ -721,10 +1087,7 @@ void AddAlias(std::vector<std::string>& infiles,
     // Need to copy at beginning to ensure all known aliases are
     // placed into the header of the new file if at all possible
     CopyAliases(outFile, f);
-    while (f.Read()) {
-      buf.CopyData();
-      outFile.Write();
-    }
+    CopyEvents(outFile, f, buf);
 
     CopyComments(outFile, f);
     // Copy any aliases unavailable at beginning
@@ -763,12 +1126,7 @@ void AddComment(std::vector<std::string>& infiles,
   f.ApplyFieldVisitor(selectFieldVisitor);
 
   CopyAliases(outFile, f);
-  while (f.Read()) {
-
-    // Copy the data if true
-    buf.CopyData();
-    outFile.Write();
-  }
+  CopyEvents(outFile, f, buf);
 
   CopyComments(outFile, f);
   outFile.AddComment(comment);
@@ -825,8 +1183,11 @@ void FillHistogram(std::vector<std::string>& infiles,
   }
 }
 
-void CheckRange(std::vector<std::string>& infiles,
-                RangeChecker& rc) {
+// Fill a histogram with deferred range while collecting the range
+// of its axis expressions, reading the data only once
+template <typename Histogram, typename FillPolicy>
+void FillHistogram(std::vector<std::string>& infiles,
+                   Histogram& h, FillPolicy& fill, RangeChecker& rc) {
 
   XCDFFile f;
   for (unsigned i = 0; i <= infiles.size(); ++i) {
@@ -841,8 +1202,50 @@ void CheckRange(std::vector<std::string>& infiles,
       f.Open(infiles[i], "r");
     }
 
-    rc.Fill(f);
+    fill.Fill(h, f, rc);
+  }
+}
+
+// Fill h from infiles on nThreads threads.  Each work unit fills its
+// own empty copy of h, and the copies are added to h in order.
+template <typename Histogram, typename FillPolicy>
+void FillHistogram(std::vector<std::string>& infiles,
+                   Histogram& h, FillPolicy& fill, unsigned nThreads) {
+
+  if (nThreads < 2 || infiles.size() == 0) {
+    FillHistogram(infiles, h, fill);
+    return;
   }
+
+  ParallelReduce(GetWorkUnits(infiles, nThreads, true),
+                 nThreads, h.EmptyCopy(),
+                 [&fill](const WorkUnit& unit, Histogram& part) {
+                   XCDFFile f(unit.fileName_.c_str(), "r");
+                   if (unit.IsWholeFile()) {
+                     fill.Fill(part, f);
+                   } else {
+                     fill.Fill(part, f, unit.start_, unit.end_);
+                   }
+                 },
+                 [](Histogram& total, const Histogram& part) {
+                   total.Add(part);
+                 }, h);
+}
+
+// Find the range of the expressions in rc on nThreads threads
+void CheckRange(std::vector<std::string>& infiles,
+                RangeChecker& rc, unsigned nThreads) {
+
+  RangeChecker empty(rc);
+  ParallelReduce(GetWorkUnits(infiles, nThreads, false),
+                 nThreads, empty,
+                 [](const WorkUnit& unit, RangeChecker& part) {
+                   XCDFFile f(unit.fileName_.c_str(), "r");
+                   part.Fill(f);
+                 },
+                 [](RangeChecker& total, const RangeChecker& part) {
+                   total.Add(part);
+                 }, rc);
 }
 
 template <typename T>
@@ -895,8 +1298,12 @@ void ProcessExpression(const std::string& exp,
   }
 }
 
-void CreateHistogram(std::vector<std::string>& infiles,
-                     std::string& exp) {
+// Parse "nbins, min, max, expr {, weight}" or "nbins, expr {, weight}".
+// In the second form, autoRange is set and min and max are not filled.
+bool ParseHistogram1D(const std::string& exp,
+                      unsigned& nbins, double& min, double& max,
+                      std::string& expr, std::string& weightExpr,
+                      bool& autoRange) {
 
   // Parse CSV expression
   std::vector<std::string> args;
@@ -905,59 +1312,54 @@ void CreateHistogram(std::vector<std::string>& infiles,
   if (!(args.size() == 2 || args.size() == 3 ||
         args.size() == 4 || args.size() == 5)) {
     std::cerr << "Invalid histogram args: " << exp << std::endl;
-    return;
+    return false;
   }
 
-  unsigned nbins;
-  double min, max;
-  std::string expr;
-  std::string weightExpr = "1.";
+  weightExpr = "1.";
   bool fail = false;
   fail |= Extract(args[0], nbins);
   if (args.size() == 4 || args.size() == 5) {
+    autoRange = false;
     fail |= Extract(args[1], min);
     fail |= Extract(args[2], max);
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
     if (nbins == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
-      return;
+      return false;
     }
     if (min > max) {
       std::cerr << "Histogram range min must be less than max" << std::endl;
-      return;
+      return false;
     }
     expr = args[3];
     if (args.size() == 5) {
       weightExpr = args[4];
     }
   } else {
+    autoRange = true;
     expr = args[1];
     if (args.size() == 3) {
       weightExpr = args[2];
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
-    RangeChecker rc(expr);
-    CheckRange(infiles, rc);
-    min = rc.GetMin();
-    max = rc.GetMax();
-
-    FixBins(min, max, nbins);
   }
-
-  Histogram1D h(nbins, min, max);
-  Filler1D fill(expr, weightExpr);
-  FillHistogram(infiles, h, fill);
-  std::cout << h;
+  return true;
 }
 
-void CreateHistogram2D(std::vector<std::string>& infiles,
-                       std::string& exp) {
+// Parse "nbinsX, minX, maxX, exprX, nbinsY, minY, maxY, exprY {, weight}"
+// or "nbinsX, exprX, nbinsY, exprY {, weight}", setting autoRange in
+// the second case.
+bool ParseHistogram2D(const std::string& exp,
+                      unsigned& nbinsX, double& minX, double& maxX,
+                      unsigned& nbinsY, double& minY, double& maxY,
+                      std::string& exprX, std::string& exprY,
+                      std::string& weightExpr, bool& autoRange) {
 
   // Parse CSV expression
   std::vector<std::string> args;
@@ -966,16 +1368,14 @@ void CreateHistogram2D(std::vector<std::string>& infiles,
   if (!(args.size() == 4 || args.size() == 5 ||
         args.size() == 8 || args.size() == 9)) {
     std::cerr << "Invalid histogram args: " << exp << std::endl;
-    return;
+    return false;
   }
 
-  unsigned nbinsX, nbinsY;
-  double minX, maxX, minY, maxY;
-  std::string exprX, exprY;
-  std::string weightExpr = "1.";
+  weightExpr = "1.";
   bool fail = false;
   fail |= Extract(args[0], nbinsX);
   if (args.size() == 8 || args.size() == 9) {
+    autoRange = false;
     fail |= Extract(args[1], minX);
     fail |= Extract(args[2], maxX);
     exprX = args[3];
@@ -988,17 +1388,18 @@ void CreateHistogram2D(std::vector<std::string>& infiles,
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
     if (nbinsX == 0 || nbinsY == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
-      return;
+      return false;
     }
     if (minX > maxX || minY > maxY) {
       std::cerr << "Histogram range min must be less than max" << std::endl;
-      return;
+      return false;
     }
   } else {
+    autoRange = true;
     exprX = args[1];
     fail |= Extract(args[2], nbinsY);
     exprY = args[3];
@@ -1007,17 +1408,85 @@ void CreateHistogram2D(std::vector<std::string>& infiles,
     }
     if (fail) {
       std::cerr << "Invalid histogram args: " << exp << std::endl;
-      return;
+      return false;
     }
     if (nbinsX == 0 || nbinsY == 0) {
       std::cerr << "Number of bins must be greater than zero" << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+void CreateHistogram(std::vector<std::string>& infiles,
+                     std::string& exp, unsigned nThreads) {
+
+  unsigned nbins;
+  double min, max;
+  std::string expr;
+  std::string weightExpr;
+  bool autoRange;
+  if (!ParseHistogram1D(exp, nbins, min, max,
+                        expr, weightExpr, autoRange)) {
+    return;
+  }
+
+  if (autoRange && nThreads > 1 && infiles.size() > 0) {
+
+    // Find the range in a parallel pass of its own.  Unless expr is a
+    // field, this reads the data once more than the serial fill, which
+    // keeps the fills until the range is known.
+    RangeChecker rc(expr);
+    CheckRange(infiles, rc, nThreads);
+    min = rc.GetMin();
+    max = rc.GetMax();
+
+    FixBins(min, max, nbins);
+  } else if (autoRange) {
+    Histogram1D h(nbins);
+    Filler1D fill(expr, weightExpr);
+    RangeChecker rc(expr);
+    FillHistogram(infiles, h, fill, rc);
+    min = rc.GetMin();
+    max = rc.GetMax();
+
+    FixBins(min, max, nbins);
+
+    // Replay the kept fills unless there were too many to keep
+    if (!h.HasDroppedFills()) {
+      h.SetRange(min, max);
+      std::cout << h;
       return;
     }
-    std::vector<std::string> exprs;
-    exprs.push_back(exprX);
-    exprs.push_back(exprY);
+  }
+
+  Histogram1D h(nbins, min, max);
+  Filler1D fill(expr, weightExpr);
+  FillHistogram(infiles, h, fill, nThreads);
+  std::cout << h;
+}
+
+void CreateHistogram2D(std::vector<std::string>& infiles,
+                       std::string& exp, unsigned nThreads) {
+
+  unsigned nbinsX, nbinsY;
+  double minX, maxX, minY, maxY;
+  std::string exprX, exprY;
+  std::string weightExpr;
+  bool autoRange;
+  if (!ParseHistogram2D(exp, nbinsX, minX, maxX, nbinsY, minY, maxY,
+                        exprX, exprY, weightExpr, autoRange)) {
+    return;
+  }
+
+  std::vector<std::string> exprs;
+  exprs.push_back(exprX);
+  exprs.push_back(exprY);
+  if (autoRange && nThreads > 1 && infiles.size() > 0) {
+
+    // Find the range in a parallel pass of its own, as for 1D
     RangeChecker rc(exprs);
-    CheckRange(infiles, rc);
+    CheckRange(infiles, rc, nThreads);
     minX = rc.GetMin(0);
     maxX = rc.GetMax(0);
     minY = rc.GetMin(1);
@@ -1025,19 +1494,309 @@ void CreateHistogram2D(std::vector<std::string>& infiles,
 
     FixBins(minX, maxX, nbinsX);
     FixBins(minY, maxY, nbinsY);
+  } else if (autoRange) {
+    Histogram2D h(nbinsX, nbinsY);
+    Filler2D fill(exprX, exprY, weightExpr);
+    RangeChecker rc(exprs);
+    FillHistogram(infiles, h, fill, rc);
+    minX = rc.GetMin(0);
+    maxX = rc.GetMax(0);
+    minY = rc.GetMin(1);
+    maxY = rc.GetMax(1);
+
+    FixBins(minX, maxX, nbinsX);
+    FixBins(minY, maxY, nbinsY);
+
+    // Replay the kept fills unless there were too many to keep
+    if (!h.HasDroppedFills()) {
+      h.SetRange(minX, maxX, minY, maxY);
+      std::cout << h;
+      return;
+    }
   }
 
   Histogram2D h(nbinsX, minX, maxX, nbinsY, minY, maxY);
   Filler2D fill(exprX, exprY, weightExpr);
+  FillHistogram(infiles, h, fill, nThreads);
+  std::cout << h;
+}
+
+void CreateHistogramND(std::vector<std::string>& infiles,
+                       std::string& exp) {
+
+  // Parse CSV expression: four entries per dimension and an optional
+  // weight
+  std::vector<std::string> args;
+  ProcessExpression(exp, args);
+
+  if (args.size() < 4 || args.size() % 4 > 1) {
+    std::cerr << "Invalid histogram args: " << exp << std::endl;
+    return;
+  }
+
+  unsigned ndim = args.size() / 4;
+  std::vector<unsigned> nbins(ndim);
+  std::vector<double> mins(ndim);
+  std::vector<double> maxs(ndim);
+  std::vector<std::string> exprs(ndim);
+  std::string weightExpr = "1.";
+  bool fail = false;
+  for (unsigned i = 0; i < ndim; ++i) {
+    fail |= Extract(args[4*i], nbins[i]);
+    fail |= Extract(args[4*i + 1], mins[i]);
+    fail |= Extract(args[4*i + 2], maxs[i]);
+    exprs[i] = args[4*i + 3];
+    if (!fail && nbins[i] == 0) {
+      std::cerr << "Number of bins must be greater than zero" << std::endl;
+      return;
+    }
+    if (!fail && mins[i] > maxs[i]) {
+      std::cerr << "Histogram range min must be less than max" << std::endl;
+      return;
+    }
+  }
+  if (fail) {
+    std::cerr << "Invalid histogram args: " << exp << std::endl;
+    return;
+  }
+  if (args.size() % 4 == 1) {
+    weightExpr = args.back();
+  }
+
+  HistogramND h(nbins, mins, maxs);
+  FillerND fill(exprs, weightExpr);
   FillHistogram(infiles, h, fill);
   std::cout << h;
 }
 
+void FillHistograms(std::vector<std::string>& infiles,
+                    MultiFiller& fill, bool allowStdin) {
+
+  XCDFFile f;
+  for (unsigned i = 0; i <= infiles.size(); ++i) {
+
+    if (i == infiles.size()) {
+      if (infiles.size() == 0) {
+        if (!allowStdin) {
+          XCDFFatal("Cannot fill variable range histogram from stdin")
+        }
+        //read from stdin
+        f.Open(std::cin);
+      } else {
+        continue;
+      }
+    } else {
+      f.Open(infiles[i], "r");
+    }
+
+    fill.Fill(f);
+  }
+}
+
+std::string Trim(const std::string& s) {
+
+  size_t first = s.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) {
+    return "";
+  }
+  size_t last = s.find_last_not_of(" \t\r\n");
+  return s.substr(first, last - first + 1);
+}
+
+// One histogram requested in a histogram specification file
+struct HistogramSpec {
+
+  HistogramSpec() : nbinsX_(0), nbinsY_(0),
+                    minX_(0.), maxX_(1.), minY_(0.), maxY_(1.),
+                    autoRange_(false) { }
+
+  std::string outFile_;
+  std::string exprX_;
+  std::string exprY_;
+  std::string weightExpr_;
+  std::string selExpr_;
+  unsigned nbinsX_;
+  unsigned nbinsY_;
+  double minX_;
+  double maxX_;
+  double minY_;
+  double maxY_;
+  bool autoRange_;
+  XCDFPtr<Histogram1D> h1_;
+  XCDFPtr<Histogram2D> h2_;
+  XCDFPtr<RangeChecker> rc_;
+
+  bool Is2D() const {return nbinsY_ > 0;}
+
+  // Create the histogram and add it to fill.  A histogram with deferred
+  // range keeps its fills in memory taken from budget.
+  void Create(MultiFiller& fill, XCDFPtr<DeferredFillBudget> budget) {
+
+    RangeChecker* rc = NULL;
+    if (autoRange_ && rc_.IsNull()) {
+      std::vector<std::string> exprs(1, exprX_);
+      if (Is2D()) {
+        exprs.push_back(exprY_);
+      }
+      rc_ = xcdf_shared(new RangeChecker(exprs));
+      rc = &(*rc_);
+    }
+
+    if (!Is2D()) {
+      h1_ = xcdf_shared(rc ? new Histogram1D(nbinsX_, budget) :
+                             new Histogram1D(nbinsX_, minX_, maxX_));
+      fill.Add(*h1_, exprX_, weightExpr_, selExpr_, rc);
+    } else {
+      h2_ = xcdf_shared(rc ? new Histogram2D(nbinsX_, nbinsY_, budget) :
+                             new Histogram2D(nbinsX_, minX_, maxX_,
+                                             nbinsY_, minY_, maxY_));
+      fill.Add(*h2_, exprX_, exprY_, weightExpr_, selExpr_, rc);
+    }
+  }
+
+  // Set the range found during filling.  Returns false if the
+  // histogram must be refilled with that range.
+  bool SetRange() {
+
+    minX_ = rc_->GetMin(0);
+    maxX_ = rc_->GetMax(0);
+    FixBins(minX_, maxX_, nbinsX_);
+    if (!Is2D()) {
+      if (h1_->HasDroppedFills()) {
+        return false;
+      }
+      h1_->SetRange(minX_, maxX_);
+      return true;
+    }
+    minY_ = rc_->GetMin(1);
+    maxY_ = rc_->GetMax(1);
+    FixBins(minY_, maxY_, nbinsY_);
+    if (h2_->HasDroppedFills()) {
+      return false;
+    }
+    h2_->SetRange(minX_, maxX_, minY_, maxY_);
+    return true;
+  }
+
+  void Write() const {
+
+    std::ofstream fout;
+    std::ostream* out = &std::cout;
+    if (outFile_.compare("-")) {
+      fout.open(outFile_.c_str());
+      if (!fout.good()) {
+        XCDFFatal("Unable to open histogram output file " << outFile_);
+      }
+      out = &fout;
+    }
+    if (!Is2D()) {
+      *out << *h1_;
+    } else {
+      *out << *h2_;
+    }
+  }
+};
+
+/*
+ * Fill every histogram listed in specFile in one pass over the input.
+ * Each non-empty line not starting with '#' has the form
+ *
+ *   outfile; histogram|histogram2d; histogram expression {; selection}
+ *
+ * and the histogram is written to outfile ("-" for stdout).
+ */
+void CreateHistograms(std::vector<std::string>& infiles,
+                      std::string& specFile) {
+
+  std::ifstream in(specFile.c_str());
+  if (!in.good()) {
+    XCDFFatal("Unable to open histogram specification file " << specFile);
+  }
+
+  std::vector<HistogramSpec> specs;
+  MultiFiller fill;
+
+  // All histograms with deferred range share one memory budget
+  XCDFPtr<DeferredFillBudget> budget =
+                         xcdf_shared(new DeferredFillBudget());
+  std::string line;
+  unsigned lineNumber = 0;
+  while (std::getline(in, line)) {
+
+    ++lineNumber;
+    line = Trim(line);
+    if (line.size() == 0 || line[0] == '#') {
+      continue;
+    }
+
+    std::vector<std::string> parts;
+    size_t pos = 0;
+    for (;;) {
+      size_t next = line.find(';', pos);
+      parts.push_back(Trim(line.substr(pos, next - pos)));
+      if (next == std::string::npos) {
+        break;
+      }
+      pos = next + 1;
+    }
+    if (parts.size() < 3 || parts.size() > 4 || parts[0].size() == 0) {
+      XCDFFatal("Invalid histogram specification at " << specFile <<
+                                         ":" << lineNumber << ": " << line);
+    }
+
+    HistogramSpec spec;
+    spec.outFile_ = parts[0];
+    if (parts.size() == 4) {
+      spec.selExpr_ = parts[3];
+    }
+
+    bool ok = false;
+    if (!parts[1].compare("histogram")) {
+      ok = ParseHistogram1D(parts[2], spec.nbinsX_, spec.minX_, spec.maxX_,
+                            spec.exprX_, spec.weightExpr_, spec.autoRange_);
+    } else if (!parts[1].compare("histogram2d")) {
+      ok = ParseHistogram2D(parts[2], spec.nbinsX_, spec.minX_, spec.maxX_,
+                            spec.nbinsY_, spec.minY_, spec.maxY_,
+                            spec.exprX_, spec.exprY_,
+                            spec.weightExpr_, spec.autoRange_);
+    } else {
+      std::cerr << "Unknown histogram type: " << parts[1] << std::endl;
+    }
+    if (!ok) {
+      XCDFFatal("Invalid histogram specification at " << specFile <<
+                                         ":" << lineNumber << ": " << line);
+    }
+    spec.Create(fill, budget);
+    specs.push_back(spec);
+  }
+
+  FillHistograms(infiles, fill, true);
+
+  // Histograms that kept too many fills to replay need a second pass
+  MultiFiller refill;
+  for (std::vector<HistogramSpec>::iterator it = specs.begin();
+                                            it != specs.end(); ++it) {
+    if (it->autoRange_ && !it->SetRange()) {
+      it->autoRange_ = false;
+      it->Create(refill, budget);
+    }
+  }
+  if (refill.GetNHistograms() > 0) {
+    FillHistograms(infiles, refill, false);
+  }
+
+  for (std::vector<HistogramSpec>::const_iterator it = specs.begin();
+                                                  it != specs.end(); ++it) {
+    it->Write();
+  }
+}
+
 void Paste(std::vector<std::string>& infiles,
            std::ostream& out,
            std::string& copyFile,
            std::string& concatArgs,
-           std::string& delimeter) {
+           std::string& delimeter,
+           unsigned nThreads) {
 
   char& del = delimeter[0];
   XCDFFile outFile(out);
@@ -1074,7 +1833,7 @@ void Paste(std::vector<std::string>& infiles,
   }
 
   // Allocate the new fields
-  CSVInputHandler csvIn(outFile, *currentInputStream, del);
+  CSVInputHandler csvIn(outFile, *currentInputStream, del, nThreads);
 
   if (f.IsOpen()) {
     CopyAliases(outFile, f);
@@ -1158,7 +1917,27 @@ void PrintUsage() {
     "                    e.g.: \"field1 == 0\" to select all events\n" <<
     "                    where the value of field1 is zero.  The variable\n" <<
     "                    \"currentEventNumber\" refers to the current\n" <<
-    "                    event in the file.\n\n" <<
+    "                    event in the file.  in(field, (1, 2, 3)) is true\n" <<
+    "                    when field matches any listed value, and\n" <<
+    "                    in(field, @file) reads the values from a file.\n\n" <<
+
+    "    sort \"key expression\" {-m megabytes} {-o outfile} {infiles}:\n\n" <<
+
+    "                    Copy all events into a new XCDF file ordered by the\n" <<
+    "                    value of the key expression, e.g. \"time\", keeping\n" <<
+    "                    the input order of events with equal keys.  Events\n" <<
+    "                    beyond -m megabytes of memory (default 1024) are\n" <<
+    "                    sorted in parts written to temporary files in\n" <<
+    "                    $TMPDIR (or /tmp), which are then merged.  The\n" <<
+    "                    output has the fields of the first input file.\n\n" <<
+
+    "    merge-sorted \"key expression\" {-o outfile} infiles:\n\n" <<
+
+    "                    Merge files that are each ordered by the key\n" <<
+    "                    expression, e.g. \"gpsTime\", into one ordered XCDF\n" <<
+    "                    file, reading only one block of each file at a time.\n" <<
+    "                    Events with equal keys are taken from earlier files\n" <<
+    "                    first.  The output has the fields of the first file.\n\n" <<
 
     "    paste {-d delimeter} {-c existingfile} {-o outfile} {infile}:\n\n" <<
 
@@ -1210,6 +1989,29 @@ void PrintUsage() {
     "                    and max.  An optional expression may be appended to weight the\n" <<
     "                    entry.\n\n" <<
 
+    "    histogramnd \"histogram expression\" {infiles}:\n\n" <<
+    "                    Create a sparse histogram in any number of dimensions.\n" <<
+    "                    The expression is of the form \"nbins1, min1, max1,\n" <<
+    "                    expr1, nbins2, min2, max2, expr2, ...\", with an optional\n" <<
+    "                    weight expression appended.  Only bins with entries are\n" <<
+    "                    stored and printed, so fine binning in many dimensions\n" <<
+    "                    is possible.\n\n" <<
+
+    "    histograms specfile {infiles}:\n\n" <<
+    "                    Fill all histograms listed in specfile in a single pass\n" <<
+    "                    over the data.  Each line of specfile is of the form\n" <<
+    "                    \"outfile; histogram; expression {; selection}\" or\n" <<
+    "                    \"outfile; histogram2d; expression {; selection}\",\n" <<
+    "                    where expression is as given to the histogram or\n" <<
+    "                    histogram2d verb and the optional selection is a\n" <<
+    "                    boolean expression choosing the events to fill.\n" <<
+    "                    Each histogram is written to its outfile, or to stdout\n" <<
+    "                    if outfile is \"-\".  Lines starting with '#' are\n" <<
+    "                    ignored.  Identical selections are evaluated once\n" <<
+    "                    per event.  Other sub-expressions are not shared\n" <<
+    "                    between histograms: to compute one only once per\n" <<
+    "                    event, define it with add-alias and use the alias.\n\n" <<
+
     "    comments {infiles} Display all comments from an XCDF file\n\n" <<
 
     "    add-comment \"comment\" {-o outfile} {infiles} Add comment to an XCDF file\n\n" <<
@@ -1222,7 +2024,24 @@ void PrintUsage() {
   std::cout <<
     "  Note: if input/output file(s) are not specified, they are\n" <<
     "  read/written from/to stdin/stdout.\n\n" <<
-    "  Multiple input files are allowed.\n";
+    "  Multiple input files are allowed.\n\n" <<
+    "  Option -j n, given directly after count, check, csv, histogram,\n" <<
+    "  histogram2d, select or select-fields, spreads the input files (or\n" <<
+    "  event ranges of large files) over n threads.  Selected events keep\n" <<
+    "  their input order.  After paste, it parses the text on n threads.\n" <<
+    "  -j 0 uses all available cores.  A histogram or histogram2d without\n" <<
+    "  a given range then reads the data twice, first to find the range\n" <<
+    "  and then to fill, unless its expressions are plain fields, whose\n" <<
+    "  ranges are stored in the file.\n\n" <<
+    "  Functions reduce a vector expression to one value per event:\n" <<
+    "  sum(v), any(v) and all(v); unique(v), the number of distinct\n" <<
+    "  entries, with all NaNs counted as one; min(v) and max(v), the\n" <<
+    "  smallest and largest entry; mean(v), the average entry, or NaN\n" <<
+    "  if there are none; count(v), the number of non-zero entries;\n" <<
+    "  argmax(v), the index of the first largest entry; first(v) and\n" <<
+    "  last(v).  min, max, argmax, first and last are zero if there are\n" <<
+    "  no entries.  A field or alias named like a function, e.g.\n" <<
+    "  \"count\", shadows the function in expressions.\n";
 }
 
 int do_main(int argc, char** argv) {
@@ -1247,8 +2066,35 @@ int do_main(int argc, char** argv) {
   std::vector<std::string> infiles;
   std::string copyFile = "";
   std::string delimeter = ",";
+  unsigned nThreads = 1;
+  unsigned sortMemory = 1024;
   int currentArg = 2;
 
+  // Number of worker threads for verbs that can use them
+  if (currentArg < argc && !std::string(argv[currentArg]).compare("-j")) {
+
+    if (verb.compare("count") && verb.compare("check") &&
+        verb.compare("csv") && verb.compare("histogram") &&
+        verb.compare("histogram2d") && verb.compare("select") &&
+        verb.compare("select-fields") && verb.compare("paste")) {
+      std::cerr << "Option -j is not supported by " << verb << std::endl;
+      PrintUsage();
+      exit(1);
+    }
+
+    if (++currentArg == argc) {
+      PrintUsage();
+      exit(1);
+    }
+
+    std::string threadArg(argv[currentArg++]);
+    if (Extract(threadArg, nThreads)) {
+      PrintUsage();
+      exit(1);
+    }
+    nThreads = GetThreadCount(nThreads);
+  }
+
   if (!verb.compare("count")) {
 
     if (currentArg < argc) {
@@ -1286,7 +2132,9 @@ int do_main(int argc, char** argv) {
   }
 
   if (!verb.compare("histogram") ||
-      !verb.compare("histogram2d")) {
+      !verb.compare("histogram2d") ||
+      !verb.compare("histogramnd") ||
+      !verb.compare("histograms")) {
 
     if (argc < 3) {
       PrintUsage();
@@ -1323,6 +2171,68 @@ int do_main(int argc, char** argv) {
     }
   }
 
+  if (!verb.compare("merge-sorted")) {
+
+    if (currentArg == argc) {
+      PrintUsage();
+      exit(1);
+    }
+    exp = std::string(argv[currentArg++]);
+
+    if (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (!out.compare("-o")) {
+
+        if (++currentArg == argc) {
+          PrintUsage();
+          exit(1);
+        }
+
+        fout.open(argv[currentArg++]);
+        outstream = &fout;
+      }
+    }
+  }
+
+  if (!verb.compare("sort")) {
+
+    if (currentArg == argc) {
+      PrintUsage();
+      exit(1);
+    }
+    exp = std::string(argv[currentArg++]);
+
+    if (currentArg < argc && !std::string(argv[currentArg]).compare("-m")) {
+
+      if (++currentArg == argc) {
+        PrintUsage();
+        exit(1);
+      }
+
+      std::string memoryArg(argv[currentArg++]);
+      if (Extract(memoryArg, sortMemory) || sortMemory == 0) {
+        PrintUsage();
+        exit(1);
+      }
+    }
+
+    if (currentArg < argc) {
+
+      std::string out(argv[currentArg]);
+      if (!out.compare("-o")) {
+
+        if (++currentArg == argc) {
+          PrintUsage();
+          exit(1);
+        }
+
+        fout.open(argv[currentArg++]);
+        outstream = &fout;
+      }
+    }
+  }
+
   if (!verb.compare("add-alias")) {
 
     if (argc < 4) {
@@ -1420,15 +2330,15 @@ int do_main(int argc, char** argv) {
   }
 
   else if (!verb.compare("count")) {
-    Count(infiles, exp);
+    Count(infiles, exp, nThreads);
   }
 
   else if (!verb.compare("csv")) {
-    CSV(infiles);
+    CSV(infiles, nThreads);
   }
 
   else if (!verb.compare("check")) {
-    Check(infiles);
+    Check(infiles, nThreads);
   }
 
   else if (!verb.compare("remove-comments")) {
@@ -1444,11 +2354,23 @@ int do_main(int argc, char** argv) {
   }
 
   else if (!verb.compare("select-fields")) {
-    SelectFields(infiles, *outstream, exp, concatArgs);
+    SelectFields(infiles, *outstream, exp, concatArgs, nThreads);
   }
 
   else if (!verb.compare("select")) {
-    Select(infiles, *outstream, exp, concatArgs);
+    Select(infiles, *outstream, exp, concatArgs, nThreads);
+  }
+
+  else if (!verb.compare("merge-sorted")) {
+    if (infiles.size() == 0) {
+      PrintUsage();
+      exit(1);
+    }
+    MergeSorted(infiles, *outstream, exp, concatArgs);
+  }
+
+  else if (!verb.compare("sort")) {
+    Sort(infiles, *outstream, exp, concatArgs, sortMemory);
   }
 
   else if (!verb.compare("paste")) {
@@ -1456,7 +2378,7 @@ int do_main(int argc, char** argv) {
       PrintUsage();
       exit(0);
     }
-    Paste(infiles, *outstream, copyFile, concatArgs, delimeter);
+    Paste(infiles, *outstream, copyFile, concatArgs, delimeter, nThreads);
   }
 
   else if (!verb.compare("version")) {
@@ -1464,11 +2386,19 @@ int do_main(int argc, char** argv) {
   }
 
   else if (!verb.compare("histogram")) {
-    CreateHistogram(infiles, exp);
+    CreateHistogram(infiles, exp, nThreads);
   }
 
   else if (!verb.compare("histogram2d")) {
-    CreateHistogram2D(infiles, exp);
+    CreateHistogram2D(infiles, exp, nThreads);
+  }
+
+  else if (!verb.compare("histogramnd")) {
+    CreateHistogramND(infiles, exp);
+  }
+
+  else if (!verb.compare("histograms")) {
+    CreateHistograms(infiles, exp);
   }
 
   else if (!verb.compare("compare")) {